@@ -1,6 +1,8 @@
 #include <dma.h>
 #include <asm/mmu.h>
 
+#include "mmu-common.h"
+
 void dma_sync_single_for_device(dma_addr_t address, size_t size,
 				enum dma_data_direction dir)
 {
@@ -18,3 +20,13 @@ void dma_sync_single_for_device(dma_addr_t address, size_t size,
 			outer_cache.clean_range(address, address + size);
 	}
 }
+
+void dma_sync_single_for_cpu(dma_addr_t address, size_t size,
+			     enum dma_data_direction dir)
+{
+	/*
+	 * FIXME: This function needs a device argument to support non 1:1 mappings
+	 */
+	if (dir != DMA_TO_DEVICE)
+		dma_inv_range((void *)address, size);
+}
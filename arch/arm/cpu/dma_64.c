@@ -1,6 +1,60 @@
 #include <dma.h>
+#include <smp.h>
 #include <asm/mmu.h>
 #include <asm/cache.h>
+#include <asm/system.h>
+#include <linux/limits.h>
+
+/*
+ * Walking a buffer line by line gets more expensive than cleaning the
+ * whole data cache by set/way once the buffer is larger than all data
+ * caches together. Set/way operations only work on the caches of the
+ * calling core, so they can't be used while secondary cores are running.
+ */
+static size_t dma_whole_cache_threshold;
+
+static size_t v8_dcache_size(void)
+{
+	unsigned long clidr, ccsidr;
+	size_t total = 0;
+	int level;
+
+	asm volatile("mrs %0, clidr_el1" : "=r" (clidr));
+
+	for (level = 0; level < 7; level++) {
+		unsigned int type = (clidr >> (level * 3)) & 7;
+		unsigned int line, ways, sets;
+
+		if (!type)
+			break;
+		/* instruction cache only */
+		if (type == 1)
+			continue;
+
+		asm volatile("msr csselr_el1, %0" : : "r" (level << 1));
+		isb();
+		asm volatile("mrs %0, ccsidr_el1" : "=r" (ccsidr));
+
+		line = 1 << ((ccsidr & 7) + 4);
+		ways = ((ccsidr >> 3) & 0x3ff) + 1;
+		sets = ((ccsidr >> 13) & 0x7fff) + 1;
+
+		total += line * ways * sets;
+	}
+
+	asm volatile("msr csselr_el1, %0" : : "r" (0));
+	isb();
+
+	return total;
+}
+
+static bool dma_use_whole_cache(size_t size)
+{
+	if (!dma_whole_cache_threshold)
+		dma_whole_cache_threshold = v8_dcache_size() ? : SIZE_MAX;
+
+	return size >= dma_whole_cache_threshold && !smp_num_workers();
+}
 
 void dma_sync_single_for_device(dma_addr_t address, size_t size,
                                 enum dma_data_direction dir)
@@ -9,8 +63,31 @@ void dma_sync_single_for_device(dma_addr_t address, size_t size,
 	 * FIXME: This function needs a device argument to support non 1:1 mappings
 	 */
 
-	if (dir == DMA_FROM_DEVICE)
+	/*
+	 * Cleaning instead of only invalidating is fine for DMA_FROM_DEVICE,
+	 * whatever is written back gets overwritten by the device anyway.
+	 */
+	if (dma_use_whole_cache(size))
+		v8_flush_dcache_all();
+	else if (dir == DMA_FROM_DEVICE)
 		v8_inv_dcache_range(address, address + size - 1);
 	else
 		v8_flush_dcache_range(address, address + size - 1);
 }
+
+void dma_sync_single_for_cpu(dma_addr_t address, size_t size,
+			     enum dma_data_direction dir)
+{
+	if (dir == DMA_TO_DEVICE)
+		return;
+
+	/*
+	 * Lines of the buffer can only have been fetched speculatively
+	 * while the device owned it, so they are clean and cleaning them
+	 * again doesn't overwrite what the device wrote.
+	 */
+	if (dma_use_whole_cache(size))
+		v8_flush_dcache_all();
+	else
+		v8_inv_dcache_range(address, address + size - 1);
+}
@@ -12,16 +12,69 @@
 #include <asm/barebox-arm.h>
 #include <memory.h>
 #include <zero_page.h>
+#include <linux/bitmap.h>
+#include <asm/io.h>
 #include "mmu-common.h"
 
-void dma_sync_single_for_cpu(dma_addr_t address, size_t size,
-			     enum dma_data_direction dir)
+#define DMA_POOL_SIZE		CONFIG_ARM_DMA_COHERENT_POOL_SIZE
+#define DMA_POOL_PAGES		(DMA_POOL_SIZE / PAGE_SIZE)
+
+static void *dma_pool;
+static DECLARE_BITMAP(dma_pool_map, DMA_POOL_PAGES);
+
+static bool dma_pool_contains(void *mem)
 {
-	/*
-	 * FIXME: This function needs a device argument to support non 1:1 mappings
-	 */
-	if (dir != DMA_TO_DEVICE)
-		dma_inv_range((void *)address, size);
+	return dma_pool && mem >= dma_pool && mem < dma_pool + DMA_POOL_SIZE;
+}
+
+static void *dma_pool_alloc(size_t size)
+{
+	unsigned long pages = PAGE_ALIGN(size) / PAGE_SIZE;
+	unsigned long page;
+	void *mem;
+
+	if (!dma_pool)
+		return NULL;
+
+	page = bitmap_find_next_zero_area(dma_pool_map, DMA_POOL_PAGES, 0,
+					  pages, 0);
+	if (page >= DMA_POOL_PAGES)
+		return NULL;
+
+	bitmap_set(dma_pool_map, page, pages);
+
+	mem = dma_pool + page * PAGE_SIZE;
+
+	/* the pool is mapped as device memory, which plain memset can't handle */
+	memset_io(mem, 0, pages * PAGE_SIZE);
+
+	return mem;
+}
+
+static void dma_pool_free(void *mem, size_t size)
+{
+	bitmap_clear(dma_pool_map, (mem - dma_pool) / PAGE_SIZE,
+		     PAGE_ALIGN(size) / PAGE_SIZE);
+}
+
+/*
+ * The pool is aligned to a whole block, so that mapping it uncached
+ * only needs a single block entry instead of splitting the mapping
+ * around every coherent allocation.
+ */
+static void dma_pool_init(void)
+{
+	if (!DMA_POOL_SIZE)
+		return;
+
+	dma_pool = memalign(SZ_2M, DMA_POOL_SIZE);
+	if (!dma_pool) {
+		pr_warn("cannot allocate coherent DMA pool\n");
+		return;
+	}
+
+	dma_flush_range(dma_pool, DMA_POOL_SIZE);
+	remap_range(dma_pool, DMA_POOL_SIZE, MAP_UNCACHED);
 }
 
 void *dma_alloc_map(size_t size, dma_addr_t *dma_handle, unsigned flags)
@@ -43,15 +96,29 @@ void *dma_alloc_map(size_t size, dma_addr_t *dma_handle, unsigned flags)
 
 void *dma_alloc_coherent(size_t size, dma_addr_t *dma_handle)
 {
+	void *ret;
+
 	/*
 	 * FIXME: This function needs a device argument to support non 1:1 mappings
 	 */
 
+	ret = dma_pool_alloc(size);
+	if (ret) {
+		if (dma_handle)
+			*dma_handle = (dma_addr_t)ret;
+		return ret;
+	}
+
 	return dma_alloc_map(size, dma_handle, MAP_UNCACHED);
 }
 
 void dma_free_coherent(void *mem, dma_addr_t dma_handle, size_t size)
 {
+	if (dma_pool_contains(mem)) {
+		dma_pool_free(mem, size);
+		return;
+	}
+
 	size = PAGE_ALIGN(size);
 	remap_range(mem, size, MAP_CACHED);
 
@@ -91,6 +158,8 @@ static int mmu_init(void)
 
 	__mmu_init(get_cr() & CR_M);
 
+	dma_pool_init();
+
 	return 0;
 }
 mmu_initcall(mmu_init);
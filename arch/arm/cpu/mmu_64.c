@@ -22,6 +22,8 @@
 
 #include "mmu_64.h"
 
+#define MAX_PTE_ENTRIES 512
+
 static uint64_t *get_ttb(void)
 {
 	return (uint64_t *)get_ttbr(current_el());
@@ -45,7 +47,11 @@ static uint64_t *alloc_pte(void)
 	if (idx * GRANULE_SIZE >= ARM_EARLY_PAGETABLE_SIZE)
 		return NULL;
 
-	return get_ttb() + idx * GRANULE_SIZE;
+	return (void *)get_ttb() + idx * GRANULE_SIZE;
+}
+
+static void free_table(uint64_t *table, int level)
+{
 }
 #else
 static uint64_t *alloc_pte(void)
@@ -57,6 +63,25 @@ static uint64_t *alloc_pte(void)
 
 	return new_table;
 }
+
+/* Frees a table which got replaced by a block mapping */
+static void free_table(uint64_t *table, int level)
+{
+	void *ttb = get_ttb();
+	int i;
+
+	/* Tables created in PBL live in the early page table area */
+	if ((void *)table >= ttb && (void *)table < ttb + ARM_EARLY_PAGETABLE_SIZE)
+		return;
+
+	if (level < 3) {
+		for (i = 0; i < MAX_PTE_ENTRIES; i++)
+			if (pte_type(&table[i]) == PTE_TYPE_TABLE)
+				free_table(get_level_table(&table[i]), level + 1);
+	}
+
+	free(table);
+}
 #endif
 
 static __maybe_unused uint64_t *find_pte(uint64_t addr)
@@ -82,8 +107,6 @@ static __maybe_unused uint64_t *find_pte(uint64_t addr)
 	return pte;
 }
 
-#define MAX_PTE_ENTRIES 512
-
 /* Splits a block PTE into table with subpages spanning the old block */
 static void split_block(uint64_t *pte, int level)
 {
@@ -140,9 +163,22 @@ static void create_sections(uint64_t virt, uint64_t phys, uint64_t size,
 
 			if (size >= block_size && IS_ALIGNED(addr, block_size) &&
 			    IS_ALIGNED(phys, block_size)) {
+				uint64_t old_pte = *pte;
+
 				type = (level == 3) ?
 					PTE_TYPE_PAGE : PTE_TYPE_BLOCK;
 				*pte = phys | attr | type;
+
+				/*
+				 * A former split of this block is no longer
+				 * needed. Make sure the walker is done with it
+				 * before freeing it.
+				 */
+				if (level < 3 && (old_pte & PTE_TYPE_MASK) == PTE_TYPE_TABLE) {
+					tlb_invalidate();
+					free_table((uint64_t *)(old_pte & XLAT_ADDR_MASK),
+						   level + 1);
+				}
 				addr += block_size;
 				phys += block_size;
 				size -= block_size;
@@ -0,0 +1,370 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * smp_64.c - run jobs on secondary cores
+ *
+ * Secondary cores are started with PSCI CPU_ON using the page tables of the
+ * boot CPU and then wait for jobs. Every core has its own mailbox: only the
+ * boot CPU puts a job into it and only the core itself clears it again
+ * once the job is done, so no locking is needed. The cores are switched
+ * off again before barebox shuts down.
+ */
+
+#define pr_fmt(fmt) "smp: " fmt
+
+#include <common.h>
+#include <clock.h>
+#include <init.h>
+#include <malloc.h>
+#include <of.h>
+#include <smp.h>
+#include <asm/cache.h>
+#include <asm/pgtable64.h>
+#include <asm/psci.h>
+#include <asm/system.h>
+#include <linux/sizes.h>
+
+#include "mmu_64.h"
+
+#define SMP_STACK_SIZE		SZ_16K
+#define SMP_MEMSET_MIN		SZ_1M
+#define SMP_JOB_PARK		((struct smp_job *)1)
+#define SMP_MPIDR_HWID_MASK	0xff00ffffffUL
+
+/* Layout is shared with smp_entry_64.S */
+struct smp_boot_data {
+	u64 ttbr;
+	u64 tcr;
+	u64 mair;
+	u64 sctlr;
+	u64 vbar;
+	u64 sp;
+	u64 arg;
+	u64 entry;
+};
+
+struct smp_worker {
+	struct smp_boot_data boot;
+	struct smp_job *job;
+	bool ready;
+	unsigned long hwid;
+	void *stack;
+};
+
+static struct smp_worker *smp_workers;
+static unsigned int smp_nr_workers;
+
+void smp_secondary_entry(void);
+
+static inline void smp_wfe(void)
+{
+	asm volatile("wfe" : : : "memory");
+}
+
+static inline void smp_sev(void)
+{
+	asm volatile("dsb ish\n\tsev" : : : "memory");
+}
+
+static inline void smp_dmb(void)
+{
+	asm volatile("dmb ish" : : : "memory");
+}
+
+static void __noreturn smp_worker_park(void)
+{
+	psci_invoke(ARM_PSCI_0_2_FN_CPU_OFF, 0, 0, 0, NULL);
+
+	/* Not reached unless CPU_OFF failed */
+	while (1)
+		smp_wfe();
+}
+
+static void __noreturn smp_worker_main(struct smp_worker *w)
+{
+	struct smp_job *job;
+
+	WRITE_ONCE(w->ready, true);
+	smp_sev();
+
+	while (1) {
+		while (!(job = READ_ONCE(w->job)))
+			smp_wfe();
+
+		smp_dmb();
+
+		if (job == SMP_JOB_PARK)
+			smp_worker_park();
+
+		/* pick up mappings the boot CPU changed in the meantime */
+		tlb_invalidate();
+
+		job->fn(job->arg);
+
+		smp_dmb();
+		WRITE_ONCE(job->done, true);
+		WRITE_ONCE(w->job, NULL);
+		smp_sev();
+	}
+}
+
+unsigned int smp_num_workers(void)
+{
+	return smp_nr_workers;
+}
+
+/**
+ * smp_job_queue - run a job on an idle secondary core
+ * @job: The job to run
+ *
+ * When all cores are busy, the job is run right away on the boot CPU.
+ * Either way smp_job_wait() must be called before looking at the results.
+ */
+void smp_job_queue(struct smp_job *job)
+{
+	int i;
+
+	job->done = false;
+
+	for (i = 0; i < smp_nr_workers; i++) {
+		struct smp_worker *w = &smp_workers[i];
+
+		if (READ_ONCE(w->job))
+			continue;
+
+		smp_dmb();
+		WRITE_ONCE(w->job, job);
+		smp_sev();
+
+		return;
+	}
+
+	job->fn(job->arg);
+	job->done = true;
+}
+
+/**
+ * smp_job_wait - wait for a job queued with smp_job_queue() to finish
+ * @job: The job to wait for
+ */
+void smp_job_wait(struct smp_job *job)
+{
+	while (!READ_ONCE(job->done))
+		smp_wfe();
+
+	smp_dmb();
+}
+
+struct smp_memset_job {
+	struct smp_job job;
+	void *s;
+	int c;
+	size_t n;
+};
+
+static void smp_memset_fn(void *arg)
+{
+	struct smp_memset_job *mj = arg;
+
+	memset(mj->s, mj->c, mj->n);
+}
+
+/**
+ * smp_memset - memset() split up between all cores
+ * @s: Start of the memory to fill
+ * @c: Value to fill with
+ * @n: Number of bytes to fill
+ */
+void smp_memset(void *s, int c, size_t n)
+{
+	struct smp_memset_job jobs[SMP_MAX_WORKERS];
+	size_t chunk;
+	int i;
+
+	if (!smp_nr_workers || n < SMP_MEMSET_MIN) {
+		memset(s, c, n);
+		return;
+	}
+
+	chunk = ALIGN(n / (smp_nr_workers + 1), SZ_4K);
+
+	for (i = 0; i < smp_nr_workers && n > chunk; i++) {
+		jobs[i].job.fn = smp_memset_fn;
+		jobs[i].job.arg = &jobs[i];
+		jobs[i].s = s;
+		jobs[i].c = c;
+		jobs[i].n = chunk;
+
+		smp_job_queue(&jobs[i].job);
+
+		s += chunk;
+		n -= chunk;
+	}
+
+	memset(s, c, n);
+
+	while (i--)
+		smp_job_wait(&jobs[i].job);
+}
+
+static void smp_fill_boot_data(struct smp_boot_data *boot)
+{
+	int el = current_el();
+
+	boot->ttbr = get_ttbr(el);
+	boot->sctlr = get_cr();
+
+	if (el == 1) {
+		asm volatile("mrs %0, tcr_el1" : "=r" (boot->tcr));
+		asm volatile("mrs %0, mair_el1" : "=r" (boot->mair));
+		asm volatile("mrs %0, vbar_el1" : "=r" (boot->vbar));
+	} else if (el == 2) {
+		asm volatile("mrs %0, tcr_el2" : "=r" (boot->tcr));
+		asm volatile("mrs %0, mair_el2" : "=r" (boot->mair));
+		asm volatile("mrs %0, vbar_el2" : "=r" (boot->vbar));
+	} else {
+		asm volatile("mrs %0, tcr_el3" : "=r" (boot->tcr));
+		asm volatile("mrs %0, mair_el3" : "=r" (boot->mair));
+		asm volatile("mrs %0, vbar_el3" : "=r" (boot->vbar));
+	}
+}
+
+static int smp_worker_start(struct smp_worker *w)
+{
+	struct smp_boot_data *boot = &w->boot;
+	uint64_t start;
+	int ret;
+
+	w->stack = memalign(16, SMP_STACK_SIZE);
+	if (!w->stack)
+		return -ENOMEM;
+
+	smp_fill_boot_data(boot);
+	boot->sp = (unsigned long)w->stack + SMP_STACK_SIZE;
+	boot->arg = (unsigned long)w;
+	boot->entry = (unsigned long)smp_worker_main;
+
+	/* read by the core with its caches still off */
+	v8_flush_dcache_range((unsigned long)w,
+			      (unsigned long)w + sizeof(*w));
+
+	ret = psci_invoke(ARM_PSCI_0_2_FN64_CPU_ON, w->hwid,
+			  (unsigned long)smp_secondary_entry,
+			  (unsigned long)boot, NULL);
+	if (ret)
+		goto err;
+
+	start = get_time_ns();
+	while (!READ_ONCE(w->ready)) {
+		if (is_timeout(start, 100 * MSECOND)) {
+			/*
+			 * The core may still show up, so keep its stack and
+			 * have it switch itself off again right away. It
+			 * may read the mailbox with its caches still off.
+			 */
+			WRITE_ONCE(w->job, SMP_JOB_PARK);
+			v8_flush_dcache_range((unsigned long)&w->job,
+					      (unsigned long)(&w->job + 1));
+			smp_sev();
+
+			pr_warn("core 0x%lx did not come up\n", w->hwid);
+			return -ETIMEDOUT;
+		}
+	}
+
+	return 0;
+err:
+	free(w->stack);
+	return ret;
+}
+
+static int smp_workers_init(void)
+{
+	struct device_node *cpus, *np;
+	unsigned long self = read_mpidr() & SMP_MPIDR_HWID_MASK;
+	int ret, n = 0;
+
+	BUILD_BUG_ON(offsetof(struct smp_boot_data, sp) != 40);
+	BUILD_BUG_ON(offsetof(struct smp_boot_data, entry) != 56);
+
+	if (current_el() == 3 || psci_get_version() < ARM_PSCI_VER(0, 2))
+		return 0;
+
+	cpus = of_find_node_by_path("/cpus");
+	if (!cpus)
+		return 0;
+
+	smp_workers = xzalloc(SMP_MAX_WORKERS * sizeof(*smp_workers));
+
+	for_each_child_of_node(cpus, np) {
+		struct smp_worker *w = &smp_workers[n];
+		const char *method;
+		const __be32 *reg;
+		int len;
+
+		if (n == SMP_MAX_WORKERS)
+			break;
+
+		if (!of_node_name_eq(np, "cpu") || !of_device_is_available(np))
+			continue;
+
+		if (of_property_read_string(np, "enable-method", &method) ||
+		    strcmp(method, "psci"))
+			continue;
+
+		reg = of_get_property(np, "reg", &len);
+		if (!reg)
+			continue;
+
+		w->hwid = of_read_number(reg, len / sizeof(*reg));
+		if (w->hwid == self)
+			continue;
+
+		ret = smp_worker_start(w);
+		/* a late core still owns this slot, so stop here */
+		if (ret == -ETIMEDOUT)
+			break;
+		if (ret) {
+			pr_debug("starting core 0x%lx failed: %pe\n", w->hwid,
+				 ERR_PTR(ret));
+			continue;
+		}
+
+		/* only publish the worker once it waits for jobs */
+		smp_nr_workers = ++n;
+	}
+
+	pr_info("%d secondary cores available\n", n);
+
+	return 0;
+}
+late_initcall(smp_workers_init);
+
+static void smp_workers_park(void)
+{
+	int i;
+
+	for (i = 0; i < smp_nr_workers; i++) {
+		struct smp_worker *w = &smp_workers[i];
+		uint64_t start = get_time_ns();
+		ulong state;
+
+		while (READ_ONCE(w->job))
+			smp_wfe();
+
+		WRITE_ONCE(w->job, SMP_JOB_PARK);
+		smp_sev();
+
+		do {
+			if (is_timeout(start, 100 * MSECOND)) {
+				pr_warn("core 0x%lx did not switch off\n", w->hwid);
+				break;
+			}
+
+			psci_invoke(ARM_PSCI_0_2_FN64_AFFINITY_INFO, w->hwid, 0,
+				    0, &state);
+		} while (state != PSCI_AFFINITY_LEVEL_OFF);
+	}
+
+	smp_nr_workers = 0;
+}
+predevshutdown_exitcall(smp_workers_park);
@@ -52,6 +52,15 @@ void __noreturn barebox_pbl_start(unsigned long membase, unsigned long memsize,
 	void *pg_start, *pg_end;
 	unsigned long pc = get_pc();
 
+	/*
+	 * Instruction fetches are cacheable even with the MMU still off, so
+	 * don't run relocation and setup with the instruction cache off.
+	 */
+	if (IS_ENABLED(CONFIG_CPU_64) && !(get_cr() & CR_I)) {
+		icache_invalidate();
+		set_cr(get_cr() | CR_I);
+	}
+
 	/* piggy data is not relocated, so determine the bounds now */
 	pg_start = runtime_address(input_data);
 	pg_end = runtime_address(input_data_end);
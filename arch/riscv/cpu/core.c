@@ -24,6 +24,8 @@
 #include <magicvar.h>
 #include <asm/system.h>
 #include <io.h>
+#include <linux/ctype.h>
+#include <asm/csr.h>
 
 static int riscv_request_stack(void)
 {
@@ -60,10 +62,59 @@ static int riscv_fixup_cpus(struct device_node *root, void *context)
 	return 0;
 }
 
+#ifdef CONFIG_RISCV_ISA_V
+bool riscv_vector_string;
+
+static bool riscv_isa_has_v(struct device_node *np)
+{
+	const char *isa;
+
+	if (of_property_match_string(np, "riscv,isa-extensions", "v") >= 0)
+		return true;
+
+	if (of_property_read_string(np, "riscv,isa", &isa) ||
+	    (strncasecmp(isa, "rv32", 4) && strncasecmp(isa, "rv64", 4)))
+		return false;
+
+	/* single letter extensions come before the first underscore */
+	for (isa += 4; *isa && *isa != '_'; isa++)
+		if (tolower(*isa) == 'v')
+			return true;
+
+	return false;
+}
+
+static void riscv_probe_vector(struct device_node *np)
+{
+	long boot_hart;
+	u32 reg;
+
+	if (IS_ENABLED(CONFIG_RISCV_M_MODE))
+		boot_hart = csr_read(CSR_MHARTID);
+	else
+		boot_hart = riscv_hartid();
+
+	if (of_property_read_u32(np, "reg", &reg) || reg != boot_hart)
+		return;
+
+	if (!riscv_isa_has_v(np))
+		return;
+
+	csr_set(CSR_STATUS, SR_VS_INITIAL);
+	riscv_vector_string = true;
+}
+#else
+static inline void riscv_probe_vector(struct device_node *np)
+{
+}
+#endif
+
 static int riscv_probe(struct device *parent)
 {
 	int ret;
 
+	riscv_probe_vector(parent->of_node);
+
 	/* Each hart has a timer, but we only need one */
 	if (IS_ENABLED(CONFIG_RISCV_TIMER) && !timer_dev.parent) {
 		timer_dev.id = DEVICE_ID_SINGLE;
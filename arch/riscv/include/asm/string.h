@@ -11,6 +11,11 @@ extern void *memset(void *, int, __kernel_size_t);
 #define __HAVE_ARCH_MEMMOVE
 extern void *memmove(void *, const void *, __kernel_size_t);
 
+#ifdef CONFIG_RISCV_ISA_V
+/* set once the boot hart is known to implement the vector extension */
+extern bool riscv_vector_string;
+#endif
+
 #endif
 
 extern void *__memcpy(void *, const void *, __kernel_size_t);
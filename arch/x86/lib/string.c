@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * String functions using the x86 string instructions. On CPUs with
+ * "Enhanced REP MOVSB/STOSB" (ERMS, all Intel since Ivy Bridge and AMD
+ * since Zen 3) these are the fastest way to copy and fill memory of any
+ * alignment, and they are still correct and reasonably fast elsewhere.
+ */
+
+#include <linux/types.h>
+#include <linux/string.h>
+
+void *__memcpy(void *dest, const void *src, size_t count)
+{
+	void *ret = dest;
+
+	asm volatile("rep movsb"
+		     : "+D" (dest), "+S" (src), "+c" (count)
+		     : : "memory");
+
+	return ret;
+}
+void *memcpy(void *dest, const void *src, size_t count)
+	__alias(__memcpy);
+
+void *__memset(void *s, int c, size_t count)
+{
+	void *ret = s;
+
+	asm volatile("rep stosb"
+		     : "+D" (s), "+c" (count)
+		     : "a" (c) : "memory");
+
+	return ret;
+}
+void *memset(void *s, int c, size_t count)
+	__alias(__memset);
+
+void *memmove(void *dest, const void *src, size_t count)
+{
+	void *ret = dest;
+
+	if (dest <= src || dest >= src + count)
+		return __memcpy(dest, src, count);
+
+	/* overlapping with dest above src: copy backwards */
+	dest += count - 1;
+	src += count - 1;
+
+	asm volatile("std\n\t"
+		     "rep movsb\n\t"
+		     "cld"
+		     : "+D" (dest), "+S" (src), "+c" (count)
+		     : : "memory");
+
+	return ret;
+}
@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+/* bootcache.c - show or clear the boot cache */
+
+#include <common.h>
+#include <command.h>
+#include <bootcache.h>
+#include <getopt.h>
+
+static int do_bootcache(int argc, char *argv[])
+{
+	int opt;
+
+	while ((opt = getopt(argc, argv, "c")) > 0) {
+		switch (opt) {
+		case 'c':
+			bootcache_clear();
+			return 0;
+		default:
+			return COMMAND_ERROR_USAGE;
+		}
+	}
+
+	bootcache_info();
+
+	return 0;
+}
+
+BAREBOX_CMD_HELP_START(bootcache)
+BAREBOX_CMD_HELP_TEXT("List the records kept in the boot cache across warm reboots.")
+BAREBOX_CMD_HELP_TEXT("")
+BAREBOX_CMD_HELP_TEXT("Options:")
+BAREBOX_CMD_HELP_OPT ("-c", "clear the boot cache")
+BAREBOX_CMD_HELP_END
+
+BAREBOX_CMD_START(bootcache)
+	.cmd	= do_bootcache,
+	BAREBOX_CMD_DESC("show or clear the boot cache")
+	BAREBOX_CMD_OPTS("[-c]")
+	BAREBOX_CMD_GROUP(CMD_GRP_INFO)
+	BAREBOX_CMD_HELP(cmd_bootcache_help)
+BAREBOX_CMD_END
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+/* boottrace.c - export the boot time trace */
+
+#include <common.h>
+#include <command.h>
+#include <boottrace.h>
+#include <fcntl.h>
+#include <fs.h>
+#include <getopt.h>
+
+static int do_boottrace(int argc, char *argv[])
+{
+	const char *filename = NULL;
+	int opt, fd, ret;
+	bool clear = false;
+
+	while ((opt = getopt(argc, argv, "co:")) > 0) {
+		switch (opt) {
+		case 'c':
+			clear = true;
+			break;
+		case 'o':
+			filename = optarg;
+			break;
+		default:
+			return COMMAND_ERROR_USAGE;
+		}
+	}
+
+	if (clear && !filename) {
+		boottrace_clear();
+		return 0;
+	}
+
+	if (filename) {
+		fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC);
+		if (fd < 0) {
+			printf("could not open %s: %m\n", filename);
+			return COMMAND_ERROR;
+		}
+	} else {
+		fd = STDOUT_FILENO;
+	}
+
+	ret = boottrace_dump_json(fd);
+
+	if (filename)
+		close(fd);
+
+	if (clear)
+		boottrace_clear();
+
+	return ret ? COMMAND_ERROR : COMMAND_SUCCESS;
+}
+
+BAREBOX_CMD_HELP_START(boottrace)
+BAREBOX_CMD_HELP_TEXT("Print the recorded initcall, probe, mount, bootm and FIT")
+BAREBOX_CMD_HELP_TEXT("spans in Chrome trace / Perfetto JSON format.")
+BAREBOX_CMD_HELP_TEXT("")
+BAREBOX_CMD_HELP_TEXT("Options:")
+BAREBOX_CMD_HELP_OPT ("-o FILE", "write trace to FILE instead of the console")
+BAREBOX_CMD_HELP_OPT ("-c",      "clear the trace buffer (after writing it with -o)")
+BAREBOX_CMD_HELP_END
+
+BAREBOX_CMD_START(boottrace)
+	.cmd	= do_boottrace,
+	BAREBOX_CMD_DESC("export boot time trace")
+	BAREBOX_CMD_OPTS("[-c] [-o FILE]")
+	BAREBOX_CMD_GROUP(CMD_GRP_INFO)
+	BAREBOX_CMD_HELP(cmd_boottrace_help)
+BAREBOX_CMD_END
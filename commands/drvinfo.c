@@ -5,11 +5,84 @@
 #include <common.h>
 #include <command.h>
 #include <driver.h>
+#include <getopt.h>
+#include <malloc.h>
+#include <of.h>
+#include <qsort.h>
+
+static int compare_probe_order(const void *a, const void *b)
+{
+	const struct device *deva = *(const struct device **)a;
+	const struct device *devb = *(const struct device **)b;
+
+	/* devices not probed (yet) go last */
+	if (deva->probe_order - 1 < devb->probe_order - 1)
+		return -1;
+	if (deva->probe_order - 1 > devb->probe_order - 1)
+		return 1;
+	return 0;
+}
+
+static void drvinfo_probe_order(void)
+{
+	struct device **devs, *dev;
+	u64 deferred_ns = 0;
+	int i, n = 0;
+
+	for_each_device(dev)
+		n++;
+
+	devs = xmalloc(n * sizeof(*devs));
+
+	n = 0;
+	for_each_device(dev)
+		if (dev->probe_order || dev->deferrals)
+			devs[n++] = dev;
+
+	qsort(devs, n, sizeof(*devs), compare_probe_order);
+
+	printf("order  probe/us  deferrals  deferred/us  device\n");
+
+	for (i = 0; i < n; i++) {
+		dev = devs[i];
+
+		if (dev->probe_order)
+			printf("%5u %9llu", dev->probe_order,
+			       dev->probe_ns / 1000);
+		else
+			printf("%5s %9s", "-", "-");
+
+		printf(" %10u %12llu  %s", dev->deferrals,
+		       dev->deferred_ns / 1000, dev_name(dev));
+
+		if (!dev->probe_order && dev->deferred_supplier)
+			printf(" (waiting for %pOF)", dev->deferred_supplier);
+
+		printf("\n");
+
+		deferred_ns += dev->deferred_ns;
+	}
+
+	printf("\n%llu us spent in deferred probes\n", deferred_ns / 1000);
+
+	free(devs);
+}
 
 static int do_drvinfo(int argc, char *argv[])
 {
 	struct driver *drv;
 	struct device *dev;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d")) > 0) {
+		switch (opt) {
+		case 'd':
+			drvinfo_probe_order();
+			return 0;
+		default:
+			return COMMAND_ERROR_USAGE;
+		}
+	}
 
 	printf("Driver\tDevice(s)\n");
 	printf("--------------------\n");
@@ -27,9 +100,17 @@ static int do_drvinfo(int argc, char *argv[])
 	return 0;
 }
 
+BAREBOX_CMD_HELP_START(drvinfo)
+BAREBOX_CMD_HELP_TEXT("List the compiled-in drivers and the devices bound to them.")
+BAREBOX_CMD_HELP_TEXT("")
+BAREBOX_CMD_HELP_TEXT("Options:")
+BAREBOX_CMD_HELP_OPT ("-d", "show probe order, probe times and time spent in deferred probes")
+BAREBOX_CMD_HELP_END
 
 BAREBOX_CMD_START(drvinfo)
 	.cmd		= do_drvinfo,
 	BAREBOX_CMD_DESC("list compiled-in device drivers")
+	BAREBOX_CMD_OPTS("[-d]")
 	BAREBOX_CMD_GROUP(CMD_GRP_INFO)
+	BAREBOX_CMD_HELP(cmd_drvinfo_help)
 BAREBOX_CMD_END
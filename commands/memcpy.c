@@ -19,6 +19,111 @@
 #include <getopt.h>
 #include <linux/stat.h>
 #include <xfuncs.h>
+#include <clock.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
+
+static const size_t memcpy_bench_sizes[] = {
+	64, SZ_4K, SZ_64K, SZ_1M, SZ_16M,
+};
+
+static const struct {
+	unsigned int dst, src;
+} memcpy_bench_align[] = {
+	{ 0, 0 }, { 0, 1 }, { 3, 0 },
+};
+
+/* copy or fill for about 100ms and return the throughput in MB/s */
+static u64 memcpy_bench_one(void *dst, void *src, size_t size, bool set)
+{
+	/* read the clock only every 64k, so small sizes don't time the clock */
+	unsigned int i, reps = max_t(size_t, SZ_64K / size, 1);
+	u64 start = get_time_ns(), ns;
+	u64 bytes = 0;
+
+	do {
+		for (i = 0; i < reps; i++) {
+			if (set)
+				memset(dst, 0x5a, size);
+			else
+				memcpy(dst, src, size);
+		}
+		bytes += (u64)size * reps;
+		ns = get_time_ns() - start;
+	} while (ns < 100 * MSECOND);
+
+	return div64_u64(bytes * 1000, ns);
+}
+
+static void memcpy_bench_print(u64 mbs)
+{
+	printf(" %4llu.%03llu", mbs / 1000, mbs % 1000);
+}
+
+static int memcpy_benchmark(void)
+{
+	void *src, *dst;
+	int i, j;
+
+	src = malloc(SZ_16M + 64);
+	dst = malloc(SZ_16M + 64);
+	if (!src || !dst) {
+		printf("out of memory\n");
+		free(src);
+		free(dst);
+		return 1;
+	}
+
+	memset(src, 0xa5, SZ_16M + 64);
+
+	printf("GB/s      memcpy dst/src offset      memset\n");
+	printf("%8s", "size");
+	for (j = 0; j < ARRAY_SIZE(memcpy_bench_align); j++)
+		printf("   %u/%u   ", memcpy_bench_align[j].dst,
+		       memcpy_bench_align[j].src);
+	printf("\n");
+
+	for (i = 0; i < ARRAY_SIZE(memcpy_bench_sizes); i++) {
+		size_t size = memcpy_bench_sizes[i];
+
+		printf("%8s", size_human_readable(size));
+
+		for (j = 0; j < ARRAY_SIZE(memcpy_bench_align); j++)
+			memcpy_bench_print(memcpy_bench_one(dst + memcpy_bench_align[j].dst,
+							    src + memcpy_bench_align[j].src,
+							    size, false));
+
+		memcpy_bench_print(memcpy_bench_one(dst, NULL, size, true));
+		printf("\n");
+
+		if (ctrlc())
+			break;
+	}
+
+	free(src);
+	free(dst);
+
+	return 0;
+}
+
+static bool memcpy_want_benchmark(int argc, char *argv[])
+{
+	struct getopt_context gc;
+	bool bench = false;
+	int opt;
+
+	/* memcpy_parse_options() parses the options again from the start */
+	getopt_context_store(&gc);
+	opterr = 0;
+
+	while ((opt = getopt(argc, argv, "bwlqs:d:B")) > 0)
+		if (opt == 'B')
+			bench = true;
+
+	getopt_context_restore(&gc);
+
+	return bench;
+}
 
 static int do_memcpy(int argc, char *argv[])
 {
@@ -27,6 +132,9 @@ static int do_memcpy(int argc, char *argv[])
 	int ret = 0;
 	char *buf;
 
+	if (memcpy_want_benchmark(argc, argv))
+		return memcpy_benchmark();
+
 	if (memcpy_parse_options(argc, argv, &sourcefd, &destfd, &count,
 				 0, O_WRONLY | O_CREAT) < 0)
 		return 1;
@@ -75,6 +183,8 @@ BAREBOX_CMD_HELP_START(memcpy)
 BAREBOX_CMD_HELP_TEXT("Copy memory of COUNT bytes from offsets SRC to DEST.")
 BAREBOX_CMD_HELP_TEXT("If source is a file, COUNT can be left unspecified")
 BAREBOX_CMD_HELP_TEXT("in which case the whole file is copied.")
+BAREBOX_CMD_HELP_TEXT("With -B, the throughput of memcpy and memset is measured")
+BAREBOX_CMD_HELP_TEXT("for several sizes and alignments instead.")
 BAREBOX_CMD_HELP_TEXT("")
 BAREBOX_CMD_HELP_TEXT("Options:")
 BAREBOX_CMD_HELP_OPT ("-b", "byte access")
@@ -83,12 +193,13 @@ BAREBOX_CMD_HELP_OPT ("-l", "long access (32 bit)")
 BAREBOX_CMD_HELP_OPT ("-q", "quad access (64 bit)")
 BAREBOX_CMD_HELP_OPT ("-s FILE", "source file (default /dev/mem)")
 BAREBOX_CMD_HELP_OPT ("-d FILE", "write file (default /dev/mem)")
+BAREBOX_CMD_HELP_OPT ("-B", "benchmark memcpy/memset")
 BAREBOX_CMD_HELP_END
 
 BAREBOX_CMD_START(memcpy)
 	.cmd		= do_memcpy,
 	BAREBOX_CMD_DESC("memory copy")
-	BAREBOX_CMD_OPTS("[-bwlq] [-s FILE] [-d FILE] SRC DEST COUNT")
+	BAREBOX_CMD_OPTS("[-bwlq] [-s FILE] [-d FILE] SRC DEST COUNT | -B")
 	BAREBOX_CMD_GROUP(CMD_GRP_MEM)
 	BAREBOX_CMD_HELP(cmd_memcpy_help)
 BAREBOX_CMD_END
@@ -14,6 +14,8 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <progress.h>
+#include <clock.h>
+#include <linux/math64.h>
 
 /* Max ECC Bits that can be corrected */
 #define MAX_ECC_BITS 8
@@ -197,10 +199,104 @@ static void print_stats(int nr_passes, loff_t length)
 	printf("-------------------------\n");
 }
 
+static void print_bench(const char *what, unsigned int pages,
+			unsigned int pagesize, uint64_t ns)
+{
+	uint64_t us = max_t(uint64_t, div_u64(ns, 1000), 1);
+
+	printf("%s: %u pages in %llu us, %llu KiB/s\n", what, pages, us,
+	       div64_u64((uint64_t)pages * pagesize * 1000000, us * 1024));
+}
+
+/*
+ * Read the test area once through the ECC protected device and once through
+ * its raw counterpart. The raw read only accounts for the bus transfer, so
+ * the difference between both is the time spent for ECC calculation and
+ * correction.
+ */
+static int read_benchmark(const char *devname, loff_t flash_offset,
+			  loff_t length)
+{
+	unsigned int ppb = meminfo.erasesize / meminfo.writesize;
+	unsigned int rps = meminfo.writesize + meminfo.oobsize;
+	unsigned int pages = 0;
+	uint64_t start, ecc_ns = 0, raw_ns = 0;
+	unsigned char *buf;
+	char *rawname;
+	loff_t ofs;
+	int rawfd, ret = 0;
+
+	buf = malloc(ppb * rps);
+	if (!buf)
+		return -ENOMEM;
+
+	rawname = basprintf("%s.raw", devname);
+	rawfd = open(rawname, O_RDONLY);
+	if (rawfd < 0)
+		printf("No raw device %s, cannot measure bus time\n", rawname);
+
+	for (ofs = flash_offset; ofs < flash_offset + length;
+	     ofs += meminfo.erasesize) {
+		loff_t rawofs = div_u64(ofs, meminfo.writesize) * rps;
+
+		if (ioctl(fd, MEMGETBADBLOCK, &ofs))
+			continue;
+
+		start = get_time_ns();
+		ret = pread(fd, buf, meminfo.erasesize, ofs);
+		ecc_ns += get_time_ns() - start;
+		if (ret < 0) {
+			perror("pread");
+			goto out;
+		}
+
+		if (rawfd >= 0) {
+			start = get_time_ns();
+			ret = pread(rawfd, buf, ppb * rps, rawofs);
+			raw_ns += get_time_ns() - start;
+			if (ret < 0) {
+				perror("pread raw");
+				goto out;
+			}
+		}
+
+		pages += ppb;
+
+		if (ctrlc()) {
+			ret = -EINTR;
+			goto out;
+		}
+	}
+
+	ret = 0;
+
+	if (!pages) {
+		printf("No good blocks in test area\n");
+		goto out;
+	}
+
+	print_bench("ECC read", pages, meminfo.writesize, ecc_ns);
+
+	if (rawfd < 0)
+		goto out;
+
+	print_bench("Raw read", pages, rps, raw_ns);
+	printf("ECC time: %llu ns/page\n", ecc_ns > raw_ns ?
+	       div_u64(ecc_ns - raw_ns, pages) : 0);
+out:
+	if (rawfd >= 0)
+		close(rawfd);
+	free(rawname);
+	free(buf);
+
+	return ret;
+}
+
 /* Main program. */
 static int do_nandtest(int argc, char *argv[])
 {
 	int opt, do_nandtest_dev = -1, do_nandtest_ro = 0, ret = -1;
+	int do_bench = 0;
 	loff_t flash_offset = 0, test_ofs, length = 0;
 	unsigned int nr_iterations = 1, iter;
 	unsigned char *wbuf, *rbuf;
@@ -212,7 +308,7 @@ static int do_nandtest(int argc, char *argv[])
 
 	memset(ecc_stats, 0, sizeof(*ecc_stats));
 
-	while ((opt = getopt(argc, argv, "ms:i:o:l:tr")) > 0) {
+	while ((opt = getopt(argc, argv, "ms:i:o:l:trb")) > 0) {
 		switch (opt) {
 		case 'm':
 			markbad = 1;
@@ -236,6 +332,10 @@ static int do_nandtest(int argc, char *argv[])
 			do_nandtest_dev = 1;
 			do_nandtest_ro = 1;
 			break;
+		case 'b':
+			do_nandtest_dev = 1;
+			do_bench = 1;
+			break;
 		default:
 			return COMMAND_ERROR_USAGE;
 		}
@@ -246,7 +346,7 @@ static int do_nandtest(int argc, char *argv[])
 		return COMMAND_ERROR_USAGE;
 
 	if (do_nandtest_dev == -1) {
-		printf("Please add -t or -r parameter to start nandtest.\n");
+		printf("Please add -t, -r or -b parameter to start nandtest.\n");
 		return 0;
 	}
 
@@ -315,6 +415,14 @@ static int do_nandtest(int argc, char *argv[])
 		goto err;
 	}
 
+	if (do_bench) {
+		ret = read_benchmark(argv[optind], flash_offset, length);
+		if (ret)
+			goto err;
+		close(fd);
+		return 0;
+	}
+
 	wbuf = malloc(meminfo.erasesize * 2);
 	if (!wbuf) {
 		printf("Could not allocate %d bytes for buffer\n",
@@ -376,6 +484,7 @@ BAREBOX_CMD_HELP_START(nandtest)
 BAREBOX_CMD_HELP_TEXT("Options:")
 BAREBOX_CMD_HELP_OPT ("-t",  "Really do a nandtest on device")
 BAREBOX_CMD_HELP_OPT ("-r",  "Readonly nandtest on device")
+BAREBOX_CMD_HELP_OPT ("-b",  "Benchmark reads, report ECC time separately from bus time")
 BAREBOX_CMD_HELP_OPT ("-m",  "Mark blocks bad if they appear so")
 BAREBOX_CMD_HELP_OPT ("-s SEED",   "supply random seed")
 BAREBOX_CMD_HELP_OPT ("-i ITERATIONS",  "nNumber of iterations")
@@ -386,7 +495,7 @@ BAREBOX_CMD_HELP_END
 BAREBOX_CMD_START(nandtest)
 	.cmd		= do_nandtest,
 	BAREBOX_CMD_DESC("NAND flash memory test")
-	BAREBOX_CMD_OPTS("[-tmsiol] NANDDEVICE")
+	BAREBOX_CMD_OPTS("[-tmsiolrb] NANDDEVICE")
 	BAREBOX_CMD_GROUP(CMD_GRP_HWMANIP)
 	BAREBOX_CMD_HELP(cmd_nandtest_help)
 BAREBOX_CMD_END
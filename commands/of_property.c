@@ -244,31 +244,17 @@ static int do_of_property_set_now(struct device_node *root, const char *path,
 		const char *propname, void *data, int len)
 {
 	struct device_node *node = of_find_node_by_path_or_alias(root, path);
-	struct property *pp;
+	int ret;
 
 	if (!node) {
 		printf("Cannot find nodepath %s\n", path);
 		return -ENOENT;
 	}
 
-	pp = of_find_property(node, propname, NULL);
-
-	if (pp) {
-		free(pp->value);
-		pp->value_const = NULL;
-
-		if (len)
-			pp->value = xmemdup(data, len);
-		else
-			pp->value = NULL;
-
-		pp->length = len;
-	} else {
-		pp = of_new_property(node, propname, data, len);
-		if (!pp) {
-			printf("Cannot create property %s\n", propname);
-			return -ENOMEM;
-		}
+	ret = of_set_property(node, propname, data, len, 1);
+	if (ret) {
+		printf("Cannot set property %s: %pe\n", propname, ERR_PTR(ret));
+		return ret;
 	}
 
 	return 0;
@@ -33,12 +33,13 @@ static int do_oftree(int argc, char *argv[])
 	struct fdt_header *fdt = NULL;
 	int opt;
 	int probe = 0;
+	int stats = 0;
 	char *load = NULL;
 	char *save = NULL;
 	int ret;
 	struct device_node *root;
 
-	while ((opt = getopt(argc, argv, "pfl:s:")) > 0) {
+	while ((opt = getopt(argc, argv, "pfl:s:S")) > 0) {
 		switch (opt) {
 		case 'l':
 			load = optarg;
@@ -54,12 +55,21 @@ static int do_oftree(int argc, char *argv[])
 		case 's':
 			save = optarg;
 			break;
+		case 'S':
+			stats = 1;
+			break;
 		}
 	}
 
-	if (!probe && !load && !save)
+	if (!probe && !load && !save && !stats)
 		return COMMAND_ERROR_USAGE;
 
+	if (stats) {
+		of_print_lookup_stats();
+		if (!probe && !load && !save)
+			return 0;
+	}
+
 	if (save) {
 		fdt = of_get_fixed_tree(NULL);
 		if (!fdt) {
@@ -106,12 +116,13 @@ BAREBOX_CMD_HELP_TEXT("Options:")
 BAREBOX_CMD_HELP_OPT ("-l <DTB>",  "Load <DTB> to internal devicetree")
 BAREBOX_CMD_HELP_OPT ("-s <DTB>",  "save internal devicetree to <DTB>")
 BAREBOX_CMD_HELP_OPT ("-p",  "probe devices from stored device tree")
+BAREBOX_CMD_HELP_OPT ("-S",  "show devicetree lookup index statistics")
 BAREBOX_CMD_HELP_END
 
 BAREBOX_CMD_START(oftree)
 	.cmd		= do_oftree,
 	BAREBOX_CMD_DESC("handle device trees")
-	BAREBOX_CMD_OPTS("[-lsp]")
+	BAREBOX_CMD_OPTS("[-lspS]")
 	BAREBOX_CMD_GROUP(CMD_GRP_MISC)
 	BAREBOX_CMD_HELP(cmd_oftree_help)
 BAREBOX_CMD_END
@@ -19,6 +19,7 @@
 #include <net.h>
 #include <fs.h>
 #include <of.h>
+#include <bthread.h>
 #include <linux/stat.h>
 #include <linux/err.h>
 #include <mtd/ubi-user.h>
@@ -504,8 +505,14 @@ static bool entry_is_match_machine_id(struct blspec_entry *entry)
 	return ret;
 }
 
-int blspec_scan_file(struct bootentries *bootentries, const char *root,
-		     const char *configname)
+/*
+ * __blspec_scan_file - add an entry from a config file
+ *
+ * @compatible is the cached result of the devicetree compatibility check
+ * of this entry, -1 if unknown. It is updated when the check is done.
+ */
+static int __blspec_scan_file(struct bootentries *bootentries, const char *root,
+			      const char *configname, int *compatible)
 {
 	char *devname = NULL, *hwdevname = NULL;
 	struct blspec_entry *entry;
@@ -522,7 +529,10 @@ int blspec_scan_file(struct bootentries *bootentries, const char *root,
 	entry->configpath = xstrdup(configname);
 	entry->cdev = get_cdev_by_mountpath(root);
 
-	if (!entry_is_of_compatible(entry)) {
+	if (*compatible < 0)
+		*compatible = entry_is_of_compatible(entry);
+
+	if (!*compatible) {
 		blspec_entry_free(&entry->entry);
 		return -ENODEV;
 	}
@@ -553,6 +563,125 @@ int blspec_scan_file(struct bootentries *bootentries, const char *root,
 	return 1;
 }
 
+int blspec_scan_file(struct bootentries *bootentries, const char *root,
+		     const char *configname)
+{
+	int compatible = -1;
+
+	return __blspec_scan_file(bootentries, root, configname, &compatible);
+}
+
+/*
+ * Scanning a directory globs for the entries and reads the devicetree of
+ * each of them to check it's compatible. The result is cached per directory
+ * and generation of the filesystem, so that repeated scans, e.g. by
+ * bootchooser retries or menu rebuilds, of an unmodified filesystem only
+ * parse the entries again. The compatibility checks are redone when the
+ * compatible of the barebox devicetree changes, e.g. by oftree -l.
+ */
+struct blspec_cached_config {
+	char *path;
+	int compatible;
+};
+
+struct blspec_dir_cache {
+	struct list_head list;
+	char *root;
+	struct fs_device *fsdev;
+	unsigned int generation;
+	char *compat;		/* barebox compatible the configs were checked against */
+	int num_configs;
+	struct blspec_cached_config *configs;
+};
+
+/*
+ * The compatible entries are checked against, "" if the barebox devicetree
+ * has none and NULL if there is no devicetree at all.
+ */
+static const char *blspec_barebox_compatible(void)
+{
+	struct device_node *root;
+	const char *compat;
+
+	root = of_get_root_node();
+	if (!root)
+		return NULL;
+
+	if (of_property_read_string(root, "compatible", &compat))
+		return "";
+
+	return compat;
+}
+
+static LIST_HEAD(blspec_dir_caches);
+
+static void blspec_dir_cache_free(struct blspec_dir_cache *cache)
+{
+	int i;
+
+	list_del(&cache->list);
+
+	for (i = 0; i < cache->num_configs; i++)
+		free(cache->configs[i].path);
+
+	free(cache->configs);
+	free(cache->compat);
+	free(cache->root);
+	free(cache);
+}
+
+static struct blspec_dir_cache *blspec_dir_cache_get(const char *root,
+						     struct fs_device *fsdev)
+{
+	struct blspec_dir_cache *cache;
+	const char *compat;
+	int i;
+
+	list_for_each_entry(cache, &blspec_dir_caches, list) {
+		if (strcmp(cache->root, root))
+			continue;
+
+		if (cache->fsdev != fsdev || cache->generation != fsdev->generation) {
+			blspec_dir_cache_free(cache);
+			return NULL;
+		}
+
+		compat = blspec_barebox_compatible();
+		if (cache->compat == compat ||
+		    (cache->compat && compat && !strcmp(cache->compat, compat)))
+			return cache;
+
+		for (i = 0; i < cache->num_configs; i++)
+			cache->configs[i].compatible = -1;
+
+		free(cache->compat);
+		cache->compat = xstrdup(compat);
+
+		return cache;
+	}
+
+	return NULL;
+}
+
+static int blspec_scan_dir_cache(struct bootentries *bootentries,
+				 struct blspec_dir_cache *cache)
+{
+	int i, ret, found = 0;
+
+	pr_debug("%s: %s\n", __func__, cache->root);
+
+	for (i = 0; i < cache->num_configs; i++) {
+		struct blspec_cached_config *config = &cache->configs[i];
+
+		ret = __blspec_scan_file(bootentries, cache->root, config->path,
+					 &config->compatible);
+		if (ret > 0)
+			found += ret;
+	}
+
+	return found;
+}
+
 /*
  * blspec_scan_directory - scan over a directory
  *
@@ -566,30 +695,74 @@ int blspec_scan_directory(struct bootentries *bootentries, const char *root)
 	char *abspath;
 	int ret, found = 0;
 	const char *dirname = "loader/entries";
+	struct blspec_dir_cache *cache = NULL;
+	struct fs_device *fsdev;
 	int i;
 
+	/*
+	 * The content of network filesystems can change without us noticing,
+	 * so they are not cached.
+	 */
+	fsdev = get_fsdevice_by_path(root);
+	if (fsdev && fsdev->driver->flags & FS_DRIVER_REMOTE)
+		fsdev = NULL;
+
+	if (fsdev) {
+		cache = blspec_dir_cache_get(root, fsdev);
+		if (cache)
+			return blspec_scan_dir_cache(bootentries, cache);
+	}
+
 	pr_debug("%s: %s %s\n", __func__, root, dirname);
 
 	abspath = basprintf("%s/%s/*.conf", root, dirname);
 
 	ret = glob(abspath, 0, NULL, &globb);
-	if (ret) {
+	if (ret && ret != GLOB_NOMATCH) {
 		pr_debug("%s: %s: %s\n", __func__, abspath, strerror(errno));
 		ret = -errno;
 		goto err_out;
 	}
 
+	if (fsdev) {
+		/* no entries is a result worth caching as well */
+		cache = xzalloc(sizeof(*cache));
+		cache->root = xstrdup(root);
+		cache->fsdev = fsdev;
+		cache->generation = fsdev->generation;
+		cache->compat = xstrdup(blspec_barebox_compatible());
+		list_add(&cache->list, &blspec_dir_caches);
+	}
+
+	if (ret) {
+		pr_debug("%s: %s: no entries\n", __func__, abspath);
+		ret = -ENOENT;
+		goto err_out;
+	}
+
+	if (cache)
+		cache->configs = xzalloc(globb.gl_pathc * sizeof(*cache->configs));
+
 	for (i = 0; i < globb.gl_pathc; i++) {
 		const char *configname = globb.gl_pathv[i];
+		int compatible = -1;
 		struct stat s;
 
 		ret = stat(configname, &s);
 		if (ret || !S_ISREG(s.st_mode))
 			continue;
 
-		ret = blspec_scan_file(bootentries, root, configname);
+		ret = __blspec_scan_file(bootentries, root, configname, &compatible);
 		if (ret > 0)
 			found += ret;
+
+		if (cache) {
+			struct blspec_cached_config *config;
+
+			config = &cache->configs[cache->num_configs++];
+			config->path = xstrdup(configname);
+			config->compatible = compatible;
+		}
 	}
 
 	ret = found;
@@ -677,6 +850,132 @@ static int blspec_scan_cdev(struct bootentries *bootentries, struct cdev *cdev)
 	return found;
 }
 
+#define GPT_XBOOTLDR_TYPE_UUID	"bc13c2ff-59e6-4262-a352-b275fd6f7172"
+#define GPT_ESP_TYPE_UUID	"c12a7328-f81f-11d2-ba4b-00a0c93ec93b"
+
+static bool cdev_is_xbootldr(struct cdev *cdev)
+{
+	return cdev->dos_partition_type == 0xea ||
+		!strcasecmp(cdev->typeuuid, GPT_XBOOTLDR_TYPE_UUID);
+}
+
+static bool cdev_is_esp(struct cdev *cdev)
+{
+	return cdev->dos_partition_type == 0xef ||
+		!strcasecmp(cdev->typeuuid, GPT_ESP_TYPE_UUID);
+}
+
+/*
+ * blspec_scan_boot_partitions - scan the $BOOT partitions of a device
+ *
+ * If the OS is installed on a disk with an EFI system partition, i.e. MBR
+ * type id 0xef or GPT type GUID c12a7328-f81f-11d2-ba4b-00a0c93ec93b, or
+ * a partition of type XBOOTLDR, i.e. MBR type id 0xea or GPT type GUID
+ * bc13c2ff-59e6-4262-a352-b275fd6f7172, these are used as $BOOT and no
+ * other partitions are scanned.
+ *
+ * Returns the number of entries found, -ENOENT if there are boot partitions
+ * without entries and 0 if there are none and the other partitions should
+ * be tried instead.
+ */
+static int blspec_scan_boot_partitions(struct bootentries *bootentries,
+				       struct device *dev)
+{
+	struct cdev *cdev;
+	bool boot = false;
+	int ret, found = 0;
+
+	list_for_each_entry(cdev, &dev->cdevs, devices_list) {
+		if (!cdev_is_xbootldr(cdev) && !cdev_is_esp(cdev))
+			continue;
+
+		boot = true;
+
+		ret = blspec_scan_cdev(bootentries, cdev);
+		if (ret > 0)
+			found += ret;
+	}
+
+	if (boot)
+		return found ?: -ENOENT;
+
+	return 0;
+}
+
+static void blspec_detect_thread(void *data)
+{
+	device_detect(data);
+}
+
+/* true if @dev or one of its parents is detected in a bthread */
+static bool blspec_detect_in_thread(struct device *dev)
+{
+	for (; dev; dev = dev->parent) {
+		if (!dev->detect_parallel || !dev->detect)
+			continue;
+		if (dev->parent && dev->parent->detect)
+			continue;
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * blspec_detect_devices - detect all devices
+ *
+ * With CONFIG_BLSPEC_PARALLEL_DETECT every device marked with detect_parallel,
+ * like MCI and USB host controllers, that has no parent with a detect callback
+ * is detected in its own bthread, so that slow devices like USB or SD cards
+ * wait for their hardware at the same time. Their children are detected by
+ * the detect callbacks of their parents. All other devices are detected
+ * one after the other by the main thread meanwhile.
+ */
+static void blspec_detect_devices(void)
+{
+	struct bthread **threads;
+	struct device *dev;
+	int i, num = 0;
+
+	if (!IS_ENABLED(CONFIG_BLSPEC_PARALLEL_DETECT)) {
+		device_detect_all();
+		return;
+	}
+
+	for_each_device(dev)
+		num++;
+
+	threads = xzalloc(num * sizeof(*threads));
+	num = 0;
+
+	for_each_device(dev) {
+		if (!dev->detect_parallel || !dev->detect)
+			continue;
+		if (dev->parent && dev->parent->detect)
+			continue;
+
+		threads[num] = bthread_run(blspec_detect_thread, dev,
+					   "detect-%s", dev_name(dev));
+		if (!threads[num]) {
+			device_detect(dev);
+			continue;
+		}
+
+		bthread_set_parallel(threads[num]);
+		num++;
+	}
+
+	for_each_device(dev) {
+		if (!blspec_detect_in_thread(dev))
+			device_detect(dev);
+	}
+
+	for (i = 0; i < num; i++)
+		__bthread_stop(threads[i]);
+
+	free(threads);
+}
+
 /*
  * blspec_scan_devices - scan all devices for child cdevs
  *
@@ -686,16 +985,21 @@ static int blspec_scan_cdev(struct bootentries *bootentries, struct cdev *cdev)
  */
 int blspec_scan_devices(struct bootentries *bootentries)
 {
-	struct device *dev;
 	struct block_device *bdev;
 	int ret, found = 0;
 
-	for_each_device(dev)
-		device_detect(dev);
+	blspec_detect_devices();
 
 	for_each_block_device(bdev) {
 		struct cdev *cdev;
 
+		ret = blspec_scan_boot_partitions(bootentries, bdev->dev);
+		if (ret) {
+			if (ret > 0)
+				found += ret;
+			continue;
+		}
+
 		list_for_each_entry(cdev, &bdev->dev->cdevs, devices_list) {
 			ret = blspec_scan_cdev(bootentries, cdev);
 			if (ret > 0)
@@ -724,29 +1028,9 @@ int blspec_scan_device(struct bootentries *bootentries, struct device *dev)
 
 	device_detect(dev);
 
-	list_for_each_entry(cdev, &dev->cdevs, devices_list) {
-		/*
-		 * If the OS is installed on a disk with MBR disk label, and a
-		 * partition with the MBR type id of 0xEA already exists it
-		 * should be used as $BOOT
-		 */
-		if (cdev->dos_partition_type == 0xea) {
-			ret = blspec_scan_cdev(bootentries, cdev);
-			if (ret == 0)
-				ret = -ENOENT;
-
-			return ret;
-		}
-
-		/*
-		 * If the OS is installed on a disk with GPT disk label, and a
-		 * partition with the GPT type GUID of
-		 * bc13c2ff-59e6-4262-a352-b275fd6f7172 already exists, it
-		 * should be used as $BOOT.
-		 *
-		 * Not yet implemented
-		 */
-	}
+	ret = blspec_scan_boot_partitions(bootentries, dev);
+	if (ret)
+		return ret;
 
 	/* Try child devices */
 	device_for_each_child(dev, child) {
@@ -0,0 +1,296 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * bootcache.c - keep probe results across warm reboots
+ *
+ * Results of expensive discovery, like parsed partition tables, are stored
+ * as keyed records in a reserved memory region which survives a warm
+ * reboot. The region is described by a /reserved-memory node compatible to
+ * "barebox,bootcache". Every record is protected by a crc32 and a garbled
+ * region, e.g. after power loss, is reset. Users must still validate that
+ * a record matches the hardware, e.g. by storing a checksum of the data it
+ * was derived from. The region is reserved in the devicetree passed to the
+ * kernel, so that it survives until the next warm reboot.
+ */
+
+#define pr_fmt(fmt) "bootcache: " fmt
+
+#include <common.h>
+#include <bootcache.h>
+#include <crc.h>
+#include <init.h>
+#include <of.h>
+#include <of_address.h>
+#include <stdio.h>
+#include <linux/ioport.h>
+#include <linux/sizes.h>
+
+static struct bootcache_header *bootcache;
+static struct resource bootcache_res;
+static size_t bootcache_capacity;	/* bytes available for entries */
+static bool bootcache_probed;
+
+static size_t bootcache_entry_size(u32 len)
+{
+	return ALIGN(sizeof(struct bootcache_entry) + len, 8);
+}
+
+static struct bootcache_entry *bootcache_entry(u32 offset)
+{
+	return (void *)bootcache->entries + offset;
+}
+
+static u32 bootcache_crc(struct bootcache_entry *e, const void *data, u32 len)
+{
+	u32 crc;
+
+	crc = crc32(0, e, offsetof(struct bootcache_entry, crc));
+
+	return crc32(crc, data, len);
+}
+
+static void bootcache_reset(void)
+{
+	bootcache->magic = cpu_to_le32(BOOTCACHE_MAGIC);
+	bootcache->version = cpu_to_le32(BOOTCACHE_VERSION);
+	bootcache->used = 0;
+	bootcache->reserved = 0;
+}
+
+/* Check that the entries chain up to exactly the used size */
+static bool bootcache_valid(void)
+{
+	u32 used = le32_to_cpu(bootcache->used);
+	u32 offset = 0;
+
+	if (le32_to_cpu(bootcache->magic) != BOOTCACHE_MAGIC ||
+	    le32_to_cpu(bootcache->version) != BOOTCACHE_VERSION ||
+	    used > bootcache_capacity)
+		return false;
+
+	while (offset < used) {
+		struct bootcache_entry *e = bootcache_entry(offset);
+
+		if (used - offset < sizeof(*e) ||
+		    le32_to_cpu(e->len) > used - offset - sizeof(*e))
+			return false;
+
+		offset += bootcache_entry_size(le32_to_cpu(e->len));
+	}
+
+	return offset == used;
+}
+
+static struct bootcache_header *bootcache_get(void)
+{
+	struct device_node *np;
+	struct resource *res = &bootcache_res;
+
+	if (bootcache_probed)
+		return bootcache;
+
+	np = of_find_compatible_node(NULL, NULL, "barebox,bootcache");
+	if (!np)
+		return NULL;
+
+	bootcache_probed = true;
+
+	if (of_address_to_resource(np, 0, res))
+		return NULL;
+
+	if (resource_size(res) < sizeof(*bootcache) + SZ_1K) {
+		pr_warn("region too small\n");
+		return NULL;
+	}
+
+	bootcache = (void *)(unsigned long)res->start;
+	bootcache_capacity = resource_size(res) - sizeof(*bootcache);
+
+	if (!bootcache_valid()) {
+		pr_debug("no valid cache found, resetting\n");
+		bootcache_reset();
+	}
+
+	return bootcache;
+}
+
+static struct bootcache_entry *bootcache_find(const char *key)
+{
+	u32 used = le32_to_cpu(bootcache->used);
+	u32 offset;
+
+	for (offset = 0; offset < used;) {
+		struct bootcache_entry *e = bootcache_entry(offset);
+
+		if (!strncmp(e->key, key, BOOTCACHE_KEY_LEN))
+			return e;
+
+		offset += bootcache_entry_size(le32_to_cpu(e->len));
+	}
+
+	return NULL;
+}
+
+/* Drop deleted entries */
+static void bootcache_compact(void)
+{
+	u32 used = le32_to_cpu(bootcache->used);
+	u32 offset, to = 0;
+
+	for (offset = 0; offset < used;) {
+		struct bootcache_entry *e = bootcache_entry(offset);
+		size_t size = bootcache_entry_size(le32_to_cpu(e->len));
+
+		if (e->key[0]) {
+			if (offset != to)
+				memmove(bootcache_entry(to), e, size);
+			to += size;
+		}
+
+		offset += size;
+	}
+
+	bootcache->used = cpu_to_le32(to);
+}
+
+/**
+ * bootcache_load - look up a record in the boot cache
+ * @key: name of the record
+ * @buf: buffer to copy the record to
+ * @len: size of @buf
+ *
+ * Return: the length of the record, which may be bigger than @len, or
+ * -ENOENT if there is no intact record named @key.
+ */
+ssize_t bootcache_load(const char *key, void *buf, size_t len)
+{
+	struct bootcache_entry *e;
+	u32 elen;
+
+	if (!bootcache_get())
+		return -ENOENT;
+
+	e = bootcache_find(key);
+	if (!e)
+		return -ENOENT;
+
+	elen = le32_to_cpu(e->len);
+
+	if (bootcache_crc(e, e->data, elen) != le32_to_cpu(e->crc)) {
+		pr_debug("%s: bad crc\n", key);
+		e->key[0] = '\0';
+		return -ENOENT;
+	}
+
+	memcpy(buf, e->data, min_t(size_t, len, elen));
+
+	return elen;
+}
+
+/**
+ * bootcache_store - store a record in the boot cache
+ * @key: name of the record, replaces a record of the same name
+ * @buf: data of the record
+ * @len: length of @buf
+ *
+ * Return: 0 for success, negative error code otherwise
+ */
+int bootcache_store(const char *key, const void *buf, size_t len)
+{
+	struct bootcache_entry *e;
+	u32 used;
+
+	if (!bootcache_get())
+		return -ENODEV;
+
+	e = bootcache_find(key);
+	if (e && le32_to_cpu(e->len) == len)
+		goto write;
+
+	if (e)
+		e->key[0] = '\0';
+
+	if (bootcache_entry_size(len) > bootcache_capacity)
+		return -ENOSPC;
+
+	used = le32_to_cpu(bootcache->used);
+	if (used + bootcache_entry_size(len) > bootcache_capacity) {
+		bootcache_compact();
+		used = le32_to_cpu(bootcache->used);
+		if (used + bootcache_entry_size(len) > bootcache_capacity)
+			return -ENOSPC;
+	}
+
+	e = bootcache_entry(used);
+	memset(e, 0, sizeof(*e));
+	strncpy(e->key, key, BOOTCACHE_KEY_LEN);
+	e->len = cpu_to_le32(len);
+	bootcache->used = cpu_to_le32(used + bootcache_entry_size(len));
+write:
+	memcpy(e->data, buf, len);
+	e->crc = cpu_to_le32(bootcache_crc(e, buf, len));
+
+	return 0;
+}
+
+void bootcache_clear(void)
+{
+	if (bootcache_get())
+		bootcache_reset();
+}
+
+void bootcache_info(void)
+{
+	u32 used, offset;
+
+	if (!bootcache_get()) {
+		printf("no boot cache region\n");
+		return;
+	}
+
+	used = le32_to_cpu(bootcache->used);
+
+	printf("%u of %zu bytes used\n", used, bootcache_capacity);
+
+	for (offset = 0; offset < used;) {
+		struct bootcache_entry *e = bootcache_entry(offset);
+		u32 len = le32_to_cpu(e->len);
+
+		if (e->key[0])
+			printf("  %-*.*s %8u%s\n", BOOTCACHE_KEY_LEN,
+			       BOOTCACHE_KEY_LEN, e->key, len,
+			       bootcache_crc(e, e->data, len) ==
+			       le32_to_cpu(e->crc) ? "" : " (bad crc)");
+
+		offset += bootcache_entry_size(len);
+	}
+}
+
+static int bootcache_of_fixup(struct device_node *root, void *unused)
+{
+	struct resource res;
+	struct device_node *node;
+	int ret;
+
+	if (!bootcache_get())
+		return 0;
+
+	res = bootcache_res;
+	res.name = "bootcache";
+	res.flags = IORESOURCE_BUSY;
+
+	ret = of_fixup_reserved_memory(root, &res);
+	if (ret)
+		return ret;
+
+	node = of_find_node_by_path_from(root, "/reserved-memory/bootcache");
+	if (!node)
+		return -ENOMEM;
+
+	return of_property_write_string(node, "compatible", "barebox,bootcache");
+}
+
+static int bootcache_register_fixup(void)
+{
+	return of_register_fixup(bootcache_of_fixup, NULL);
+}
+late_initcall(bootcache_register_fixup);
@@ -2,6 +2,7 @@
 
 #include <common.h>
 #include <bootm.h>
+#include <boottrace.h>
 #include <fs.h>
 #include <malloc.h>
 #include <memory.h>
@@ -86,19 +87,7 @@ static int uimage_part_num(const char *partname)
 	return simple_strtoul(partname, NULL, 0);
 }
 
-/*
- * bootm_load_os() - load OS to RAM
- *
- * @data:		image data context
- * @load_address:	The address where the OS should be loaded to
- *
- * This loads the OS to a RAM location. load_address must be a valid
- * address. If the image_data doesn't have a OS specified it's considered
- * an error.
- *
- * Return: 0 on success, negative error code otherwise
- */
-int bootm_load_os(struct image_data *data, unsigned long load_address)
+static int __bootm_load_os(struct image_data *data, unsigned long load_address)
 {
 	if (data->os_res)
 		return 0;
@@ -150,6 +139,29 @@ int bootm_load_os(struct image_data *data, unsigned long load_address)
 	return -EINVAL;
 }
 
+/*
+ * bootm_load_os() - load OS to RAM
+ *
+ * @data:		image data context
+ * @load_address:	The address where the OS should be loaded to
+ *
+ * This loads the OS to a RAM location. load_address must be a valid
+ * address. If the image_data doesn't have a OS specified it's considered
+ * an error.
+ *
+ * Return: 0 on success, negative error code otherwise
+ */
+int bootm_load_os(struct image_data *data, unsigned long load_address)
+{
+	int ret;
+
+	boottrace_begin(BOOTTRACE_BOOTM, "load_os");
+	ret = __bootm_load_os(data, load_address);
+	boottrace_end(BOOTTRACE_BOOTM, "load_os");
+
+	return ret;
+}
+
 bool bootm_has_initrd(struct image_data *data)
 {
 	if (!IS_ENABLED(CONFIG_BOOTM_INITRD))
@@ -190,20 +202,7 @@ static int bootm_open_initrd_uimage(struct image_data *data)
 	return 0;
 }
 
-/*
- * bootm_load_initrd() - load initrd to RAM
- *
- * @data:		image data context
- * @load_address:	The address where the initrd should be loaded to
- *
- * This loads the initrd to a RAM location. load_address must be a valid
- * address. If the image_data doesn't have a initrd specified this function
- * still returns successful as an initrd is optional. Check data->initrd_res
- * to see if an initrd has been loaded.
- *
- * Return: 0 on success, negative error code otherwise
- */
-int bootm_load_initrd(struct image_data *data, unsigned long load_address)
+static int __bootm_load_initrd(struct image_data *data, unsigned long load_address)
 {
 	enum filetype type;
 	int ret;
@@ -290,6 +289,30 @@ int bootm_load_initrd(struct image_data *data, unsigned long load_address)
 	return 0;
 }
 
+/*
+ * bootm_load_initrd() - load initrd to RAM
+ *
+ * @data:		image data context
+ * @load_address:	The address where the initrd should be loaded to
+ *
+ * This loads the initrd to a RAM location. load_address must be a valid
+ * address. If the image_data doesn't have a initrd specified this function
+ * still returns successful as an initrd is optional. Check data->initrd_res
+ * to see if an initrd has been loaded.
+ *
+ * Return: 0 on success, negative error code otherwise
+ */
+int bootm_load_initrd(struct image_data *data, unsigned long load_address)
+{
+	int ret;
+
+	boottrace_begin(BOOTTRACE_BOOTM, "load_initrd");
+	ret = __bootm_load_initrd(data, load_address);
+	boottrace_end(BOOTTRACE_BOOTM, "load_initrd");
+
+	return ret;
+}
+
 static int bootm_open_oftree_uimage(struct image_data *data, size_t *size,
 				    struct fdt_header **fdt)
 {
@@ -362,7 +385,8 @@ void *bootm_get_devicetree(struct image_data *data)
 		if (ret)
 			return ERR_PTR(ret);
 
-		data->of_root_node = of_unflatten_dtb(of_tree, of_size);
+		/* the FIT image stays open until the devicetree is flattened */
+		data->of_root_node = of_unflatten_dtb_const(of_tree, of_size);
 	} else if (data->oftree_file) {
 		size_t size;
 
@@ -390,11 +414,10 @@ void *bootm_get_devicetree(struct image_data *data)
 		if (ret)
 			return ERR_PTR(ret);
 
-		data->of_root_node = of_unflatten_dtb(oftree, size);
-
-		free(oftree);
+		data->of_root_node = of_unflatten_dtb_owned(oftree, size);
 
 		if (IS_ERR(data->of_root_node)) {
+			free(oftree);
 			data->of_root_node = NULL;
 			pr_err("unable to unflatten devicetree\n");
 			return ERR_PTR(-EINVAL);
@@ -424,21 +447,8 @@ void *bootm_get_devicetree(struct image_data *data)
 	return oftree;
 }
 
-/*
- * bootm_load_devicetree() - load devicetree
- *
- * @data:		image data context
- * @fdt:		The flat device tree to load
- * @load_address:	The address where the devicetree should be loaded to
- *
- * This loads the devicetree to a RAM location. load_address must be a valid
- * address which is requested with request_sdram_region. The associated region
- * is released automatically in the bootm error path.
- *
- * Return: 0 on success, negative error code otherwise
- */
-int bootm_load_devicetree(struct image_data *data, void *fdt,
-			    unsigned long load_address)
+static int __bootm_load_devicetree(struct image_data *data, void *fdt,
+				   unsigned long load_address)
 {
 	int fdt_size;
 
@@ -466,6 +476,31 @@ int bootm_load_devicetree(struct image_data *data, void *fdt,
 	return 0;
 }
 
+/*
+ * bootm_load_devicetree() - load devicetree
+ *
+ * @data:		image data context
+ * @fdt:		The flat device tree to load
+ * @load_address:	The address where the devicetree should be loaded to
+ *
+ * This loads the devicetree to a RAM location. load_address must be a valid
+ * address which is requested with request_sdram_region. The associated region
+ * is released automatically in the bootm error path.
+ *
+ * Return: 0 on success, negative error code otherwise
+ */
+int bootm_load_devicetree(struct image_data *data, void *fdt,
+			  unsigned long load_address)
+{
+	int ret;
+
+	boottrace_begin(BOOTTRACE_BOOTM, "load_devicetree");
+	ret = __bootm_load_devicetree(data, fdt, load_address);
+	boottrace_end(BOOTTRACE_BOOTM, "load_devicetree");
+
+	return ret;
+}
+
 int bootm_get_os_size(struct image_data *data)
 {
 	int ret;
@@ -0,0 +1,195 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * boottrace.c - record timestamped begin/end events during boot
+ *
+ * Events are kept in a fixed ring which is exported as Chrome trace /
+ * Perfetto JSON by the boottrace command and handed to the kernel as
+ * /reserved-memory/boottrace.
+ */
+
+#define pr_fmt(fmt) "boottrace: " fmt
+
+#include <common.h>
+#include <boottrace.h>
+#include <clock.h>
+#include <init.h>
+#include <io.h>
+#include <of.h>
+#include <stdio.h>
+#include <linux/ioport.h>
+#include <linux/sizes.h>
+
+#define BOOTTRACE_SIZE	ALIGN(sizeof(struct boottrace_header) + \
+			      CONFIG_BOOTTRACE_ENTRIES * \
+			      sizeof(struct boottrace_entry), SZ_4K)
+
+/* page aligned, so that the kernel can reserve it as is */
+static u8 boottrace_buf[BOOTTRACE_SIZE] __aligned(SZ_4K);
+static u32 boottrace_head;
+
+static const char * const boottrace_cat_names[BOOTTRACE_NUM_CAT] = {
+	[BOOTTRACE_INITCALL] = "initcall",
+	[BOOTTRACE_PROBE] = "probe",
+	[BOOTTRACE_DEFERRED] = "deferred",
+	[BOOTTRACE_MOUNT] = "mount",
+	[BOOTTRACE_BOOTM] = "bootm",
+	[BOOTTRACE_FIT] = "fit",
+};
+
+static inline struct boottrace_header *boottrace_hdr(void)
+{
+	return (struct boottrace_header *)boottrace_buf;
+}
+
+static struct boottrace_entry *boottrace_next(enum boottrace_cat cat,
+					      char phase)
+{
+	struct boottrace_header *hdr = boottrace_hdr();
+	struct boottrace_entry *e;
+
+	if (!boottrace_head) {
+		hdr->magic = cpu_to_le32(BOOTTRACE_MAGIC);
+		hdr->version = cpu_to_le32(BOOTTRACE_VERSION);
+		hdr->nr_entries = cpu_to_le32(CONFIG_BOOTTRACE_ENTRIES);
+	}
+
+	e = &hdr->entries[boottrace_head % CONFIG_BOOTTRACE_ENTRIES];
+	boottrace_head++;
+	hdr->head = cpu_to_le32(boottrace_head);
+
+	e->ts_ns = cpu_to_le64(get_time_ns());
+	e->addr = 0;
+	e->phase = phase;
+	e->cat = cat;
+	e->name[0] = '\0';
+
+	return e;
+}
+
+void boottrace_event(enum boottrace_cat cat, char phase, const char *name)
+{
+	struct boottrace_entry *e = boottrace_next(cat, phase);
+	int i;
+
+	/* Copy without anything that needs escaping in JSON */
+	for (i = 0; name && i < BOOTTRACE_NAME_LEN - 1 && name[i]; i++)
+		e->name[i] = (name[i] == '"' || name[i] == '\\') ? '_' : name[i];
+	e->name[i] = '\0';
+}
+
+/*
+ * Symbol lookup is deferred until the trace is read, so recording an
+ * initcall only costs a timestamp.
+ */
+void boottrace_event_fn(enum boottrace_cat cat, char phase, const void *fn)
+{
+	struct boottrace_entry *e = boottrace_next(cat, phase);
+
+	e->addr = cpu_to_le64((unsigned long)fn);
+}
+
+static void boottrace_resolve(struct boottrace_entry *e)
+{
+	char *offset;
+
+	if (e->name[0] || !e->addr)
+		return;
+
+	snprintf(e->name, BOOTTRACE_NAME_LEN, "%pS",
+		 (void *)(unsigned long)le64_to_cpu(e->addr));
+
+	/* drop the +offset/size suffix */
+	offset = strchr(e->name, '+');
+	if (offset)
+		*offset = '\0';
+}
+
+static unsigned int boottrace_first(unsigned int *nr)
+{
+	*nr = min_t(u32, boottrace_head, CONFIG_BOOTTRACE_ENTRIES);
+
+	return boottrace_head - *nr;
+}
+
+static const char *boottrace_cat_name(u8 cat)
+{
+	if (cat >= BOOTTRACE_NUM_CAT)
+		return "unknown";
+
+	return boottrace_cat_names[cat];
+}
+
+int boottrace_dump_json(int fd)
+{
+	struct boottrace_header *hdr = boottrace_hdr();
+	unsigned int i, nr, first;
+
+	first = boottrace_first(&nr);
+
+	dprintf(fd, "{\"traceEvents\":[\n");
+
+	for (i = 0; i < nr; i++) {
+		struct boottrace_entry *e;
+		u64 ts;
+
+		e = &hdr->entries[(first + i) % CONFIG_BOOTTRACE_ENTRIES];
+		boottrace_resolve(e);
+		ts = le64_to_cpu(e->ts_ns);
+
+		dprintf(fd, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\","
+			"\"ts\":%llu.%03u,\"pid\":1,\"tid\":1}",
+			i ? ",\n" : "", e->name, boottrace_cat_name(e->cat),
+			e->phase, ts / 1000, (unsigned int)(ts % 1000));
+	}
+
+	dprintf(fd, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+	return 0;
+}
+
+void boottrace_clear(void)
+{
+	boottrace_head = 0;
+	boottrace_hdr()->head = 0;
+}
+
+static int boottrace_of_fixup(struct device_node *root, void *unused)
+{
+	struct boottrace_header *hdr = boottrace_hdr();
+	struct resource res = {};
+	struct device_node *node;
+	unsigned int i, nr, first;
+	int ret;
+
+	/* The kernel cannot look up barebox symbols, so do it now */
+	first = boottrace_first(&nr);
+	for (i = 0; i < nr; i++)
+		boottrace_resolve(&hdr->entries[(first + i) %
+						CONFIG_BOOTTRACE_ENTRIES]);
+
+	hdr->handover_ns = cpu_to_le64(get_time_ns());
+
+	res.start = virt_to_phys(boottrace_buf);
+	res.end = res.start + sizeof(boottrace_buf) - 1;
+	res.name = "boottrace";
+	res.flags = IORESOURCE_BUSY;
+
+	ret = of_fixup_reserved_memory(root, &res);
+	if (ret)
+		return ret;
+
+	node = of_find_node_by_path_from(root, "/reserved-memory/boottrace");
+	if (!node)
+		return -ENOMEM;
+
+	return of_property_write_string(node, "compatible", "barebox,boottrace");
+}
+
+static int boottrace_register_fixup(void)
+{
+	if (!IS_ENABLED(CONFIG_OFTREE))
+		return 0;
+
+	return of_register_fixup(boottrace_of_fixup, NULL);
+}
+late_initcall(boottrace_register_fixup);
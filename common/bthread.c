@@ -34,6 +34,7 @@ static struct bthread {
 	u8 should_stop :1;
 	u8 should_clean :1;
 	u8 has_stopped :1;
+	u8 parallel :1;
 } main_thread = {
 	.list = LIST_HEAD_INIT(main_thread.list),
 	.name = "main",
@@ -193,6 +194,44 @@ void bthread_reschedule(void)
 	}
 }
 
+/**
+ * bthread_set_parallel - let a thread run while a command is running
+ * @bthread: the thread, usually just created with bthread_run()
+ *
+ * Other threads only run while no command holds the command slice.
+ * Parallel threads do work on behalf of the main thread, like detecting
+ * or probing devices, and resched() switches between them and the main
+ * thread even while a command runs, so that their waits for the hardware
+ * overlap. They must not rely on the command slice being free.
+ *
+ * As a consequence, a parallel thread can be switched away from in the
+ * middle of a transfer on a bus like I2C, which has no lock of its own,
+ * and the next thread may start a transfer on the same bus. Parallel
+ * threads must not use buses that other parallel threads use as well.
+ */
+void bthread_set_parallel(struct bthread *bthread)
+{
+	bthread->parallel = true;
+}
+
+/**
+ * bthread_reschedule_parallel - switch to the next parallel thread
+ *
+ * Like bthread_reschedule(), but only considers the threads marked with
+ * bthread_set_parallel() and the main thread.
+ */
+void bthread_reschedule_parallel(void)
+{
+	struct bthread *next;
+
+	list_for_each_entry(next, &current->list, list) {
+		if (next->awake && (next->parallel || next == &main_thread)) {
+			bthread_schedule(next);
+			return;
+		}
+	}
+}
+
 void bthread_schedule(struct bthread *to)
 {
 	struct bthread *from = current;
@@ -14,6 +14,8 @@
 #include <malloc.h>
 #include <environment.h>
 #include <linux/list.h>
+#include <linux/hashtable.h>
+#include <linux/stringhash.h>
 #include <init.h>
 #include <complete.h>
 #include <getopt.h>
@@ -21,6 +23,9 @@
 LIST_HEAD(command_list);
 EXPORT_SYMBOL(command_list);
 
+/* indexes command_list by name for find_cmd() */
+static DEFINE_HASHTABLE(command_hashtable, 7);
+
 void barebox_cmd_usage(struct command *cmdtp)
 {
 	putchar('\n');
@@ -90,6 +95,9 @@ int register_command(struct command *cmd)
 
 	list_add_sort(&cmd->list, &command_list, compare);
 
+	/* added to the front, so a later command overrides an earlier one */
+	hash_add(command_hashtable, &cmd->hash, str_hash(cmd->name));
+
 	if (cmd->aliases) {
 		const char * const *aliases = cmd->aliases;
 		while(*aliases) {
@@ -120,7 +128,7 @@ struct command *find_cmd (const char *cmd)
 {
 	struct command *cmdtp;
 
-	for_each_command(cmdtp)
+	hash_for_each_possible(command_hashtable, cmdtp, hash, str_hash(cmd))
 		if (!strcmp(cmd, cmdtp->name))
 			return cmdtp;
 
@@ -18,6 +18,7 @@
 #include <kfifo.h>
 #include <module.h>
 #include <sched.h>
+#include <poller.h>
 #include <ratp_bb.h>
 #include <magicvar.h>
 #include <globalvar.h>
@@ -79,6 +80,183 @@ int console_close(struct console_device *cdev)
 	return 0;
 }
 
+#ifdef CONFIG_CONSOLE_TX_BUFFER
+/*
+ * Drop the queued output of a stuck UART. The bytes are counted in the
+ * tx_dropped parameter and the queue is left with a note about them, which
+ * goes out first once the UART runs again.
+ */
+static void console_tx_drop(struct console_device *cdev)
+{
+	char buf[48];
+	int len;
+
+	cdev->tx_dropped += kfifo_len(cdev->tx_fifo);
+	kfifo_reset(cdev->tx_fifo);
+
+	len = snprintf(buf, sizeof(buf), "\r\n[%u bytes of output dropped]\r\n",
+		       cdev->tx_dropped);
+	kfifo_put(cdev->tx_fifo, buf, len);
+}
+
+/*
+ * Send queued output as far as the hardware FIFO takes it. Without @wait
+ * this returns as soon as the UART is busy, otherwise it waits until at
+ * least @wait bytes have been sent or the queue is empty. If the UART
+ * makes no progress for 100ms, e.g. because it is stopped by flow control,
+ * the queued output is dropped.
+ */
+static void console_tx_drain(struct console_device *cdev, unsigned int wait)
+{
+	uint64_t start = 0;
+	unsigned char c;
+	int room;
+
+	while (kfifo_len(cdev->tx_fifo)) {
+		room = cdev->tx_room(cdev);
+		if (!room) {
+			if (!wait)
+				return;
+
+			if (!start) {
+				start = get_time_ns();
+			} else if (is_timeout_non_interruptible(start,
+								100 * MSECOND)) {
+				console_tx_drop(cdev);
+				return;
+			}
+
+			continue;
+		}
+
+		start = 0;
+
+		while (room-- && kfifo_getc(cdev->tx_fifo, &c) == 0) {
+			cdev->tx_putc(cdev, c);
+			if (wait)
+				wait--;
+		}
+	}
+}
+
+static void console_tx_putc(struct console_device *cdev, char c)
+{
+	if (!cdev->tx_fifo) {
+		cdev->putc(cdev, c);
+		return;
+	}
+
+	if (kfifo_len(cdev->tx_fifo) == cdev->tx_fifo->size)
+		console_tx_drain(cdev, 1);
+
+	kfifo_putc(cdev->tx_fifo, c);
+}
+
+static void console_tx_kick(struct console_device *cdev)
+{
+	if (cdev->tx_fifo)
+		console_tx_drain(cdev, 0);
+}
+
+static void console_tx_flush(struct console_device *cdev)
+{
+	if (cdev->tx_fifo)
+		console_tx_drain(cdev, UINT_MAX);
+}
+
+/*
+ * Replaces putc of a buffered console for its users writing to the UART
+ * directly, like x/ymodem or RATP, so that their output does not overtake
+ * the queued one.
+ */
+static void console_tx_direct_putc(struct console_device *cdev, char c)
+{
+	console_tx_flush(cdev);
+	cdev->orig_putc(cdev, c);
+}
+
+static int console_tx_puts(struct console_device *cdev, const char *s,
+			   size_t nbytes)
+{
+	size_t i;
+
+	for (i = 0; i < nbytes; i++) {
+		if (s[i] == '\n')
+			console_tx_putc(cdev, '\r');
+
+		console_tx_putc(cdev, s[i]);
+	}
+
+	console_tx_kick(cdev);
+
+	return i;
+}
+
+static void console_tx_poll(struct poller_struct *poller)
+{
+	struct console_device *cdev;
+
+	for_each_console(cdev)
+		console_tx_kick(cdev);
+}
+
+static struct poller_struct console_tx_poller = {
+	.func = console_tx_poll,
+};
+
+static void console_tx_init(struct console_device *cdev)
+{
+	if (!cdev->tx_room || !cdev->tx_putc || cdev->puts)
+		return;
+
+	cdev->tx_fifo = kfifo_alloc(CONFIG_CONSOLE_TX_BUFFER_SIZE);
+	if (!cdev->tx_fifo)
+		return;
+
+	cdev->orig_putc = cdev->putc;
+	cdev->putc = console_tx_direct_putc;
+	cdev->puts = console_tx_puts;
+
+	dev_add_param_uint32_ro(&cdev->class_dev, "tx_dropped",
+				&cdev->tx_dropped, "%u");
+
+	if (!console_tx_poller.registered)
+		poller_register(&console_tx_poller, "console-tx");
+}
+
+static void console_tx_exit(struct console_device *cdev)
+{
+	if (!cdev->tx_fifo)
+		return;
+
+	console_tx_flush(cdev);
+	kfifo_free(cdev->tx_fifo);
+	cdev->tx_fifo = NULL;
+	cdev->putc = cdev->orig_putc;
+}
+#else
+static inline void console_tx_putc(struct console_device *cdev, char c)
+{
+	cdev->putc(cdev, c);
+}
+
+static inline void console_tx_kick(struct console_device *cdev)
+{
+}
+
+static inline void console_tx_flush(struct console_device *cdev)
+{
+}
+
+static inline void console_tx_init(struct console_device *cdev)
+{
+}
+
+static inline void console_tx_exit(struct console_device *cdev)
+{
+}
+#endif
+
 int console_set_active(struct console_device *cdev, unsigned flag)
 {
 	int ret;
@@ -88,8 +266,11 @@ int console_set_active(struct console_device *cdev, unsigned flag)
 	if (!cdev->putc)
 		flag &= ~(CONSOLE_STDOUT | CONSOLE_STDERR);
 
-	if (!flag && cdev->f_active && cdev->flush)
-		cdev->flush(cdev);
+	if (!flag && cdev->f_active) {
+		console_tx_flush(cdev);
+		if (cdev->flush)
+			cdev->flush(cdev);
+	}
 
 	if (flag == cdev->f_active)
 		return 0;
@@ -181,6 +362,8 @@ int console_set_baudrate(struct console_device *cdev, unsigned baudrate)
 		mdelay(50);
 	}
 
+	console_tx_flush(cdev);
+
 	ret = cdev->setbrg(cdev, baudrate);
 	if (ret)
 		return ret;
@@ -290,6 +473,8 @@ static int fops_flush(struct cdev *dev)
 {
 	struct console_device *priv = dev->priv;
 
+	console_tx_flush(priv);
+
 	if (priv->flush)
 		priv->flush(priv);
 
@@ -360,6 +545,8 @@ int console_register(struct console_device *newcdev)
 
 	newcdev->baudrate = baudrate;
 
+	console_tx_init(newcdev);
+
 	if (newcdev->putc && !newcdev->puts)
 		newcdev->puts = __console_puts;
 
@@ -419,6 +606,8 @@ int console_unregister(struct console_device *cdev)
 
 	devfs_remove(&cdev->devfs);
 
+	console_tx_exit(cdev);
+
 	list_del(&cdev->list);
 	if (list_empty(&console_list))
 		initialized = CONSOLE_UNINITIALIZED;
@@ -535,8 +724,9 @@ void console_putc(unsigned int ch, char c)
 		for_each_console(cdev) {
 			if (cdev->f_active & ch) {
 				if (c == '\n')
-					cdev->putc(cdev, '\r');
-				cdev->putc(cdev, c);
+					console_tx_putc(cdev, '\r');
+				console_tx_putc(cdev, c);
+				console_tx_kick(cdev);
 			}
 		}
 		return;
@@ -581,6 +771,7 @@ void console_flush(void)
 	struct console_device *cdev;
 
 	for_each_console(cdev) {
+		console_tx_flush(cdev);
 		if (cdev->flush)
 			cdev->flush(cdev);
 	}
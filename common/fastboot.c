@@ -325,17 +325,43 @@ int fastboot_handle_download_data(struct fastboot *fb, const void *buffer,
 {
 	int ret;
 
-	ret = write(fb->download_fd, buffer, len);
-	if (ret < 0)
-		return ret;
+	if (fb->download_buf) {
+		if (len > fb->download_size - fb->download_bytes)
+			return -ENOSPC;
+
+		memcpy(fb->download_buf + fb->download_bytes, buffer, len);
+	} else {
+		ret = write(fb->download_fd, buffer, len);
+		if (ret < 0)
+			return ret;
+	}
 
+	fastboot_download_advance(fb, len);
+	return 0;
+}
+
+/**
+ * fastboot_download_advance - account for received download data
+ * @fb: The fastboot instance
+ * @len: Number of bytes
+ *
+ * For transports which put the data into fb->download_buf themselves
+ * instead of passing it to fastboot_handle_download_data().
+ */
+void fastboot_download_advance(struct fastboot *fb, unsigned int len)
+{
 	fb->download_bytes += len;
 	show_progress(fb->download_bytes);
-	return 0;
 }
 
 void fastboot_download_finished(struct fastboot *fb)
 {
+	fb->download_buf = NULL;
+
+	/* drop the preallocated but unused tail of a short download */
+	if (fb->download_bytes < fb->download_size)
+		ftruncate(fb->download_fd, fb->download_bytes);
+
 	close(fb->download_fd);
 	fb->download_fd = 0;
 
@@ -347,8 +373,30 @@ void fastboot_download_finished(struct fastboot *fb)
 	fastboot_tx_print(fb, FASTBOOT_MSG_OKAY, "");
 }
 
+/**
+ * fastboot_download_cancel - give up on a download
+ * @fb: The fastboot instance
+ *
+ * For transports which fail a download after it was started. The partial
+ * download is dropped, so that it can't be flashed or booted.
+ */
+void fastboot_download_cancel(struct fastboot *fb)
+{
+	fb->download_buf = NULL;
+
+	if (fb->download_fd > 0) {
+		close(fb->download_fd);
+		fb->download_fd = 0;
+		unlink(fb->tempname);
+	}
+
+	printf("\n");
+}
+
 void fastboot_abort(struct fastboot *fb)
 {
+	fb->download_buf = NULL;
+
 	if (fb->download_fd > 0) {
 		close(fb->download_fd);
 		fb->download_fd = 0;
@@ -363,6 +411,7 @@ static void cb_download(struct fastboot *fb, const char *cmd)
 {
 	fb->download_size = simple_strtoul(cmd, NULL, 16);
 	fb->download_bytes = 0;
+	fb->download_buf = NULL;
 
 	fastboot_tx_print(fb, FASTBOOT_MSG_INFO, "Downloading %d bytes...",
 			  fb->download_size);
@@ -380,11 +429,27 @@ static void cb_download(struct fastboot *fb, const char *cmd)
 			return;
 	}
 
-	if (!fb->download_size)
+	if (!fb->download_size) {
 		fastboot_tx_print(fb, FASTBOOT_MSG_FAIL,
 					  "data invalid size");
-	else
-		fb->start_download(fb);
+		return;
+	}
+
+	/*
+	 * Allocate the whole file up front, so that it ends up in one piece
+	 * which bootm can use without copying it again.
+	 */
+	if (ftruncate(fb->download_fd, fb->download_size)) {
+		fastboot_tx_print(fb, FASTBOOT_MSG_FAIL, "not enough memory");
+		return;
+	}
+
+	/* When the file is in one piece, the data can be received in place */
+	fb->download_buf = memmap(fb->download_fd, PROT_WRITE);
+	if (fb->download_buf == MAP_FAILED)
+		fb->download_buf = NULL;
+
+	fb->start_download(fb);
 }
 
 void fastboot_start_download_generic(struct fastboot *fb)
@@ -117,6 +117,7 @@
 #include <binfmt.h>
 #include <init.h>
 #include <shell.h>
+#include <clock.h>
 
 /*cmd_boot.c*/
 extern int do_bootd(int flag, int argc, char *argv[]);      /* do_bootd */
@@ -192,6 +193,8 @@ struct p_context {
 
 	int options_parsed;
 	struct list_head options;
+
+	int uses_args;			/* parsed with positional parameters */
 };
 
 
@@ -210,6 +213,7 @@ struct pipe {
 	struct pipe *next;			/* to track background commands */
 	pipe_style followup;		/* PIPE_BG, PIPE_SEQ, PIPE_OR, PIPE_AND */
 	reserved_style r_mode;		/* supports if, for, while, until */
+	const char *src;		/* where in the input the pipe starts */
 };
 
 
@@ -324,8 +328,8 @@ static int parse_string_outer(struct p_context *ctx, const char *s, int flag);
 static char **make_list_in(char **inp, char *name);
 static char *insert_var_value(char *inp);
 static int set_local_var(const char *s, int flg_export);
-static int execute_script(const char *path, int argc, char *argv[]);
-static int source_script(const char *path, int argc, char *argv[]);
+static int execute_script(const char *path, int argc, char *argv[], bool profile);
+static int source_script(const char *path, int argc, char *argv[], bool profile);
 
 static int b_check_space(o_string *o, int len)
 {
@@ -743,6 +747,45 @@ static void do_glob_in_argv(glob_t *globbuf, int argc, char **argv)
  * now has its stdout directed to the input of the appropriate pipe,
  * so this routine is noticeably simpler.
  */
+/*
+ * Expanding the variables of a command is done by parsing the command
+ * line again with the values inserted. When the values contain nothing
+ * the parser would have to handle, i.e. no quotes, escapes, comments or
+ * whitespace, the expanded words are used as they are. Returns the
+ * expanded argument vector or NULL if the command line must be parsed
+ * again.
+ */
+static char **expand_argv_simple(char **argv)
+{
+	char **res;
+	int n, i;
+
+	for (n = 0; argv[n]; n++)
+		;
+
+	res = xzalloc((n + 1) * sizeof(*res));
+
+	for (i = 0; i < n; i++) {
+		char *p = insert_var_value(argv[i]);
+
+		res[i] = p == argv[i] ? xstrdup(p) : p;
+
+		if (!*res[i] || strpbrk(res[i], "\\'\"# \t\n"))
+			goto parse;
+	}
+
+	if (!n || !strcmp(res[0], "getopt"))
+		goto parse;
+
+	return res;
+parse:
+	for (i = 0; i < n; i++)
+		free(res[i]);
+	free(res);
+
+	return NULL;
+}
+
 static int run_pipe_real(struct p_context *ctx, struct pipe *pi)
 {
 	int i;
@@ -752,6 +795,7 @@ static int run_pipe_real(struct p_context *ctx, struct pipe *pi)
 	glob_t globbuf = {};
 	int ret;
 	int rcode;
+	int sp;
 # if __GNUC__
 	/* Avoid longjmp clobbering */
 	(void) &i;
@@ -769,6 +813,7 @@ static int run_pipe_real(struct p_context *ctx, struct pipe *pi)
 	BUG_ON(pi->num_progs != 1);
 
 	child = &pi->progs[0];
+	sp = child->sp;
 
 	if (child->group) {
 		hush_debug("non-subshell grouping\n");
@@ -814,13 +859,35 @@ static int run_pipe_real(struct p_context *ctx, struct pipe *pi)
 			return 1;
 
 		if (p != child->argv[i]) {
-			child->sp--;
+			sp--;
 			free(p);
 		}
 	}
-	if (child->sp) {
+	if (sp) {
 		char * str = NULL;
 		struct p_context ctx1;
+		char **argv;
+
+		argv = expand_argv_simple(child->argv + i);
+		if (argv) {
+			struct child_prog child1 = { .argv = argv };
+			struct pipe pi1 = { .num_progs = 1, .progs = &child1 };
+
+			while (argv[child1.argc])
+				child1.argc++;
+
+			ctx1 = (struct p_context) {};
+			INIT_LIST_HEAD(&ctx1.options);
+
+			rcode = run_pipe_real(&ctx1, &pi1);
+			release_context(&ctx1);
+
+			for (i = 0; i < child1.argc; i++)
+				free(argv[i]);
+			free(argv);
+
+			return rcode;
+		}
 
 		initialize_context(&ctx1);
 
@@ -854,9 +921,188 @@ static int run_pipe_real(struct p_context *ctx, struct pipe *pi)
 	return ret;
 }
 
+#ifdef CONFIG_HUSH_PROFILE
+/*
+ * With sh -P the time spent in each line of a script is accumulated. A
+ * line is accounted for the commands starting in it, the time of if, for
+ * and while constructs is accounted to the lines of their commands.
+ */
+struct hush_profile {
+	const char *text;
+	size_t len;
+	int num_lines;
+	const char **lines;
+	unsigned int *calls;
+	u64 *time_ns;
+};
+
+static struct hush_profile *hush_profile;
+
+static struct hush_profile *hush_profile_alloc(const char *text)
+{
+	struct hush_profile *prof;
+	const char *p;
+	int n = 0;
+
+	prof = xzalloc(sizeof(*prof));
+	prof->text = text;
+	prof->len = strlen(text);
+
+	for (p = text; *p; p++)
+		if (*p == '\n')
+			n++;
+	n++;
+
+	prof->lines = xmalloc(n * sizeof(*prof->lines));
+	prof->calls = xzalloc(n * sizeof(*prof->calls));
+	prof->time_ns = xzalloc(n * sizeof(*prof->time_ns));
+
+	prof->lines[prof->num_lines++] = text;
+	for (p = text; *p; p++)
+		if (*p == '\n' && p[1])
+			prof->lines[prof->num_lines++] = p + 1;
+
+	return prof;
+}
+
+static void hush_profile_free(struct hush_profile *prof)
+{
+	free(prof->lines);
+	free(prof->calls);
+	free(prof->time_ns);
+	free(prof);
+}
+
+static void hush_profile_print(struct hush_profile *prof)
+{
+	int i;
+
+	printf(" line    calls    time/us  command\n");
+
+	for (i = 0; i < prof->num_lines; i++) {
+		const char *end;
+
+		if (!prof->calls[i])
+			continue;
+
+		end = strchrnul(prof->lines[i], '\n');
+
+		printf("%5d %8u %10llu  %.*s\n", i + 1, prof->calls[i],
+		       prof->time_ns[i] / 1000,
+		       (int)(end - prof->lines[i]), prof->lines[i]);
+	}
+}
+
+static u64 hush_profile_start(struct pipe *pi)
+{
+	return hush_profile ? get_time_ns() : 0;
+}
+
+static void hush_profile_account(struct pipe *pi, u64 start)
+{
+	struct hush_profile *prof = hush_profile;
+	int lo, hi;
+
+	if (!prof || !pi->src || pi->progs[0].group)
+		return;
+
+	if (pi->src < prof->text || pi->src >= prof->text + prof->len)
+		return;
+
+	/* find the last line starting before the pipe */
+	lo = 0;
+	hi = prof->num_lines - 1;
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+
+		if (prof->lines[mid] <= pi->src)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	prof->calls[lo]++;
+	prof->time_ns[lo] += get_time_ns() - start;
+}
+
+static struct hush_profile *hush_profile_begin(const char *text)
+{
+	struct hush_profile *prev = hush_profile;
+
+	hush_profile = hush_profile_alloc(text);
+
+	return prev;
+}
+
+static void hush_profile_end(struct hush_profile *prev)
+{
+	hush_profile_print(hush_profile);
+	hush_profile_free(hush_profile);
+	hush_profile = prev;
+}
+#else
+struct hush_profile;
+
+static inline u64 hush_profile_start(struct pipe *pi)
+{
+	return 0;
+}
+
+static inline void hush_profile_account(struct pipe *pi, u64 start)
+{
+}
+
+static inline struct hush_profile *hush_profile_begin(const char *text)
+{
+	return NULL;
+}
+
+static inline void hush_profile_end(struct hush_profile *prev)
+{
+}
+#endif
+
+/*
+ * The words after "in" are globbed when the loop starts, not when it is
+ * parsed, so that the parsed loop can be run again.
+ */
+static void glob_list_in(glob_t *globbuf, char **inp)
+{
+	int flags = GLOB_NOCHECK;
+
+	for (; *inp; inp++) {
+		if (**inp)
+			do_glob(*inp, flags, NULL, globbuf);
+		else
+			fake_glob(*inp, flags, NULL, globbuf);
+
+		flags |= GLOB_APPEND;
+	}
+}
+
+/*
+ * Assign the next value of a "for" loop. This is what running the "for"
+ * pipe with the value inserted used to do, but the pipe is left untouched,
+ * as a cached script may run it in several nested loops at once.
+ */
+static int run_for_assignment(char *s)
+{
+	char *p;
+	int rcode;
+
+	hush_debug("Local environment set: %s\n", s);
+
+	p = insert_var_value(s);
+	rcode = set_local_var(p, 0);
+
+	if (p != s)
+		free(p);
+
+	return rcode ? 1 : EXIT_SUCCESS;
+}
+
 static int run_list_real(struct p_context *ctx, struct pipe *pi)
 {
-	char *save_name = NULL;
 	char **list = NULL;
 	char **save_list = NULL;
 	struct pipe *rpipe;
@@ -865,6 +1111,7 @@ static int run_list_real(struct p_context *ctx, struct pipe *pi)
 	int flag_restore = 0, flag_conditional = 0;
 	int if_code=0, next_if_code=0;  /* need double-buffer to handle elif */
 	reserved_style rmode, skip_more_in_this_rmode = RES_XXXX;
+	u64 start;
 
 	/* check syntax for "for" */
 	for (rpipe = pi; rpipe; rpipe = rpipe->next) {
@@ -887,8 +1134,10 @@ static int run_list_real(struct p_context *ctx, struct pipe *pi)
 		if (pi->r_mode == RES_WHILE || pi->r_mode == RES_UNTIL ||
 				pi->r_mode == RES_FOR) {
 			/* check Ctrl-C */
-			if (ctrlc())
-				return 1;
+			if (ctrlc()) {
+				rcode = 1;
+				goto out;
+			}
 			flag_restore = 0;
 			if (!rpipe) {
 				flag_rep = 0;
@@ -925,27 +1174,29 @@ static int run_list_real(struct p_context *ctx, struct pipe *pi)
 				if (!pi->next->progs->argv)
 					continue;
 
+				glob_t globbuf = {};
+
 				/* create list of variable values */
-				list = make_list_in(pi->next->progs->argv,
+				glob_list_in(&globbuf, pi->next->progs->argv);
+				list = make_list_in(globbuf.gl_pathv,
 					pi->progs->argv[0]);
+				globfree(&globbuf);
 				save_list = list;
-				save_name = pi->progs->argv[0];
-				pi->progs->argv[0] = NULL;
 				flag_rep = 1;
 			}
 			if (!(*list)) {
-				free(pi->progs->argv[0]);
 				free(save_list);
 				list = NULL;
 				flag_rep = 0;
-				pi->progs->argv[0] = save_name;
 				continue;
-			} else {
-				/* insert new value from list for variable */
-				if (pi->progs->argv[0])
-					free(pi->progs->argv[0]);
-				pi->progs->argv[0] = *list++;
 			}
+
+			/* assign the next value from list to the variable */
+			start = hush_profile_start(pi);
+			last_return_code = run_for_assignment(*list);
+			hush_profile_account(pi, start);
+			free(*list++);
+			continue;
 		}
 		if (rmode == RES_IN)
 			continue;
@@ -966,12 +1217,16 @@ static int run_list_real(struct p_context *ctx, struct pipe *pi)
 		if (pi->num_progs == 0)
 			continue;
 
+		start = hush_profile_start(pi);
+
 		rcode = run_pipe_real(ctx, pi);
 		hush_debug("run_pipe_real returned %d\n",rcode);
 
+		hush_profile_account(pi, start);
+
 		if (rcode < -1) {
 			last_return_code = -rcode - 2;
-			return rcode;	/* exit */
+			goto out;	/* exit */
 		}
 
 		/* Conditional statements like "if", "elif", "while" and "until"
@@ -1010,6 +1265,16 @@ static int run_list_real(struct p_context *ctx, struct pipe *pi)
 		rcode = 0;
 	}
 
+	return rcode;
+
+out:
+	/* a loop was left early */
+	if (list) {
+		while (*list)
+			free(*list++);
+		free(save_list);
+	}
+
 	return rcode;
 }
 
@@ -1274,6 +1539,7 @@ static int reserved_word(o_string *dest, struct p_context *ctx)
 			done_pipe(ctx,PIPE_SEQ);
 			old = ctx->stack;
 			old->child->group = ctx->list_head;
+			old->uses_args |= ctx->uses_args;
 			*ctx = *old;   /* physical copy */
 			free(old);
 		}
@@ -1313,7 +1579,8 @@ static int done_word(o_string *dest, struct p_context *ctx)
 	if (child->argv)
 		flags |= GLOB_APPEND;
 
-	gr = xglob(dest, flags, glob_target, ctx->w == RES_IN ? 1 : 0);
+	/* the words after "in" are globbed when the loop is run */
+	gr = xglob(dest, flags, glob_target, 0);
 	if (gr)
 		return 1;
 
@@ -1449,6 +1716,7 @@ static int handle_dollar(o_string *dest, struct p_context *ctx, struct in_str *i
 	} else if (isdigit(ch)) {
 
 		i = ch - '0';	/* XXX is $0 special? */
+		ctx->uses_args = 1;
 		if (i < ctx->global_argc) {
 			parse_string(dest, ctx, ctx->global_argv[i]);        /* recursion */
 		}
@@ -1464,6 +1732,7 @@ static int handle_dollar(o_string *dest, struct p_context *ctx, struct in_str *i
 			advance = 1;
 			break;
 		case '#':
+			ctx->uses_args = 1;
 			b_adduint(dest,ctx->global_argc ? ctx->global_argc-1 : 0);
 			advance = 1;
 			break;
@@ -1484,6 +1753,7 @@ static int handle_dollar(o_string *dest, struct p_context *ctx, struct in_str *i
 			b_addchr(dest, SPECIAL_VAR_SYMBOL);
 			break;
 		case '*':
+			ctx->uses_args = 1;
 			for (i = 1; i < ctx->global_argc; i++) {
 				b_addstr(dest, ctx->global_argv[i]);
 				b_addchr(dest, ' ');
@@ -1531,6 +1801,9 @@ static int parse_stream(o_string *dest, struct p_context *ctx,
 				ch >= ' ' ? ch : '.', ch, m,
 				dest->quote, ctx->stack == NULL ? '*' : '.');
 
+		if (m != 2 && !ctx->pipe->src)
+			ctx->pipe->src = input->p - 1;
+
 		if (m == 0 || ((m == 1 || m == 2) && dest->quote)) {
 			b_addchr(dest, ch);
 			continue;
@@ -1904,21 +2177,364 @@ int run_command(const char *cmd)
 	return ret;
 }
 
-static int execute_script(const char *path, int argc, char *argv[])
+/* Read a script and make sure its last line is terminated */
+static char *hush_read_script(const char *path)
+{
+	char *text;
+	size_t len;
+
+	text = read_file(path, NULL);
+	if (!text)
+		return NULL;
+
+	len = strlen(text);
+	if (len && text[len - 1] != '\n') {
+		text = xrealloc(text, len + 2);
+		text[len] = '\n';
+		text[len + 1] = '\0';
+	}
+
+	return text;
+}
+
+#ifdef CONFIG_HUSH_SCRIPT_CACHE
+/*
+ * Scripts run with sh or source are kept parsed, so that running them
+ * again only has to expand the variables. A script is split into its
+ * top level commands which are parsed when they are first run. Commands
+ * using positional parameters are parsed again when called with other
+ * arguments.
+ *
+ * barebox has no modification times, a cached script is used as long as
+ * its filesystem has not been modified and its size is unchanged.
+ * Scripts on filesystems which can change behind our back are not cached.
+ */
+struct hush_command {
+	struct pipe *list;
+	const char *start;
+	int argc;		/* -1 if parsed without positional parameters */
+	char **argv;
+};
+
+struct hush_script {
+	struct list_head list;
+	char *path;
+	char *text;
+	loff_t size;
+	struct fs_device *fsdev;
+	unsigned int generation;
+	struct hush_command *commands;
+	int num_commands;
+	const char *parsed;	/* parsing continues here */
+	bool complete;
+	bool stale;
+	int users;
+};
+
+static LIST_HEAD(hush_scripts);
+
+static void hush_reset_options(struct p_context *ctx)
+{
+	release_context(ctx);
+	ctx->options_parsed = 0;
+	INIT_LIST_HEAD(&ctx->options);
+}
+
+static void hush_command_free_args(struct hush_command *cmd)
+{
+	int i;
+
+	if (cmd->argc < 0)
+		return;
+
+	for (i = 0; i < cmd->argc; i++)
+		free(cmd->argv[i]);
+	free(cmd->argv);
+}
+
+static void hush_script_free(struct hush_script *script)
+{
+	int i;
+
+	for (i = 0; i < script->num_commands; i++) {
+		free_pipe_list(script->commands[i].list, 0);
+		hush_command_free_args(&script->commands[i]);
+	}
+
+	free(script->commands);
+	free(script->text);
+	free(script->path);
+	free(script);
+}
+
+static void hush_script_put(struct hush_script *script)
+{
+	if (--script->users == 0 && script->stale)
+		hush_script_free(script);
+}
+
+static void hush_script_drop(struct hush_script *script)
+{
+	list_del(&script->list);
+
+	if (script->users)
+		script->stale = true;
+	else
+		hush_script_free(script);
+}
+
+static struct hush_script *hush_script_get(const char *path)
+{
+	struct hush_script *script;
+	struct fs_device *fsdev;
+	struct stat s;
+	char *cpath, *text;
+
+	cpath = canonicalize_path(path);
+	if (!cpath)
+		return NULL;
+
+	fsdev = get_fsdevice_by_path(cpath);
+	if (!fsdev || (fsdev->driver->flags & FS_DRIVER_REMOTE) ||
+	    stat(cpath, &s))
+		goto out;
+
+	list_for_each_entry(script, &hush_scripts, list) {
+		if (strcmp(script->path, cpath))
+			continue;
+
+		if (script->fsdev == fsdev &&
+		    script->generation == fsdev->generation &&
+		    script->size == s.st_size) {
+			free(cpath);
+			script->users++;
+			return script;
+		}
+
+		hush_script_drop(script);
+		break;
+	}
+
+	text = hush_read_script(cpath);
+	if (!text)
+		goto out;
+
+	script = xzalloc(sizeof(*script));
+	script->path = cpath;
+	script->text = text;
+	script->size = s.st_size;
+	script->fsdev = fsdev;
+	script->generation = fsdev->generation;
+	script->parsed = text;
+	script->complete = !*text;
+	script->users = 1;
+
+	list_add(&script->list, &hush_scripts);
+
+	return script;
+out:
+	free(cpath);
+
+	return NULL;
+}
+
+/*
+ * Parse the top level command starting at @src. @next is set to where the
+ * next command starts or to NULL when the end of the script is reached.
+ * Empty commands result in a NULL list.
+ */
+static int hush_parse_command(struct p_context *ctx, const char *src,
+			      struct hush_command *cmd, const char **next)
+{
+	o_string temp = NULL_O_STRING;
+	struct in_str input;
+	int rcode, i;
+
+	setup_string_in_str(&input, src);
+
+	ctx->type = FLAG_PARSE_SEMICOLON;
+	ctx->uses_args = 0;
+	initialize_context(ctx);
+	update_ifs_map();
+
+	rcode = parse_stream(&temp, ctx, &input, '\n');
+
+	if (rcode == 1 || ctx->old_flag != 0) {
+		if (rcode != 1)
+			syntax();
+		if (ctx->old_flag != 0)
+			free(ctx->stack);
+		free_pipe_list(ctx->list_head, 0);
+		b_free(&temp);
+		return 1;
+	}
+
+	done_word(&temp, ctx);
+	done_pipe(ctx, PIPE_SEQ);
+	b_free(&temp);
+
+	cmd->start = src;
+	cmd->argc = -1;
+	cmd->argv = NULL;
+
+	if (ctx->list_head->num_progs) {
+		cmd->list = ctx->list_head;
+	} else {
+		free_pipe_list(ctx->list_head, 0);
+		cmd->list = NULL;
+	}
+
+	if (ctx->uses_args) {
+		cmd->argc = ctx->global_argc;
+		cmd->argv = xmalloc(cmd->argc * sizeof(char *));
+		for (i = 0; i < cmd->argc; i++)
+			cmd->argv[i] = xstrdup(ctx->global_argv[i]);
+	}
+
+	/* static_get() must not be called again once the end was hit */
+	*next = (rcode == -1 || !*input.p) ? NULL : input.p;
+
+	return 0;
+}
+
+static int hush_script_parse_next(struct p_context *ctx,
+				  struct hush_script *script)
+{
+	struct hush_command cmd;
+	const char *next;
+
+	if (hush_parse_command(ctx, script->parsed, &cmd, &next))
+		return 1;
+
+	if (next)
+		script->parsed = next;
+	else
+		script->complete = true;
+
+	if (!cmd.list) {
+		hush_command_free_args(&cmd);
+		return 0;
+	}
+
+	script->commands = xrealloc(script->commands,
+			(script->num_commands + 1) * sizeof(*script->commands));
+	script->commands[script->num_commands++] = cmd;
+
+	return 0;
+}
+
+static bool hush_command_args_match(struct p_context *ctx,
+				    struct hush_command *cmd)
+{
+	int i;
+
+	if (cmd->argc < 0)
+		return true;
+
+	if (cmd->argc != ctx->global_argc)
+		return false;
+
+	for (i = 0; i < cmd->argc; i++)
+		if (strcmp(cmd->argv[i], ctx->global_argv[i]))
+			return false;
+
+	return true;
+}
+
+static int hush_script_run(struct p_context *ctx, struct hush_script *script)
+{
+	int i = 0, code = 0;
+
+	while (1) {
+		struct hush_command *cmd, new;
+		struct pipe *list, *tmp = NULL;
+		const char *next;
+
+		hush_reset_options(ctx);
+
+		if (i == script->num_commands) {
+			if (script->complete)
+				break;
+			if (hush_script_parse_next(ctx, script))
+				return 1;
+			continue;
+		}
+
+		cmd = &script->commands[i++];
+		list = cmd->list;
+
+		if (!hush_command_args_match(ctx, cmd)) {
+			if (hush_parse_command(ctx, cmd->start, &new, &next))
+				return 1;
+
+			if (script->users == 1) {
+				free_pipe_list(cmd->list, 0);
+				hush_command_free_args(cmd);
+				*cmd = new;
+			} else {
+				tmp = new.list;
+				hush_command_free_args(&new);
+			}
+
+			list = new.list;
+			if (!list)
+				continue;
+		}
+
+		/* the commands array may be reallocated from here on */
+		code = run_list_real(ctx, list);
+
+		if (tmp)
+			free_pipe_list(tmp, 0);
+
+		if (code < -1)	/* exit */
+			return code;
+
+		if (ctrlc())
+			break;
+	}
+
+	return code;
+}
+#else
+struct hush_script {
+	char *text;
+};
+
+static inline struct hush_script *hush_script_get(const char *path)
+{
+	return NULL;
+}
+
+static inline void hush_script_put(struct hush_script *script)
+{
+}
+
+static inline int hush_script_run(struct p_context *ctx,
+				  struct hush_script *script)
+{
+	return 1;
+}
+#endif
+
+static int execute_script(const char *path, int argc, char *argv[], bool profile)
 {
 	int ret;
 
 	env_push_context();
-	ret = source_script(path, argc, argv);
+	ret = source_script(path, argc, argv, profile);
 	env_pop_context();
 
 	return ret;
 }
 
-static int source_script(const char *path, int argc, char *argv[])
+static int source_script(const char *path, int argc, char *argv[], bool profile)
 {
 	struct p_context ctx = {};
-	char *script;
+	struct hush_script *script;
+	struct hush_profile *prev = NULL;
+	struct in_str input;
+	char *text;
 	int ret;
 
 	initialize_context(&ctx);
@@ -1926,18 +2542,41 @@ static int source_script(const char *path, int argc, char *argv[])
 	ctx.global_argc = argc;
 	ctx.global_argv = argv;
 
-	script = read_file(path, NULL);
-	if (!script) {
-		perror("sh");
-		return 1;
+	script = hush_script_get(path);
+	if (script) {
+		text = script->text;
+	} else {
+		text = hush_read_script(path);
+		if (!text) {
+			perror("sh");
+			return 1;
+		}
+	}
+
+	if (profile)
+		prev = hush_profile_begin(text);
+
+	if (!*text) {
+		ret = 1;
+	} else if (script) {
+		ret = hush_script_run(&ctx, script);
+	} else {
+		setup_string_in_str(&input, text);
+		ret = parse_stream_outer(&ctx, &input, FLAG_PARSE_SEMICOLON);
 	}
 
-	ret = parse_string_outer(&ctx, script, FLAG_PARSE_SEMICOLON);
 	if (ret < -1)
 		ret = -ret - 2;
 
+	if (profile)
+		hush_profile_end(prev);
+
 	release_context(&ctx);
-	free(script);
+
+	if (script)
+		hush_script_put(script);
+	else
+		free(text);
 
 	return ret;
 }
@@ -1967,17 +2606,41 @@ int run_shell(void)
 
 static int do_sh(int argc, char *argv[])
 {
+	bool profile = false;
+
+	if (IS_ENABLED(CONFIG_HUSH_PROFILE) && argc > 1 &&
+	    !strcmp(argv[1], "-P")) {
+		profile = true;
+		argc--;
+		argv++;
+	}
+
 	if (argc < 2)
-		return run_shell();
+		return profile ? COMMAND_ERROR_USAGE : run_shell();
 
-	return execute_script(argv[1], argc - 1, argv + 1);
+	return execute_script(argv[1], argc - 1, argv + 1, profile);
 }
 
+BAREBOX_CMD_HELP_START(sh)
+BAREBOX_CMD_HELP_TEXT("Execute FILE in a new shell environment, or start an interactive")
+BAREBOX_CMD_HELP_TEXT("shell when no FILE is given.")
+#ifdef CONFIG_HUSH_PROFILE
+BAREBOX_CMD_HELP_TEXT("")
+BAREBOX_CMD_HELP_TEXT("Options:")
+BAREBOX_CMD_HELP_OPT ("-P", "print the number of calls and time spent per script line")
+#endif
+BAREBOX_CMD_HELP_END
+
 BAREBOX_CMD_START(sh)
 	.cmd		= do_sh,
 	BAREBOX_CMD_DESC("execute a shell script")
+#ifdef CONFIG_HUSH_PROFILE
+	BAREBOX_CMD_OPTS("[-P] FILE [ARGUMENT...]")
+#else
 	BAREBOX_CMD_OPTS("FILE [ARGUMENT...]")
+#endif
 	BAREBOX_CMD_GROUP(CMD_GRP_SCRIPT)
+	BAREBOX_CMD_HELP(cmd_sh_help)
 BAREBOX_CMD_END
 
 static int do_source(int argc, char *argv[])
@@ -1996,7 +2659,7 @@ static int do_source(int argc, char *argv[])
 			return 1;
 	}
 
-	ret = source_script(path, argc - 1, argv + 1);
+	ret = source_script(path, argc - 1, argv + 1, false);
 
 	free(path);
 
@@ -2065,7 +2728,7 @@ BAREBOX_MAGICVAR(PS1, "hush prompt");
 
 static int binfmt_sh_excute(struct binfmt_hook *b, char *file, int argc, char **argv)
 {
-	return execute_script(file, argc, argv);
+	return execute_script(file, argc, argv, false);
 }
 
 static struct binfmt_hook binfmt_sh_hook = {
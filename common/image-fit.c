@@ -9,6 +9,7 @@
 #include <common.h>
 #include <init.h>
 #include <bootm.h>
+#include <boottrace.h>
 #include <libfile.h>
 #include <fdt.h>
 #include <digest.h>
@@ -23,6 +24,8 @@
 #include <rsa.h>
 #include <uncompress.h>
 #include <image-fit.h>
+#include <crypto.h>
+#include <smp.h>
 
 #define FDT_MAX_DEPTH 32
 #define FDT_MAX_PATH_LEN 200
@@ -357,10 +360,179 @@ static int fit_verify_signature(struct device_node *sig_node, const void *fit)
 	return ret;
 }
 
-static int fit_verify_hash(struct fit_handle *handle, struct device_node *image,
+static struct device_node *fit_get_hash_node(struct device_node *image)
+{
+	struct device_node *hash;
+
+	hash = of_get_child_by_name(image, "hash-1");
+	if (!hash)
+		hash = of_get_child_by_name(image, "hash@1");
+
+	return hash;
+}
+
+struct fit_hash_job {
+	struct smp_job job;
+	struct list_head list;
+	struct device_node *image;
+	struct digest *d;
+	const void *data;
+	int data_len;
+	u8 *md;
+	int ret;
+};
+
+static void fit_hash_job_fn(void *arg)
+{
+	struct fit_hash_job *hj = arg;
+
+	hj->ret = digest_init(hj->d);
+	if (!hj->ret)
+		hj->ret = digest_update(hj->d, hj->data, hj->data_len);
+	if (!hj->ret)
+		hj->ret = digest_final(hj->d, hj->md);
+}
+
+static struct fit_hash_job *fit_find_hash_job(struct fit_handle *handle,
+					      struct device_node *image)
+{
+	struct fit_hash_job *hj;
+
+	list_for_each_entry(hj, &handle->hash_jobs, list) {
+		if (hj->image == image) {
+			smp_job_wait(&hj->job);
+			return hj;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Start hashing an image on a secondary core. Everything that is not
+ * straightforward is left to fit_verify_hash(), which also reports
+ * the errors.
+ */
+static void fit_queue_hash(struct fit_handle *handle, struct device_node *image)
+{
+	struct fit_hash_job *hj;
+	struct device_node *hash;
+	const void *data;
+	const char *algo;
+	struct digest *d;
+	int hash_len, data_len;
+
+	list_for_each_entry(hj, &handle->hash_jobs, list)
+		if (hj->image == image)
+			return;
+
+	hash = fit_get_hash_node(image);
+	if (!hash)
+		return;
+
+	data = of_get_property(image, "data", &data_len);
+	if (!data || !of_get_property(hash, "value", &hash_len) ||
+	    of_property_read_string(hash, "algo", &algo))
+		return;
+
+	d = digest_alloc(algo);
+	if (!d)
+		return;
+
+	if (!digest_is_flags(d, DIGEST_ALGO_SMP_SAFE) ||
+	    hash_len != digest_length(d)) {
+		digest_free(d);
+		return;
+	}
+
+	hj = xzalloc(sizeof(*hj));
+	hj->job.fn = fit_hash_job_fn;
+	hj->job.arg = hj;
+	hj->image = image;
+	hj->d = d;
+	hj->data = data;
+	hj->data_len = data_len;
+	hj->md = xmalloc(hash_len);
+
+	list_add_tail(&hj->list, &handle->hash_jobs);
+
+	smp_job_queue(&hj->job);
+}
+
+/*
+ * Hash all images of a configuration in parallel, so that opening them
+ * later only has to compare the results.
+ */
+static void fit_config_queue_hashes(struct fit_handle *handle,
+				    struct device_node *conf_node)
+{
+	struct property *pp, *prop;
+
+	if (!smp_num_workers() || handle->verify == BOOTM_VERIFY_NONE)
+		return;
+
+	for_each_property_of_node(conf_node, pp) {
+		struct device_node *image;
+		const char *unit;
+
+		if (!strcmp(pp->name, "description") ||
+		    !strcmp(pp->name, "compatible"))
+			continue;
+
+		of_property_for_each_string(conf_node, pp->name, prop, unit) {
+			image = of_get_child_by_name(handle->images, unit);
+			if (image)
+				fit_queue_hash(handle, image);
+		}
+	}
+}
+
+static void fit_free_hash_jobs(struct fit_handle *handle)
+{
+	struct fit_hash_job *hj, *tmp;
+
+	list_for_each_entry_safe(hj, tmp, &handle->hash_jobs, list) {
+		smp_job_wait(&hj->job);
+		digest_free(hj->d);
+		free(hj->md);
+		free(hj);
+	}
+}
+
+static int fit_hash_verify(struct device_node *hash, const char *algo,
+			   const void *value, int hash_len,
 			   const void *data, int data_len)
 {
 	struct digest *d;
+	int ret;
+
+	d = digest_alloc(algo);
+	if (!d) {
+		pr_err("%s: unsupported algo %s\n", hash->full_name, algo);
+		return -EINVAL;
+	}
+
+	if (hash_len != digest_length(d)) {
+		pr_err("%s: invalid hash length %d\n", hash->full_name, hash_len);
+		ret = -EINVAL;
+		goto err_digest_free;
+	}
+
+	digest_init(d);
+	digest_update(d, data, data_len);
+
+	ret = digest_verify(d, value) ? -EBADMSG : 0;
+
+err_digest_free:
+	digest_free(d);
+
+	return ret;
+}
+
+static int fit_verify_hash(struct fit_handle *handle, struct device_node *image,
+			   const void *data, int data_len)
+{
+	struct fit_hash_job *hj;
 	const char *algo;
 	const char *value_read;
 	int hash_len, ret;
@@ -376,9 +548,7 @@ static int fit_verify_hash(struct fit_handle *handle, struct device_node *image,
 		ret = -EINVAL;
 	}
 
-	hash = of_get_child_by_name(image, "hash-1");
-	if (!hash)
-		hash = of_get_child_by_name(image, "hash@1");
+	hash = fit_get_hash_node(image);
 	if (!hash) {
 		if (ret)
 			pr_err("image %s does not have hashes\n",
@@ -397,31 +567,21 @@ static int fit_verify_hash(struct fit_handle *handle, struct device_node *image,
 		return -EINVAL;
 	}
 
-	d = digest_alloc(algo);
-	if (!d) {
-		pr_err("%s: unsupported algo %s\n", hash->full_name, algo);
-		return -EINVAL;
-	}
-
-	if (hash_len != digest_length(d)) {
-		pr_err("%s: invalid hash length %d\n", hash->full_name, hash_len);
-		ret = -EINVAL;
-		goto err_digest_free;
-	}
-
-	digest_init(d);
-	digest_update(d, data, data_len);
+	hj = fit_find_hash_job(handle, image);
+	if (hj && hj->ret) {
+		pr_err("%s: hashing failed: %pe\n", hash->full_name,
+		       ERR_PTR(hj->ret));
+		return hj->ret;
+	} else if (hj)
+		ret = crypto_memneq(hj->md, value_read, hash_len) ? -EBADMSG : 0;
+	else
+		ret = fit_hash_verify(hash, algo, value_read, hash_len,
+				      data, data_len);
 
-	if (digest_verify(d, value_read)) {
+	if (ret == -EBADMSG)
 		pr_info("%s: hash BAD\n", hash->full_name);
-		ret =  -EBADMSG;
-	} else {
+	else if (!ret)
 		pr_info("%s: hash OK\n", hash->full_name);
-		ret = 0;
-	}
-
-err_digest_free:
-	digest_free(d);
 
 	return ret;
 }
@@ -612,10 +772,12 @@ int fit_open_image(struct fit_handle *handle, void *configuration,
 		return -EINVAL;
 	}
 
+	boottrace_begin(BOOTTRACE_FIT, unit);
 	if (configuration)
 		ret = fit_verify_hash(handle, image, data, data_len);
 	else
 		ret = fit_image_verify_signature(handle, image, data, data_len);
+	boottrace_end(BOOTTRACE_FIT, unit);
 
 	if (ret < 0)
 		return ret;
@@ -672,7 +834,9 @@ static int fit_config_verify_signature(struct fit_handle *handle, struct device_
 	for_each_child_of_node(conf_node, sig_node) {
 		if (handle->verbose)
 			of_print_nodes(sig_node, 0, ~0);
+		boottrace_begin(BOOTTRACE_FIT, conf_node->name);
 		ret = fit_verify_signature(sig_node, handle->fit);
+		boottrace_end(BOOTTRACE_FIT, conf_node->name);
 		if (ret < 0)
 			return ret;
 	}
@@ -761,6 +925,8 @@ void *fit_open_configuration(struct fit_handle *handle, const char *name)
 	if (ret)
 		return ERR_PTR(ret);
 
+	fit_config_queue_hashes(handle, conf_node);
+
 	return conf_node;
 }
 
@@ -807,6 +973,7 @@ struct fit_handle *fit_open_buf(const void *buf, size_t size, bool verbose,
 	int ret;
 
 	handle = xzalloc(sizeof(struct fit_handle));
+	INIT_LIST_HEAD(&handle->hash_jobs);
 
 	handle->verbose = verbose;
 	handle->fit = buf;
@@ -822,6 +989,44 @@ struct fit_handle *fit_open_buf(const void *buf, size_t size, bool verbose,
 	return handle;
 }
 
+/*
+ * Use the image in place when the file is in memory already, e.g. in
+ * ramfs after a download, instead of reading it into another buffer.
+ */
+static int fit_map_file(struct fit_handle *handle, const char *filename,
+			loff_t max_size)
+{
+	struct stat s;
+	void *map;
+	int fd, ret;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return fd;
+
+	ret = fstat(fd, &s);
+	if (ret)
+		goto out;
+
+	if (s.st_size == FILE_SIZE_STREAM) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	map = memmap(fd, PROT_READ);
+	if (map == MAP_FAILED) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	handle->fit = map;
+	handle->size = min_t(loff_t, s.st_size, max_size);
+out:
+	close(fd);
+
+	return ret;
+}
+
 /**
  * fit_open - open a FIT image
  * @filename:	The filename of the FIT image
@@ -841,18 +1046,22 @@ struct fit_handle *fit_open(const char *filename, bool verbose,
 	int ret;
 
 	handle = xzalloc(sizeof(struct fit_handle));
+	INIT_LIST_HEAD(&handle->hash_jobs);
 
 	handle->verbose = verbose;
 	handle->verify = verify;
 
-	ret = read_file_2(filename, &handle->size, &handle->fit_alloc,
-			  max_size);
-	if (ret && ret != -EFBIG) {
-		pr_err("unable to read %s: %s\n", filename, strerror(-ret));
-		return ERR_PTR(ret);
-	}
+	ret = fit_map_file(handle, filename, max_size);
+	if (ret) {
+		ret = read_file_2(filename, &handle->size, &handle->fit_alloc,
+				  max_size);
+		if (ret && ret != -EFBIG) {
+			pr_err("unable to read %s: %s\n", filename, strerror(-ret));
+			return ERR_PTR(ret);
+		}
 
-	handle->fit = handle->fit_alloc;
+		handle->fit = handle->fit_alloc;
+	}
 
 	ret = fit_do_open(handle);
 	if (ret) {
@@ -865,6 +1074,8 @@ struct fit_handle *fit_open(const char *filename, bool verbose,
 
 void fit_close(struct fit_handle *handle)
 {
+	fit_free_hash_jobs(handle);
+
 	if (handle->root)
 		of_delete_node(handle->root);
 
@@ -17,6 +17,7 @@
 #include <memtest.h>
 #include <malloc.h>
 #include <mmu.h>
+#include <smp.h>
 
 static int alloc_memtest_region(struct list_head *list,
 		resource_size_t start, resource_size_t size)
@@ -357,11 +358,118 @@ static int update_progress(resource_size_t offset, unsigned flags)
 	return 0;
 }
 
+/* Number of words each moving inversions pass handles between progress updates */
+#define MEMTEST_MI_BLOCK	(SZ_4M / sizeof(resource_size_t))
+
+struct mem_test_mi_job {
+	struct smp_job job;
+	volatile resource_size_t *start;
+	resource_size_t first, last;
+	int pass;
+
+	/* set on failure */
+	bool failed;
+	resource_size_t offset, expected, actual;
+};
+
+/*
+ * One pass over a slice of the region. This may run on a secondary core,
+ * so failures are only recorded and reported by the boot CPU.
+ */
+static void mem_test_mi_slice(void *arg)
+{
+	struct mem_test_mi_job *j = arg;
+	volatile resource_size_t *start = j->start;
+	resource_size_t offset, temp, expected;
+
+	j->failed = false;
+
+	if (j->pass == 0) {
+		/* Fill memory with a known pattern */
+		for (offset = j->first; offset < j->last; offset++)
+			start[offset] = offset + 1;
+
+		return;
+	}
+
+	for (offset = j->first; offset < j->last; offset++) {
+		/*
+		 * First check each location and invert it, then check
+		 * each location for the inverted pattern and zero it
+		 */
+		expected = j->pass == 1 ? offset + 1 : ~(offset + 1);
+		temp = start[offset];
+
+		if (temp != expected) {
+			j->failed = true;
+			j->offset = offset;
+			j->expected = expected;
+			j->actual = temp;
+			return;
+		}
+
+		start[offset] = j->pass == 1 ? ~(offset + 1) : 0;
+	}
+}
+
+static int mem_test_mi_pass(volatile resource_size_t *start,
+			    resource_size_t num_words, int pass, unsigned flags)
+{
+	struct mem_test_mi_job jobs[SMP_MAX_WORKERS + 1];
+	resource_size_t offset, len, chunk;
+	unsigned int i, nr;
+	int ret;
+
+	for (offset = 0; offset < num_words; offset += len) {
+		ret = update_progress(ALIGN_DOWN(pass * num_words + offset, SZ_4K),
+				      flags);
+		if (ret)
+			return ret;
+
+		len = min_t(resource_size_t, num_words - offset, MEMTEST_MI_BLOCK);
+		chunk = DIV_ROUND_UP(len, smp_num_workers() + 1);
+
+		/* Split the block between the secondary cores and ourselves */
+		for (i = 0, nr = 0; i < len; i += chunk, nr++) {
+			jobs[nr].job.fn = mem_test_mi_slice;
+			jobs[nr].job.arg = &jobs[nr];
+			jobs[nr].start = start;
+			jobs[nr].first = offset + i;
+			jobs[nr].last = offset + min(i + chunk, len);
+			jobs[nr].pass = pass;
+		}
+
+		for (i = 1; i < nr; i++)
+			smp_job_queue(&jobs[i].job);
+
+		mem_test_mi_slice(&jobs[0]);
+
+		for (i = 1; i < nr; i++)
+			smp_job_wait(&jobs[i].job);
+
+		/* Report the lowest failing address, as the serial test did */
+		for (i = 0; i < nr; i++) {
+			if (!jobs[i].failed)
+				continue;
+
+			printf("\n");
+			mem_test_report_failure("read/write",
+						jobs[i].expected,
+						jobs[i].actual,
+						&start[jobs[i].offset]);
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
 int mem_test_moving_inversions(resource_size_t _start, resource_size_t _end,
 			       unsigned flags)
 {
-	volatile resource_size_t *start, num_words, offset, temp, anti_pattern;
-	int ret;
+	volatile resource_size_t *start;
+	resource_size_t num_words;
+	int pass, ret;
 
 	_start = ALIGN(_start, sizeof(resource_size_t));
 	_end = ALIGN_DOWN(_end, sizeof(resource_size_t)) - 1;
@@ -388,54 +496,17 @@ int mem_test_moving_inversions(resource_size_t _start, resource_size_t _end,
 	 *		as a zero and a one. The base address
 	 *		and the size of the region are
 	 *		selected by the caller.
+	 *
+	 *		Every pass is split into blocks, which
+	 *		are shared with the secondary cores if
+	 *		there are any.
 	 */
-
-	/* Fill memory with a known pattern */
-	for (offset = 0; offset < num_words; offset++) {
-		ret = update_progress(offset, flags);
+	for (pass = 0; pass < 3; pass++) {
+		ret = mem_test_mi_pass(start, num_words, pass, flags);
 		if (ret)
 			return ret;
-		start[offset] = offset + 1;
 	}
 
-	/* Check each location and invert it for the second pass */
-	for (offset = 0; offset < num_words; offset++) {
-		ret = update_progress(num_words + offset, flags);
-		if (ret)
-			return ret;
-
-		temp = start[offset];
-		if (temp != (offset + 1)) {
-			printf("\n");
-			mem_test_report_failure("read/write",
-						(offset + 1),
-						temp, &start[offset]);
-			return -EIO;
-		}
-
-		anti_pattern = ~(offset + 1);
-		start[offset] = anti_pattern;
-	}
-
-	/* Check each location for the inverted pattern and zero it */
-	for (offset = 0; offset < num_words; offset++) {
-		ret = update_progress(2 * num_words + offset, flags);
-		if (ret)
-			return ret;
-
-		anti_pattern = ~(offset + 1);
-		temp = start[offset];
-
-		if (temp != anti_pattern) {
-			printf("\n");
-			mem_test_report_failure("read/write",
-						anti_pattern,
-						temp, &start[offset]);
-			return -EIO;
-		}
-
-		start[offset] = 0;
-	}
 	if (flags & MEMTEST_VERBOSE) {
 		show_progress(3 * num_words);
 
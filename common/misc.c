@@ -224,6 +224,8 @@ static void __noreturn do_panic(bool stacktrace, const char *fmt, va_list ap)
 	if (stacktrace)
 		dump_stack();
 
+	console_flush();
+
 	led_trigger(LED_TRIGGER_PANIC, TRIGGER_ENABLE);
 
 	if (IS_ENABLED(CONFIG_PANIC_HANG)) {
@@ -11,6 +11,8 @@
 #include <malloc.h>
 #include <errno.h>
 #include <block.h>
+#include <bootcache.h>
+#include <crc.h>
 #include <asm/unaligned.h>
 #include <disks.h>
 #include <filetype.h>
@@ -52,6 +54,7 @@ static int register_one_partition(struct block_device *blk,
 
 	cdev->dos_partition_type = part->dos_partition_type;
 	strcpy(cdev->uuid, part->partuuid);
+	strcpy(cdev->typeuuid, part->typeuuid);
 
 	free(partition_name);
 
@@ -100,6 +103,101 @@ static struct partition_parser *partition_parser_get_by_filetype(uint8_t *buf)
 	return NULL;
 }
 
+/*
+ * Parsing a GPT reads the partition entries twice, from the start and
+ * from the end of the device. The primary GPT header in the first two
+ * blocks carries a crc of the entries, so a table parsed before from the
+ * same first two blocks of a device of the same size can be used as is.
+ * Besides the partitions, the GPT parser sets the disk GUID, which is
+ * cached as well.
+ */
+#define PARTITION_CACHE_VERSION	1
+
+struct partition_cache {
+	u32 version;		/* PARTITION_CACHE_VERSION */
+	u32 part_size;		/* sizeof(struct partition) */
+	u32 crc;		/* crc32 of the first two blocks */
+	u32 used_entries;
+	u64 num_blocks;
+	char disk_uuid[MAX_UUID_STR];
+	struct partition parts[];
+};
+
+static void partition_cache_key(struct block_device *blk, char *key)
+{
+	snprintf(key, BOOTCACHE_KEY_LEN, "part:%s", blk->cdev.name);
+}
+
+static bool partition_cache_load(struct block_device *blk, uint8_t *buf,
+				 struct partition_desc *pdesc)
+{
+	struct partition_cache *pc;
+	char key[BOOTCACHE_KEY_LEN];
+	size_t size = struct_size(pc, parts, MAX_PARTITION);
+	ssize_t len;
+	bool ret = false;
+
+	if (!IS_ENABLED(CONFIG_BOOTCACHE))
+		return false;
+
+	partition_cache_key(blk, key);
+
+	pc = xmalloc(size);
+
+	len = bootcache_load(key, pc, size);
+	if (len < (ssize_t)sizeof(*pc) || len > size ||
+	    pc->version != PARTITION_CACHE_VERSION ||
+	    pc->part_size != sizeof(*pc->parts) ||
+	    len != struct_size(pc, parts, pc->used_entries))
+		goto out;
+
+	if (pc->crc != crc32(0, buf, 2 << blk->blockbits) ||
+	    pc->num_blocks != blk->num_blocks)
+		goto out;
+
+	pdesc->used_entries = pc->used_entries;
+	memcpy(pdesc->parts, pc->parts, pc->used_entries * sizeof(*pc->parts));
+
+	if (pc->disk_uuid[0]) {
+		memcpy(blk->cdev.uuid, pc->disk_uuid, sizeof(blk->cdev.uuid));
+		blk->cdev.uuid[sizeof(blk->cdev.uuid) - 1] = 0;
+		dev_add_param_string_fixed(blk->dev, "guid", blk->cdev.uuid);
+	}
+
+	dev_dbg(blk->dev, "using cached partition table\n");
+	ret = true;
+out:
+	free(pc);
+
+	return ret;
+}
+
+static void partition_cache_store(struct block_device *blk, uint8_t *buf,
+				  struct partition_desc *pdesc)
+{
+	struct partition_cache *pc;
+	char key[BOOTCACHE_KEY_LEN];
+	size_t size = struct_size(pc, parts, pdesc->used_entries);
+
+	if (!IS_ENABLED(CONFIG_BOOTCACHE))
+		return;
+
+	partition_cache_key(blk, key);
+
+	pc = xzalloc(size);
+	pc->version = PARTITION_CACHE_VERSION;
+	pc->part_size = sizeof(*pc->parts);
+	pc->crc = crc32(0, buf, 2 << blk->blockbits);
+	pc->used_entries = pdesc->used_entries;
+	pc->num_blocks = blk->num_blocks;
+	memcpy(pc->disk_uuid, blk->cdev.uuid, sizeof(pc->disk_uuid));
+	memcpy(pc->parts, pdesc->parts, pdesc->used_entries * sizeof(*pc->parts));
+
+	bootcache_store(key, pc, size);
+
+	free(pc);
+}
+
 /**
  * Try to collect partition information on the given block device
  * @param blk Block device to examine
@@ -116,7 +214,7 @@ int parse_partition_table(struct block_device *blk)
 	uint8_t *buf;
 
 	pdesc = xzalloc(sizeof(*pdesc));
-	buf = malloc(2 * SECTOR_SIZE);
+	buf = malloc(2 << blk->blockbits);
 
 	rc = block_read(blk, buf, 0, 2);
 	if (rc != 0) {
@@ -124,14 +222,20 @@ int parse_partition_table(struct block_device *blk)
 		goto on_error;
 	}
 
-	parser = partition_parser_get_by_filetype(buf);
-	if (!parser)
-		goto on_error;
+	if (!partition_cache_load(blk, buf, pdesc)) {
+		parser = partition_parser_get_by_filetype(buf);
+		if (!parser)
+			goto on_error;
 
-	parser->parse(buf, blk, pdesc);
+		parser->parse(buf, blk, pdesc);
 
-	if (!pdesc->used_entries)
-		goto on_error;
+		if (!pdesc->used_entries)
+			goto on_error;
+
+		/* DOS tables may continue outside of the first sectors */
+		if (parser->type == filetype_gpt)
+			partition_cache_store(blk, buf, pdesc);
+	}
 
 	/* at least one partition description found */
 	for (i = 0; i < pdesc->used_entries; i++) {
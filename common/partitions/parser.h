@@ -18,6 +18,7 @@ struct partition {
 	char name[MAX_PARTITION_NAME];
 	u8 dos_partition_type;
 	char partuuid[MAX_UUID_STR];
+	char typeuuid[MAX_UUID_STR];
 	uint64_t first_sec;
 	uint64_t size;
 };
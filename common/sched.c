@@ -18,6 +18,9 @@ void resched(void)
 	if (run_workqueues) {
 		wq_do_all_works();
 		bthread_reschedule();
+	} else {
+		/* see bthread_set_parallel() */
+		bthread_reschedule_parallel();
 	}
 
 	poller_call();
@@ -0,0 +1,243 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * slab.c - caches of fixed size objects
+ *
+ * Objects are carved out of chunks which are allocated from the general
+ * allocator and never given back before the cache is destroyed. Free
+ * objects are kept in a per-cache free list, so allocating and freeing
+ * them costs a couple of pointer operations and does not fragment the
+ * malloc pool with lots of small blocks.
+ */
+
+#define pr_fmt(fmt) "slab: " fmt
+
+#include <common.h>
+#include <malloc.h>
+#include <linux/kasan.h>
+#include <linux/list.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+
+#define SLAB_CHUNK_SIZE		SZ_4K
+#define SLAB_MIN_OBJECTS	8
+#define SLAB_POISON_FREE	0x6b
+
+struct kmem_slab {
+	struct list_head list;
+};
+
+struct kmem_cache {
+	char *name;
+	unsigned int object_size;	/* as requested */
+	unsigned int size;		/* including padding */
+	unsigned int align;
+	unsigned int per_slab;
+	void (*ctor)(void *);
+
+	void *freelist;
+	struct list_head slabs;
+	struct list_head list;
+
+	/* statistics */
+	unsigned int nr_slabs;
+	unsigned int active;
+	unsigned int high;
+	unsigned long allocs;
+};
+
+static LIST_HEAD(kmem_caches);
+
+static inline unsigned int kmem_slab_offset(struct kmem_cache *cache)
+{
+	return ALIGN(sizeof(struct kmem_slab), cache->align);
+}
+
+static void kmem_poison(struct kmem_cache *cache, void *obj)
+{
+	if (!IS_ENABLED(CONFIG_SLAB_POISON))
+		return;
+
+	memset(obj, SLAB_POISON_FREE, cache->size);
+	kasan_poison_shadow(obj, cache->size, KASAN_KMALLOC_FREE);
+}
+
+/*
+ * The first word of a free object holds the free list link, everything
+ * behind it must still be poisoned. Otherwise somebody wrote to the
+ * object after freeing it.
+ */
+static void kmem_check_poison(struct kmem_cache *cache, void *obj)
+{
+	u8 *p = obj;
+	int i;
+
+	if (!IS_ENABLED(CONFIG_SLAB_POISON))
+		return;
+
+	for (i = sizeof(void *); i < cache->size; i++) {
+		if (p[i] != SLAB_POISON_FREE) {
+			pr_err("%s: object %p modified after free at offset %d\n",
+			       cache->name, obj, i);
+			break;
+		}
+	}
+
+	kasan_unpoison_shadow(obj, cache->object_size);
+}
+
+static void kmem_push(struct kmem_cache *cache, void *obj)
+{
+	kmem_poison(cache, obj);
+
+	*(void **)obj = cache->freelist;
+	cache->freelist = obj;
+}
+
+static int kmem_cache_grow(struct kmem_cache *cache)
+{
+	struct kmem_slab *slab;
+	void *objs;
+	int i;
+
+	slab = memalign(cache->align, kmem_slab_offset(cache) +
+			cache->per_slab * cache->size);
+	if (!slab)
+		return -ENOMEM;
+
+	list_add(&slab->list, &cache->slabs);
+	cache->nr_slabs++;
+
+	/* push backwards, so objects are handed out in address order */
+	objs = (void *)slab + kmem_slab_offset(cache);
+	for (i = cache->per_slab - 1; i >= 0; i--)
+		kmem_push(cache, objs + i * cache->size);
+
+	return 0;
+}
+
+/**
+ * kmem_cache_create - create a cache for objects of a fixed size
+ * @name: Name of the cache, shown by meminfo
+ * @size: Size of the objects
+ * @align: Required alignment of the objects, 0 for pointer alignment
+ * @flags: SLAB_* flags, currently unused
+ * @ctor: Optional function called on each object handed out
+ *
+ * Return: The new cache or NULL when out of memory
+ */
+struct kmem_cache *kmem_cache_create(const char *name, unsigned int size,
+				     unsigned int align, slab_flags_t flags,
+				     void (*ctor)(void *))
+{
+	struct kmem_cache *cache;
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+
+	cache->name = strdup(name);
+	cache->object_size = size;
+	cache->align = max_t(unsigned int, align, sizeof(void *));
+	cache->size = ALIGN(max_t(unsigned int, size, sizeof(void *)),
+			    cache->align);
+	cache->per_slab = max_t(unsigned int, SLAB_MIN_OBJECTS,
+				(SLAB_CHUNK_SIZE - kmem_slab_offset(cache)) /
+				cache->size);
+	cache->ctor = ctor;
+	INIT_LIST_HEAD(&cache->slabs);
+
+	list_add_tail(&cache->list, &kmem_caches);
+
+	return cache;
+}
+
+/**
+ * kmem_cache_destroy - free a cache and all of its memory
+ * @cache: The cache to destroy
+ *
+ * All objects must have been returned to the cache before.
+ */
+void kmem_cache_destroy(struct kmem_cache *cache)
+{
+	struct kmem_slab *slab, *tmp;
+
+	if (!cache)
+		return;
+
+	if (cache->active)
+		pr_warn("%s: destroyed with %u objects in use\n", cache->name,
+			cache->active);
+
+	list_for_each_entry_safe(slab, tmp, &cache->slabs, list) {
+		kasan_unpoison_shadow(slab, kmem_slab_offset(cache) +
+				      cache->per_slab * cache->size);
+		free(slab);
+	}
+
+	list_del(&cache->list);
+	free(cache->name);
+	free(cache);
+}
+
+void *kmem_cache_alloc(struct kmem_cache *cache, gfp_t flags)
+{
+	void *obj;
+
+	if (!cache->freelist && kmem_cache_grow(cache))
+		return NULL;
+
+	obj = cache->freelist;
+	cache->freelist = *(void **)obj;
+
+	kmem_check_poison(cache, obj);
+
+	cache->active++;
+	cache->high = max(cache->high, cache->active);
+	cache->allocs++;
+
+	if (cache->ctor)
+		cache->ctor(obj);
+
+	return obj;
+}
+
+void kmem_cache_free(struct kmem_cache *cache, void *obj)
+{
+	if (!obj)
+		return;
+
+	kmem_push(cache, obj);
+	cache->active--;
+}
+
+unsigned int kmem_cache_size(struct kmem_cache *cache)
+{
+	return cache->object_size;
+}
+
+/**
+ * kmem_cache_print_stats - print usage of all caches
+ */
+void kmem_cache_print_stats(void)
+{
+	struct kmem_cache *cache;
+	size_t total = 0;
+
+	if (list_empty(&kmem_caches))
+		return;
+
+	printf("%-20s %7s %7s %7s %7s %9s\n", "cache", "objsize", "active",
+	       "total", "high", "allocs");
+
+	list_for_each_entry(cache, &kmem_caches, list) {
+		printf("%-20s %7u %7u %7u %7u %9lu\n", cache->name,
+		       cache->object_size, cache->active,
+		       cache->nr_slabs * cache->per_slab, cache->high,
+		       cache->allocs);
+
+		total += cache->nr_slabs * (kmem_slab_offset(cache) +
+					    cache->per_slab * cache->size);
+	}
+
+	printf("slab: %zu\n", total);
+}
@@ -39,6 +39,7 @@
 #include <glob.h>
 #include <net.h>
 #include <bselftest.h>
+#include <boottrace.h>
 
 extern initcall_t __barebox_initcalls_start[], __barebox_early_initcalls_end[],
 		  __barebox_initcalls_end[];
@@ -351,7 +352,9 @@ void __noreturn start_barebox(void)
 	for (initcall = __barebox_initcalls_start;
 			initcall < __barebox_initcalls_end; initcall++) {
 		pr_debug("initcall-> %pS\n", *initcall);
+		boottrace_begin_fn(BOOTTRACE_INITCALL, *initcall);
 		result = (*initcall)();
+		boottrace_end_fn(BOOTTRACE_INITCALL, *initcall);
 		if (result)
 			pr_err("initcall %pS failed: %s\n", *initcall,
 					strerror(-result));
@@ -288,6 +288,7 @@ static struct digest_algo m = {
 		.driver_name	=	"sha1-generic",
 		.priority	=	0,
 		.algo		=	HASH_ALGO_SHA1,
+		.flags		=	DIGEST_ALGO_SMP_SAFE,
 	},
 
 	.init		= sha1_init,
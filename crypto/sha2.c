@@ -325,6 +325,7 @@ static struct digest_algo m224 = {
 		.driver_name	=	"sha224-generic",
 		.priority	=	0,
 		.algo		=	HASH_ALGO_SHA224,
+		.flags		=	DIGEST_ALGO_SMP_SAFE,
 	},
 
 	.init		= sha224_init,
@@ -351,6 +352,7 @@ struct digest_algo m256 = {
 		.driver_name	=	"sha256-generic",
 		.priority	=	0,
 		.algo		=	HASH_ALGO_SHA256,
+		.flags		=	DIGEST_ALGO_SMP_SAFE,
 	},
 
 	.init		= sha256_init,
@@ -244,6 +244,7 @@ static struct digest_algo m384 = {
 		.driver_name	=	"sha384-generic",
 		.priority	=	0,
 		.algo		=	HASH_ALGO_SHA384,
+		.flags		=	DIGEST_ALGO_SMP_SAFE,
 	},
 
 	.init		= sha384_init,
@@ -271,6 +272,7 @@ static struct digest_algo m512 = {
 		.driver_name	=	"sha512-generic",
 		.priority	=	0,
 		.algo		=	HASH_ALGO_SHA512,
+		.flags		=	DIGEST_ALGO_SMP_SAFE,
 	},
 
 	.init		= sha512_init,
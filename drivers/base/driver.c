@@ -14,6 +14,9 @@
 
 #include <common.h>
 #include <command.h>
+#include <boottrace.h>
+#include <bthread.h>
+#include <clock.h>
 #include <deep-probe.h>
 #include <driver.h>
 #include <malloc.h>
@@ -25,6 +28,8 @@
 #include <of.h>
 #include <linux/list.h>
 #include <linux/err.h>
+#include <linux/hashtable.h>
+#include <linux/stringhash.h>
 #include <complete.h>
 #include <pinctrl.h>
 #include <featctrl.h>
@@ -46,6 +51,25 @@ LIST_HEAD(active_device_list);
 EXPORT_SYMBOL(active_device_list);
 static LIST_HEAD(deferred);
 
+/*
+ * Registered devices indexed by their unique name as returned by
+ * dev_name() and by their plain name, which is used to allocate ids.
+ */
+static DEFINE_HASHTABLE(device_hashtable, 9);
+static DEFINE_HASHTABLE(device_name_hashtable, 9);
+
+static void device_hash(struct device *dev)
+{
+	hash_add(device_hashtable, &dev->hash, str_hash(dev_name(dev)));
+	hash_add(device_name_hashtable, &dev->name_hash, str_hash(dev->name));
+}
+
+static void device_unhash(struct device *dev)
+{
+	hash_del(&dev->hash);
+	hash_del(&dev->name_hash);
+}
+
 struct device *find_device(const char *str)
 {
 	struct device *dev;
@@ -66,7 +90,7 @@ struct device *get_device_by_name(const char *name)
 {
 	struct device *dev;
 
-	for_each_device(dev) {
+	hash_for_each_possible(device_hashtable, dev, hash, str_hash(name)) {
 		if(!strcmp(dev_name(dev), name))
 			return dev;
 	}
@@ -78,7 +102,8 @@ static struct device *get_device_by_name_id(const char *name, int id)
 {
 	struct device *dev;
 
-	for_each_device(dev) {
+	hash_for_each_possible(device_name_hashtable, dev, name_hash,
+			       str_hash(name)) {
 		if(!strcmp(dev->name, name) && id == dev->id)
 			return dev;
 	}
@@ -97,33 +122,62 @@ int get_free_deviceid(const char *name_template)
 	};
 }
 
-int device_probe(struct device *dev)
-{
-	static int depth = 0;
-	int ret;
+static struct device *probing_dev;
+static unsigned int probe_order;
 
-	ret = of_feature_controller_check(dev->of_node);
-	if (ret < 0)
-		return ret;
-	if (ret == FEATCTRL_GATED) {
-		dev_dbg(dev, "feature gated, skipping probe\n");
-		return -ENODEV;
-	}
+/* true when called from a bthread instead of the main thread */
+static bool probe_in_thread(void)
+{
+	return IS_ENABLED(CONFIG_BTHREAD) && !bthread_is_main(current);
+}
 
-	depth++;
+/**
+ * device_probe_wait_for - record the supplier a probe waits for
+ * @supplier: The device node of the missing supplier
+ *
+ * Called by the supplier lookups (clocks, regulators, gpios, phys) when
+ * they return -EPROBE_DEFER. A deferred device is then only probed again
+ * once @supplier or one of its parents has been probed.
+ */
+void device_probe_wait_for(struct device_node *supplier)
+{
+	/* probing_dev belongs to the main thread */
+	if (probing_dev && !probe_in_thread())
+		probing_dev->deferred_supplier = supplier;
+}
 
-	pr_report_probe("%*sprobe-> %s\n", depth * 4, "", dev_name(dev));
+/* Make the devices waiting for @dev eligible for another probe */
+static void device_supplier_probed(struct device *dev)
+{
+	struct device *waiting;
+	struct device_node *np;
 
-	pinctrl_select_state_default(dev);
-	of_clk_set_defaults(dev->of_node, false);
+	if (!dev->of_node)
+		return;
 
-	list_add(&dev->active, &active_device_list);
+	list_for_each_entry(waiting, &deferred, active) {
+		for (np = waiting->deferred_supplier; np; np = np->parent) {
+			if (np == dev->of_node) {
+				waiting->deferred_supplier = NULL;
+				break;
+			}
+		}
+	}
+}
 
-	ret = dev->bus->probe(dev);
-	if (ret == 0)
-		goto out;
+static int device_probe_finish(struct device *dev, int ret, u64 start)
+{
+	if (ret == 0) {
+		dev->probe_ns = get_time_ns() - start;
+		dev->probe_order = ++probe_order;
+		device_supplier_probed(dev);
+		return 0;
+	}
 
 	if (ret == -EPROBE_DEFER) {
+		dev->deferred_ns += get_time_ns() - start;
+		dev->deferrals++;
+
 		list_del(&dev->active);
 		list_add(&dev->active, &deferred);
 
@@ -135,9 +189,10 @@ int device_probe(struct device *dev)
 			dev_err(dev, "probe deferred\n");
 		else
 			dev_dbg(dev, "probe deferred\n");
-		goto out;
+		return ret;
 	}
 
+	dev->deferred_supplier = NULL;
 	list_del(&dev->active);
 	INIT_LIST_HEAD(&dev->active);
 
@@ -146,6 +201,185 @@ int device_probe(struct device *dev)
 	else
 		dev_err(dev, "probe failed: %s\n", strerror(-ret));
 
+	return ret;
+}
+
+/*
+ * Drivers with async_probe set are probed in a bthread, so that their
+ * waits for the hardware overlap with other probes. The device is bound
+ * to the driver right away and the result is collected when the probe
+ * is joined: before the device is looked up by its device node, detected
+ * or unregistered, and for all devices before the deferred probes are
+ * retried in late_initcall. Devices registered after that are probed
+ * synchronously.
+ */
+struct async_probe {
+	struct list_head list;
+	struct device *dev;
+	struct bthread *thread;
+	u64 start;
+	int ret;
+};
+
+static LIST_HEAD(async_probes);
+static bool async_probe_done;
+
+static void device_probe_thread(void *data)
+{
+	struct async_probe *ap = data;
+	struct device *dev = ap->dev;
+
+	boottrace_begin(BOOTTRACE_PROBE, dev_name(dev));
+	ap->ret = dev->bus->probe(dev);
+	boottrace_end(BOOTTRACE_PROBE, dev_name(dev));
+}
+
+static bool device_probe_async(struct device *dev)
+{
+	struct async_probe *ap;
+
+	if (!IS_ENABLED(CONFIG_ASYNC_PROBE) || !dev->driver->async_probe ||
+	    async_probe_done || probe_in_thread())
+		return false;
+
+	ap = xzalloc(sizeof(*ap));
+	ap->dev = dev;
+	ap->start = get_time_ns();
+
+	ap->thread = bthread_run(device_probe_thread, ap, "probe-%s",
+				 dev_name(dev));
+	if (!ap->thread) {
+		free(ap);
+		return false;
+	}
+
+	/* let the main thread and other probes run while this one waits */
+	bthread_set_parallel(ap->thread);
+
+	dev->deferred_supplier = NULL;
+	list_add_tail(&ap->list, &async_probes);
+
+	return true;
+}
+
+static void device_probe_join_one(struct async_probe *ap)
+{
+	struct device *dev = ap->dev;
+
+	list_del(&ap->list);
+
+	dev_dbg(dev, "joining probe\n");
+
+	__bthread_stop(ap->thread);
+
+	/* match() would have done this for a synchronous probe */
+	if (device_probe_finish(dev, ap->ret, ap->start))
+		dev->driver = NULL;
+
+	free(ap);
+}
+
+/**
+ * device_probe_join - wait for the asynchronous probe of a device
+ * @dev: The device
+ */
+void device_probe_join(struct device *dev)
+{
+	struct async_probe *ap;
+
+	if (!IS_ENABLED(CONFIG_ASYNC_PROBE))
+		return;
+
+	list_for_each_entry(ap, &async_probes, list) {
+		if (ap->dev == dev && ap->thread != current) {
+			device_probe_join_one(ap);
+			return;
+		}
+	}
+}
+
+/**
+ * device_probe_join_node - wait for the asynchronous probes providing a node
+ * @np: The device node
+ *
+ * Waits for the probes of the devices of @np and its parents, so that the
+ * resources described by @np are registered if their driver provides them.
+ */
+void device_probe_join_node(struct device_node *np)
+{
+	struct async_probe *ap;
+	struct device_node *n;
+
+	if (!IS_ENABLED(CONFIG_ASYNC_PROBE))
+		return;
+again:
+	list_for_each_entry(ap, &async_probes, list) {
+		if (ap->thread == current)
+			continue;
+
+		for (n = np; n; n = n->parent) {
+			if (n == ap->dev->of_node) {
+				device_probe_join_one(ap);
+				goto again;
+			}
+		}
+	}
+}
+
+static void device_probe_join_all(void)
+{
+	if (!IS_ENABLED(CONFIG_ASYNC_PROBE))
+		return;
+
+	async_probe_done = true;
+
+	while (!list_empty(&async_probes))
+		device_probe_join_one(list_first_entry(&async_probes,
+						       struct async_probe, list));
+}
+
+int device_probe(struct device *dev)
+{
+	static int depth = 0;
+	struct device *prev_probing = probing_dev;
+	u64 start;
+	int ret;
+
+	ret = of_feature_controller_check(dev->of_node);
+	if (ret < 0)
+		return ret;
+	if (ret == FEATCTRL_GATED) {
+		dev_dbg(dev, "feature gated, skipping probe\n");
+		return -ENODEV;
+	}
+
+	depth++;
+
+	pr_report_probe("%*sprobe-> %s\n", depth * 4, "", dev_name(dev));
+
+	pinctrl_select_state_default(dev);
+	of_clk_set_defaults(dev->of_node, false);
+
+	list_add(&dev->active, &active_device_list);
+
+	if (device_probe_async(dev)) {
+		ret = 0;
+		goto out;
+	}
+
+	dev->deferred_supplier = NULL;
+	if (!probe_in_thread())
+		probing_dev = dev;
+	start = get_time_ns();
+
+	boottrace_begin(BOOTTRACE_PROBE, dev_name(dev));
+	ret = dev->bus->probe(dev);
+	boottrace_end(BOOTTRACE_PROBE, dev_name(dev));
+
+	if (!probe_in_thread())
+		probing_dev = prev_probing;
+
+	ret = device_probe_finish(dev, ret, start);
 out:
 	depth--;
 	return ret;
@@ -153,6 +387,8 @@ int device_probe(struct device *dev)
 
 int device_detect(struct device *dev)
 {
+	device_probe_join(dev);
+
 	if (!dev->detect)
 		return -ENOSYS;
 	return dev->detect(dev);
@@ -234,6 +470,7 @@ int register_device(struct device *new_device)
 	debug ("register_device: %s\n", dev_name(new_device));
 
 	list_add_tail(&new_device->list, &device_list);
+	device_hash(new_device);
 	INIT_LIST_HEAD(&new_device->children);
 	INIT_LIST_HEAD(&new_device->cdevs);
 	INIT_LIST_HEAD(&new_device->parameters);
@@ -266,6 +503,8 @@ int unregister_device(struct device *old_dev)
 
 	dev_dbg(old_dev, "unregister\n");
 
+	device_probe_join(old_dev);
+
 	dev_remove_parameters(old_dev);
 
 	if (old_dev->driver)
@@ -284,6 +523,7 @@ int unregister_device(struct device *old_dev)
 	}
 
 	list_del(&old_dev->list);
+	device_unhash(old_dev);
 	list_del(&old_dev->bus_list);
 	list_del(&old_dev->active);
 
@@ -332,6 +572,10 @@ EXPORT_SYMBOL(free_device);
  * Loop over list of deferred devices as long as at least one
  * device is successfully probed. Devices that again request
  * deferral are re-added to deferred list in device_probe().
+ * Devices waiting for a known supplier are skipped until that
+ * supplier is probed. Suppliers without a device, like clocks
+ * registered with CLK_OF_DECLARE, are not noticed that way, so
+ * when nothing else makes progress all devices are tried once more.
  * For devices finally left in deferred list -EPROBE_DEFER
  * becomes a fatal error.
  */
@@ -339,7 +583,9 @@ static int device_probe_deferred(void)
 {
 	struct device *dev, *tmp;
 	struct driver *drv;
-	bool success;
+	bool success, all = false;
+
+	device_probe_join_all();
 
 	do {
 		success = false;
@@ -347,7 +593,12 @@ static int device_probe_deferred(void)
 		if (list_empty(&deferred))
 			return 0;
 
+		boottrace_begin(BOOTTRACE_DEFERRED, "round");
+
 		list_for_each_entry_safe(dev, tmp, &deferred, active) {
+			if (!all && dev->deferred_supplier)
+				continue;
+
 			list_del(&dev->active);
 			INIT_LIST_HEAD(&dev->active);
 
@@ -359,6 +610,15 @@ static int device_probe_deferred(void)
 				break;
 			}
 		}
+
+		boottrace_end(BOOTTRACE_DEFERRED, "round");
+
+		if (success) {
+			all = false;
+		} else if (!all) {
+			all = true;
+			success = true;
+		}
 	} while (success);
 
 	list_for_each_entry(dev, &deferred, active) {
@@ -577,11 +837,18 @@ int dev_set_name(struct device *dev, const char *fmt, ...)
 	 * Save old pointer in case we are overriding already set name
 	 */
 	char *oldname = dev->name;
+	bool hashed = hash_hashed(&dev->hash);
+
+	if (hashed)
+		device_unhash(dev);
 
 	va_start(vargs, fmt);
 	err = vasprintf(&dev->name, fmt, vargs);
 	va_end(vargs);
 
+	if (hashed && err >= 0)
+		device_hash(dev);
+
 	/*
 	 * Free old pointer, we do this after vasprintf call in case
 	 * old device name was in one of vargs
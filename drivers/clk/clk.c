@@ -705,6 +705,9 @@ struct clk *of_clk_get_from_provider(struct of_phandle_args *clkspec)
 			break;
 	}
 
+	if (clk == ERR_PTR(-EPROBE_DEFER))
+		device_probe_wait_for(clkspec->np);
+
 	return clk;
 }
 
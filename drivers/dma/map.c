@@ -2,8 +2,78 @@
 /* SPDX-FileCopyrightText: 2012 Marc Kleine-Budde <mkl@pengutronix.de> */
 
 #include <dma.h>
+#include <linux/printk.h>
 #include <asm/io.h>
 
+/*
+ * With CONFIG_DMA_API_DEBUG, streaming mappings owned by a device are
+ * tracked to find drivers which map a buffer twice, doing the cache
+ * maintenance twice, or unmap it with a different size or direction.
+ */
+#define DMA_STREAMS_MAX		32
+
+struct dma_stream {
+	void *ptr;
+	size_t size;
+	enum dma_data_direction dir;
+};
+
+static struct dma_stream dma_streams[DMA_STREAMS_MAX];
+
+static struct dma_stream *dma_stream_find(void *ptr)
+{
+	int i;
+
+	for (i = 0; i < DMA_STREAMS_MAX; i++)
+		if (dma_streams[i].ptr == ptr)
+			return &dma_streams[i];
+
+	return NULL;
+}
+
+static void dma_stream_map(struct device *dev, void *ptr, size_t size,
+			   enum dma_data_direction dir)
+{
+	struct dma_stream *s;
+
+	if (!IS_ENABLED(CONFIG_DMA_API_DEBUG))
+		return;
+
+	s = dma_stream_find(ptr);
+	if (s) {
+		pr_warn("dma: %p is already owned by the device\n", ptr);
+		return;
+	}
+
+	/* when the table is full, the mapping just isn't tracked */
+	s = dma_stream_find(NULL);
+	if (!s)
+		return;
+
+	s->ptr = ptr;
+	s->size = size;
+	s->dir = dir;
+}
+
+static void dma_stream_unmap(struct device *dev, void *ptr, size_t size,
+			     enum dma_data_direction dir)
+{
+	struct dma_stream *s;
+
+	if (!IS_ENABLED(CONFIG_DMA_API_DEBUG))
+		return;
+
+	s = dma_stream_find(ptr);
+	if (!s)
+		return;
+
+	if (s->size != size || s->dir != dir)
+		pr_warn("dma: %p unmapped with size %zu/%d, mapped with %zu/%d\n",
+			ptr, size, dir, s->size, s->dir);
+
+	s->ptr = NULL;
+}
+
 static inline dma_addr_t cpu_to_dma(struct device *dev, void *cpu_addr)
 {
 	if (dev && dev->dma_offset)
@@ -25,6 +95,7 @@ dma_addr_t dma_map_single(struct device *dev, void *ptr, size_t size,
 {
 	unsigned long addr = (unsigned long)ptr;
 
+	dma_stream_map(dev, ptr, size, dir);
 	dma_sync_single_for_device(addr, size, dir);
 
 	return cpu_to_dma(dev, ptr);
@@ -33,7 +104,13 @@ dma_addr_t dma_map_single(struct device *dev, void *ptr, size_t size,
 void dma_unmap_single(struct device *dev, dma_addr_t dma_addr, size_t size,
 		      enum dma_data_direction dir)
 {
-	unsigned long addr = (unsigned long)dma_to_cpu(dev, dma_addr);
+	void *ptr = dma_to_cpu(dev, dma_addr);
+
+	dma_stream_unmap(dev, ptr, size, dir);
+
+	/* the device only read the buffer, the CPU view is still valid */
+	if (dir == DMA_TO_DEVICE)
+		return;
 
-	dma_sync_single_for_cpu(addr, size, dir);
+	dma_sync_single_for_cpu((unsigned long)ptr, size, dir);
 }
@@ -663,8 +663,10 @@ int gpio_of_xlate(struct device *dev, struct of_phandle_args *gpiospec,
 		return -ENODEV;
 
 	chip = gpio_get_chip_by_dev(dev);
-	if (!chip)
+	if (!chip) {
+		device_probe_wait_for(dev->of_node);
 		return -EPROBE_DEFER;
+	}
 
 	if (chip->ops->of_xlate)
 		return chip->ops->of_xlate(chip, gpiospec, flags);
@@ -19,6 +19,8 @@
 						SDHCI_INT_DATA_TIMEOUT | \
 						SDHCI_INT_DATA_CRC | \
 						SDHCI_INT_DATA_END_BIT | \
+						SDHCI_INT_ADMA_ERROR | \
+						SDHCI_INT_AUTO_CMD_ERR | \
 						SDHCI_INT_ADMAE)
 
 #define SDHCI_ARASAN_INT_CMD_MASK		(SDHCI_INT_CMD_COMPLETE | \
@@ -147,6 +149,7 @@ static int arasan_sdhci_send_cmd(struct mci_host *mci, struct mci_cmd *cmd,
 {
 	struct arasan_sdhci_host *host = to_arasan_sdhci_host(mci);
 	u32 mask, command, xfer;
+	dma_addr_t dma = SDHCI_NO_DMA;
 	int ret;
 
 	/* Wait for idle before next command */
@@ -164,34 +167,43 @@ static int arasan_sdhci_send_cmd(struct mci_host *mci, struct mci_cmd *cmd,
 
 	sdhci_write32(&host->sdhci, SDHCI_INT_STATUS, ~0);
 
+	sdhci_write8(&host->sdhci, SDHCI_TIMEOUT_CONTROL, TIMEOUT_VAL);
+
+	/* Only ADMA2 capable controllers are driven by DMA, the rest use PIO */
+	sdhci_setup_data_dma(&host->sdhci, data,
+			     host->sdhci.flags & SDHCI_USE_ADMA ? &dma : NULL);
+
 	mask = SDHCI_INT_CMD_COMPLETE;
-	if (data && data->flags == MMC_DATA_READ)
+	if (data && data->flags == MMC_DATA_READ && dma == SDHCI_NO_DMA)
 		mask |= SDHCI_INT_DATA_AVAIL;
-	if (cmd->resp_type & MMC_RSP_BUSY)
-		mask |= SDHCI_INT_XFER_COMPLETE;
 
-	sdhci_set_cmd_xfer_mode(&host->sdhci,
-				cmd, data, false, &command, &xfer);
+	sdhci_set_cmd_xfer_mode(&host->sdhci, cmd, data,
+				dma != SDHCI_NO_DMA,
+				&command, &xfer);
 
-	sdhci_write8(&host->sdhci, SDHCI_TIMEOUT_CONTROL, TIMEOUT_VAL);
-	if (data) {
+	if (data)
 		sdhci_write16(&host->sdhci, SDHCI_TRANSFER_MODE, xfer);
-		sdhci_write16(&host->sdhci, SDHCI_BLOCK_SIZE,
-			      SDHCI_DMA_BOUNDARY_512K | SDHCI_TRANSFER_BLOCK_SIZE(data->blocksize));
-		sdhci_write16(&host->sdhci, SDHCI_BLOCK_COUNT, data->blocks);
-	}
 	sdhci_write32(&host->sdhci, SDHCI_ARGUMENT, cmd->cmdarg);
 	sdhci_write16(&host->sdhci, SDHCI_COMMAND, command);
 
 	ret = sdhci_wait_for_done(&host->sdhci, mask);
-	if (ret)
+	if (ret) {
+		sdhci_teardown_data_dma(&host->sdhci, data, dma);
 		goto error;
+	}
 
 	sdhci_read_response(&host->sdhci, cmd);
 	sdhci_write32(&host->sdhci, SDHCI_INT_STATUS, mask);
 
-	if (data)
-		ret = sdhci_transfer_data_pio(&host->sdhci, data);
+	if (cmd->resp_type & MMC_RSP_BUSY) {
+		ret = sdhci_wait_for_busy(&host->sdhci, cmd);
+		if (ret) {
+			sdhci_teardown_data_dma(&host->sdhci, data, dma);
+			goto error;
+		}
+	}
+
+	ret = sdhci_transfer_data(&host->sdhci, data, dma);
 
 error:
 	if (ret) {
@@ -260,6 +272,7 @@ static int arasan_sdhci_probe(struct device *dev)
 	mci->card_present = arasan_sdhci_card_present;
 	mci->card_write_protected = arasan_sdhci_card_write_protected;
 	mci->hw_dev = dev;
+	mci->host_caps |= MMC_CAP_WAIT_WHILE_BUSY;
 
 	mci->f_max = clk_get_rate(clk_xin);
 	mci->f_min = 50000000 / 256;
@@ -268,6 +281,7 @@ static int arasan_sdhci_probe(struct device *dev)
 	mci_of_parse(&arasan_sdhci->mci);
 
 	sdhci_setup_host(&arasan_sdhci->sdhci);
+	sdhci_setup_adma(&arasan_sdhci->sdhci);
 
 	dev->priv = arasan_sdhci;
 
@@ -61,7 +61,7 @@ static int dove_sdhci_mci_send_cmd(struct mci_host *mci, struct mci_cmd *cmd,
 	u32 command, xfer;
 	u64 start;
 	int ret;
-	unsigned int num_bytes = 0;
+	dma_addr_t dma = SDHCI_NO_DMA;
 	struct dove_sdhci *host = priv_from_mci_host(mci);
 
 	sdhci_write32(&host->sdhci, SDHCI_INT_STATUS, ~0);
@@ -85,27 +85,14 @@ static int dove_sdhci_mci_send_cmd(struct mci_host *mci, struct mci_cmd *cmd,
 
 	/* setup transfer data */
 	if (data) {
-		num_bytes = data->blocks * data->blocksize;
-		if (data->flags & MMC_DATA_READ)
-			sdhci_write32(&host->sdhci, SDHCI_DMA_ADDRESS, (u32)data->dest);
-		else
-			sdhci_write32(&host->sdhci, SDHCI_DMA_ADDRESS, (u32)data->src);
-		sdhci_write16(&host->sdhci, SDHCI_BLOCK_SIZE, SDHCI_DMA_BOUNDARY_512K |
-				SDHCI_TRANSFER_BLOCK_SIZE(data->blocksize));
-		sdhci_write16(&host->sdhci, SDHCI_BLOCK_COUNT, data->blocks);
 		sdhci_write8(&host->sdhci, SDHCI_TIMEOUT_CONTROL, 0xe);
-
-
-		if (data->flags & MMC_DATA_WRITE)
-			dma_sync_single_for_device((unsigned long)data->src,
-						    num_bytes, DMA_TO_DEVICE);
-		else
-			dma_sync_single_for_device((unsigned long)data->dest,
-						    num_bytes, DMA_FROM_DEVICE);
+		sdhci_setup_data_dma(&host->sdhci, data, &dma);
 	}
 
 	/* setup transfer mode */
-	sdhci_set_cmd_xfer_mode(&host->sdhci, cmd, data, true, &command, &xfer);
+	sdhci_set_cmd_xfer_mode(&host->sdhci, cmd, data,
+				dma == SDHCI_NO_DMA ? false : true,
+				&command, &xfer);
 
 	sdhci_write16(&host->sdhci, SDHCI_TRANSFER_MODE, xfer);
 	sdhci_write32(&host->sdhci, SDHCI_ARGUMENT, cmd->cmdarg);
@@ -125,14 +112,9 @@ static int dove_sdhci_mci_send_cmd(struct mci_host *mci, struct mci_cmd *cmd,
 	sdhci_read_response(&host->sdhci, cmd);
 
 	if (data) {
-		if (data->flags & MMC_DATA_WRITE)
-			dma_sync_single_for_cpu((unsigned long)data->src,
-						num_bytes, DMA_TO_DEVICE);
-		else
-			dma_sync_single_for_cpu((unsigned long)data->dest,
-					 num_bytes, DMA_FROM_DEVICE);
-
-		ret = dove_sdhci_wait_for_done(host, SDHCI_INT_XFER_COMPLETE);
+		sdhci_write32(&host->sdhci, SDHCI_INT_STATUS, SDHCI_INT_CMD_COMPLETE);
+
+		ret = sdhci_transfer_data(&host->sdhci, data, dma);
 		if (ret) {
 			dev_err(host->mci.hw_dev, "error while transfering data for command %d\n",
 				cmd->cmdidx);
@@ -280,6 +262,8 @@ static int dove_sdhci_probe(struct device *dev)
 
 	host = xzalloc(sizeof(*host));
 	host->sdhci.base = dev_request_mem_region(dev, 0);
+	host->sdhci.mci = &host->mci;
+	host->sdhci.sdma_boundary = SDHCI_DMA_BOUNDARY_512K;
 	host->mci.max_req_size = 0x8000;
 	host->mci.hw_dev = dev;
 	host->mci.send_cmd = dove_sdhci_mci_send_cmd;
@@ -290,6 +274,9 @@ static int dove_sdhci_probe(struct device *dev)
 
 	dove_sdhci_set_mci_caps(host);
 
+	/* lifts max_req_size to a whole descriptor table when available */
+	sdhci_setup_adma(&host->sdhci);
+
 	ret = mci_register(&host->mci);
 	if (ret)
 		free(host);
@@ -17,6 +17,7 @@
 #include <linux/math64.h>
 #include <asm/byteorder.h>
 #include <block.h>
+#include <bootcache.h>
 #include <disks.h>
 #include <of.h>
 #include <linux/err.h>
@@ -109,6 +110,7 @@ static void mci_setup_cmd(struct mci_cmd *p, unsigned cmd, unsigned arg, unsigne
 	p->cmdidx = cmd;
 	p->cmdarg = arg;
 	p->resp_type = response;
+	p->busy_timeout = 0;
 }
 
 /**
@@ -205,6 +207,47 @@ static int mci_poll_until_ready(struct mci *mci, int timeout_ms)
 }
 
 
+/**
+ * Decide how a multi-block transfer is terminated
+ * @param mci MCI instance
+ * @param data The transfer about to be started
+ * @return true if the caller has to send STOP_TRANSMISSION afterwards
+ *
+ * Cards supporting CMD23 get the block count announced up front, either by
+ * the host (Auto-CMD23) or by an explicit SET_BLOCK_COUNT. Otherwise the
+ * transfer is open-ended and is stopped by the host (Auto-CMD12) or by us.
+ */
+static bool mci_setup_multi_block(struct mci *mci, struct mci_data *data)
+{
+	struct mci_host *host = mci->host;
+	struct mci_cmd cmd;
+
+	data->auto_cmd = 0;
+
+	if (data->blocks == 1)
+		return false;
+
+	if (mci_caps(mci) & MMC_CAP_CMD23) {
+		if (host->host_caps & MMC_CAP_AUTO_CMD23) {
+			data->auto_cmd = MMC_AUTO_CMD23;
+			return false;
+		}
+
+		mci_setup_cmd(&cmd, MMC_CMD_SET_BLOCK_COUNT, data->blocks,
+			      MMC_RSP_R1);
+		if (!mci_send_cmd(mci, &cmd, NULL))
+			return false;
+	}
+
+	if (host->host_caps & MMC_CAP_AUTO_CMD12) {
+		data->auto_cmd = MMC_AUTO_CMD12;
+		return false;
+	}
+
+	return true;
+}
+
+
 /**
  * Write one or several blocks of data to the card
  * @param mci_dev MCI instance
@@ -220,6 +263,7 @@ static int mci_block_write(struct mci *mci, const void *src, int blocknum,
 	struct mci_data data;
 	const void *buf;
 	unsigned mmccmd;
+	bool stop;
 	int ret;
 
 	/*
@@ -228,10 +272,14 @@ static int mci_block_write(struct mci *mci, const void *src, int blocknum,
 	 * prg-state (while busy is active) as a legal or illegal command.
 	 * A host should not send CMD24/25 while the Device is in the prg
 	 * state and busy is active.
+	 *
+	 * Hosts waiting for the end of DAT0 busy already did that for us.
 	 */
-	ret = mci_poll_until_ready(mci, 1000 /* ms */);
-	if (ret && ret != -ENOSYS)
-		return ret;
+	if (!(mci->host->host_caps & MMC_CAP_WAIT_WHILE_BUSY)) {
+		ret = mci_poll_until_ready(mci, 1000 /* ms */);
+		if (ret && ret != -ENOSYS)
+			return ret;
+	}
 
 	if (blocks > 1)
 		mmccmd = MMC_CMD_WRITE_MULTIPLE_BLOCK;
@@ -255,9 +303,11 @@ static int mci_block_write(struct mci *mci, const void *src, int blocknum,
 	data.blocksize = mci->write_bl_len;
 	data.flags = MMC_DATA_WRITE;
 
+	stop = mci_setup_multi_block(mci, &data);
+
 	ret = mci_send_cmd(mci, &cmd, &data);
 
-	if (ret || blocks > 1) {
+	if (ret || stop) {
 		mci_setup_cmd(&cmd, MMC_CMD_STOP_TRANSMISSION, 0, MMC_RSP_R1b);
 		mci_send_cmd(mci, &cmd, NULL);
         }
@@ -279,6 +329,7 @@ static int mci_read_block(struct mci *mci, void *dst, int blocknum,
 	struct mci_data data;
 	int ret;
 	unsigned mmccmd;
+	bool stop;
 
 	if (blocks > 1)
 		mmccmd = MMC_CMD_READ_MULTIPLE_BLOCK;
@@ -295,9 +346,11 @@ static int mci_read_block(struct mci *mci, void *dst, int blocknum,
 	data.blocksize = mci->read_bl_len;
 	data.flags = MMC_DATA_READ;
 
+	stop = mci_setup_multi_block(mci, &data);
+
 	ret = mci_send_cmd(mci, &cmd, &data);
 
-	if (ret || blocks > 1) {
+	if (ret || stop) {
 		mci_setup_cmd(&cmd, MMC_CMD_STOP_TRANSMISSION, 0, MMC_RSP_R1b);
 		mci_send_cmd(mci, &cmd, NULL);
 	}
@@ -502,6 +555,10 @@ int mci_switch(struct mci *mci, unsigned index, unsigned value)
 		(value << 8),
 		 MMC_RSP_R1b);
 
+	/* GENERIC_CMD6_TIME exists since eMMC v4.5, in units of 10 ms */
+	if (mci->ext_csd && mci->ext_csd[EXT_CSD_REV] >= 6)
+		cmd.busy_timeout = mci->ext_csd[EXT_CSD_GENERIC_CMD6_TIME] * 10;
+
 	return mci_send_cmd(mci, &cmd, NULL);
 }
 
@@ -617,6 +674,9 @@ static int mmc_change_freq(struct mci *mci)
 	mci->ext_csd = xmalloc(512);
 	mci->card_caps = 0;
 
+	if (mci->version >= MMC_VERSION_3)
+		mci->card_caps |= MMC_CAP_CMD23;
+
 	/* Only version 4 supports high-speed */
 	if (mci->version < MMC_VERSION_4)
 		return 0;
@@ -793,6 +853,9 @@ static int sd_change_freq(struct mci *mci)
 	if (mci->scr[0] & SD_DATA_4BIT)
 		mci->card_caps |= MMC_CAP_4_BIT_DATA;
 
+	if ((mci->scr[0] & SD_SCR_SPEC3) && (mci->scr[0] & SD_SCR_CMD23_SUPPORT))
+		mci->card_caps |= MMC_CAP_CMD23;
+
 	/* Version 1.0 doesn't support switching */
 	if (mci->version == SD_VERSION_1_0)
 		return 0;
@@ -1215,6 +1278,72 @@ static int mci_mmc_try_bus_width(struct mci *mci, enum mci_bus_width bus_width,
 	return bus_width;
 }
 
+/*
+ * The bus width validated for a card is kept in the boot cache, so that a
+ * warm boot can switch to it right away instead of trying the wider ones
+ * and comparing the EXT_CSD read over each of them.
+ */
+struct mci_bus_width_cache {
+	__le32 cid[4];
+	__le32 bus_width;
+};
+
+static void mci_bus_width_cache_key(struct mci *mci, char *key)
+{
+	snprintf(key, BOOTCACHE_KEY_LEN, "mci-bus-width:%s", dev_name(&mci->dev));
+}
+
+static int mci_bus_width_cache_load(struct mci *mci)
+{
+	struct mci_bus_width_cache bc;
+	char key[BOOTCACHE_KEY_LEN];
+	int i;
+
+	if (!IS_ENABLED(CONFIG_BOOTCACHE))
+		return -ENOENT;
+
+	mci_bus_width_cache_key(mci, key);
+
+	if (bootcache_load(key, &bc, sizeof(bc)) != sizeof(bc))
+		return -ENOENT;
+
+	for (i = 0; i < ARRAY_SIZE(bc.cid); i++)
+		if (le32_to_cpu(bc.cid[i]) != mci->cid[i])
+			return -ENOENT;
+
+	switch (le32_to_cpu(bc.bus_width)) {
+	case MMC_BUS_WIDTH_4:
+		if (!(mci_caps(mci) & MMC_CAP_4_BIT_DATA))
+			return -ENOENT;
+		return MMC_BUS_WIDTH_4;
+	case MMC_BUS_WIDTH_8:
+		if (!(mci_caps(mci) & MMC_CAP_8_BIT_DATA))
+			return -ENOENT;
+		return MMC_BUS_WIDTH_8;
+	default:
+		return -ENOENT;
+	}
+}
+
+static void mci_bus_width_cache_store(struct mci *mci,
+				      enum mci_bus_width bus_width)
+{
+	struct mci_bus_width_cache bc;
+	char key[BOOTCACHE_KEY_LEN];
+	int i;
+
+	if (!IS_ENABLED(CONFIG_BOOTCACHE))
+		return;
+
+	mci_bus_width_cache_key(mci, key);
+
+	for (i = 0; i < ARRAY_SIZE(bc.cid); i++)
+		bc.cid[i] = cpu_to_le32(mci->cid[i]);
+	bc.bus_width = cpu_to_le32(bus_width);
+
+	bootcache_store(key, &bc, sizeof(bc));
+}
+
 static int mci_mmc_select_bus_width(struct mci *mci)
 {
 	struct mci_host *host = mci->host;
@@ -1228,6 +1357,17 @@ static int mci_mmc_select_bus_width(struct mci *mci)
 	if (!(host->host_caps & (MMC_CAP_4_BIT_DATA | MMC_CAP_8_BIT_DATA)))
 		return MMC_BUS_WIDTH_1;
 
+	ret = mci_bus_width_cache_load(mci);
+	if (ret > 0) {
+		dev_dbg(&mci->dev, "using cached buswidth %u\n", 1 << ret);
+
+		if (!mci_switch(mci, EXT_CSD_BUS_WIDTH,
+				mci_bus_width_ext_csd_bits(ret))) {
+			mci_set_bus_width(mci, ret);
+			return ret;
+		}
+	}
+
 	/*
 	 * Unlike SD, MMC cards dont have a configuration register to notify
 	 * supported bus width. So bus test command should be run to identify
@@ -1250,6 +1390,9 @@ static int mci_mmc_select_bus_width(struct mci *mci)
 			break;
 	}
 
+	if (ret > 0)
+		mci_bus_width_cache_store(mci, ret);
+
 	return ret;
 }
 
@@ -1733,7 +1876,7 @@ static const char *mci_timing_tostr(unsigned timing)
 
 static void mci_print_caps(unsigned caps)
 {
-	printf("  capabilities: %s%s%s%s%s%s%s%s\n",
+	printf("  capabilities: %s%s%s%s%s%s%s%s%s%s%s%s\n",
 		caps & MMC_CAP_4_BIT_DATA ? "4bit " : "",
 		caps & MMC_CAP_8_BIT_DATA ? "8bit " : "",
 		caps & MMC_CAP_SD_HIGHSPEED ? "sd-hs " : "",
@@ -1741,7 +1884,11 @@ static void mci_print_caps(unsigned caps)
 		caps & MMC_CAP_MMC_HIGHSPEED_52MHZ ? "mmc-52MHz " : "",
 		caps & MMC_CAP_MMC_3_3V_DDR ? "ddr-3.3v " : "",
 		caps & MMC_CAP_MMC_1_8V_DDR ? "ddr-1.8v " : "",
-		caps & MMC_CAP_MMC_1_2V_DDR ? "ddr-1.2v " : "");
+		caps & MMC_CAP_MMC_1_2V_DDR ? "ddr-1.2v " : "",
+		caps & MMC_CAP_CMD23 ? "cmd23 " : "",
+		caps & MMC_CAP_AUTO_CMD12 ? "auto-cmd12 " : "",
+		caps & MMC_CAP_AUTO_CMD23 ? "auto-cmd23 " : "",
+		caps & MMC_CAP_WAIT_WHILE_BUSY ? "wait-busy " : "");
 }
 
 /**
@@ -2154,8 +2301,10 @@ int mci_register(struct mci_host *host)
 	mci->host = host;
 	host->mci = mci;
 	mci->dev.detect = mci_detect;
+	mci->dev.detect_parallel = true;
 	if (!hw_dev->detect)
 		hw_dev->detect = mci_hw_detect;
+	hw_dev->detect_parallel = true;
 
 	host->supply = regulator_get(hw_dev, "vmmc");
 	if (IS_ERR(host->supply)) {
@@ -8,6 +8,7 @@
 #include <mci.h>
 #include <dma.h>
 #include <linux/iopoll.h>
+#include <linux/sizes.h>
 
 #include "sdhci.h"
 
@@ -50,7 +51,9 @@
 						SDHCI_INT_DATA_AVAIL | \
 						SDHCI_INT_DATA_TIMEOUT | \
 						SDHCI_INT_DATA_CRC | \
-						SDHCI_INT_DATA_END_BIT
+						SDHCI_INT_DATA_END_BIT | \
+						SDHCI_INT_ADMA_ERROR | \
+						SDHCI_INT_AUTO_CMD_ERR
 
 #define SDHCI_DWCMSHC_INT_CMD_MASK		SDHCI_INT_CMD_COMPLETE | \
 						SDHCI_INT_TIMEOUT | \
@@ -80,6 +83,28 @@ struct rk_sdhci_host *to_rk_sdhci_host(struct mci_host *mci)
 	return container_of(mci, struct rk_sdhci_host, mci);
 }
 
+/* DWC MSHC ADMA2 descriptors must not cross a 128 MiB boundary */
+#define DWCMSHC_ADMA_BOUNDARY		SZ_128M
+#define DWCMSHC_ADMA_BOUNDARY_OK(addr, len) \
+	((addr | (DWCMSHC_ADMA_BOUNDARY - 1)) == \
+	 ((addr + len - 1) | (DWCMSHC_ADMA_BOUNDARY - 1)))
+
+static void rk_sdhci_adma_write_desc(struct sdhci *sdhci, void **desc,
+				     dma_addr_t addr, int len,
+				     unsigned int cmd)
+{
+	int tmplen;
+
+	if (DWCMSHC_ADMA_BOUNDARY_OK(addr, len)) {
+		sdhci_adma_write_desc(sdhci, desc, addr, len, cmd);
+		return;
+	}
+
+	tmplen = DWCMSHC_ADMA_BOUNDARY - (addr & (DWCMSHC_ADMA_BOUNDARY - 1));
+	sdhci_adma_write_desc(sdhci, desc, addr, tmplen, cmd & ~ADMA2_END);
+	sdhci_adma_write_desc(sdhci, desc, addr + tmplen, len - tmplen, cmd);
+}
+
 static int rk_sdhci_card_present(struct mci_host *mci)
 {
 	struct rk_sdhci_host *host = to_rk_sdhci_host(mci);
@@ -217,7 +242,7 @@ static int rk_sdhci_send_cmd(struct mci_host *mci, struct mci_cmd *cmd,
 	struct rk_sdhci_host *host = to_rk_sdhci_host(mci);
 	u32 mask, command, xfer;
 	int ret;
-	dma_addr_t dma;
+	dma_addr_t dma = SDHCI_NO_DMA;
 
 	/* Wait for idle before next command */
 	mask = SDHCI_CMD_INHIBIT_CMD;
@@ -240,7 +265,7 @@ static int rk_sdhci_send_cmd(struct mci_host *mci, struct mci_cmd *cmd,
 	sdhci_setup_data_dma(&host->sdhci, data, &dma);
 
 	sdhci_set_cmd_xfer_mode(&host->sdhci, cmd, data,
-				dma == SDHCI_NO_DMA ? false : true,
+				dma != SDHCI_NO_DMA,
 				&command, &xfer);
 
 	sdhci_write16(&host->sdhci, SDHCI_TRANSFER_MODE, xfer);
@@ -248,12 +273,24 @@ static int rk_sdhci_send_cmd(struct mci_host *mci, struct mci_cmd *cmd,
 	sdhci_write32(&host->sdhci, SDHCI_ARGUMENT, cmd->cmdarg);
 	sdhci_write16(&host->sdhci, SDHCI_COMMAND, command);
 
-	ret = sdhci_wait_for_done(&host->sdhci, SDHCI_INT_CMD_COMPLETE);
-	if (ret)
+	mask = SDHCI_INT_CMD_COMPLETE;
+
+	ret = sdhci_wait_for_done(&host->sdhci, mask);
+	if (ret) {
+		sdhci_teardown_data_dma(&host->sdhci, data, dma);
 		goto error;
+	}
 
 	sdhci_read_response(&host->sdhci, cmd);
-	sdhci_write32(&host->sdhci, SDHCI_INT_STATUS, SDHCI_INT_CMD_COMPLETE);
+	sdhci_write32(&host->sdhci, SDHCI_INT_STATUS, mask);
+
+	if (cmd->resp_type & MMC_RSP_BUSY) {
+		ret = sdhci_wait_for_busy(&host->sdhci, cmd);
+		if (ret) {
+			sdhci_teardown_data_dma(&host->sdhci, data, dma);
+			goto error;
+		}
+	}
 
 	ret = sdhci_transfer_data_dma(&host->sdhci, data, dma);
 
@@ -290,6 +327,7 @@ static int rk_sdhci_probe(struct device *dev)
 	mci->init = rk_sdhci_init;
 	mci->card_present = rk_sdhci_card_present;
 	mci->hw_dev = dev;
+	mci->host_caps |= MMC_CAP_WAIT_WHILE_BUSY;
 
 	host->clks[CLK_CORE].id = "core";
 	host->clks[CLK_BUS].id = "bus";
@@ -316,6 +354,8 @@ static int rk_sdhci_probe(struct device *dev)
 	mci_of_parse(&host->mci);
 
 	sdhci_setup_host(&host->sdhci);
+	host->sdhci.adma_write_desc = rk_sdhci_adma_write_desc;
+	sdhci_setup_adma(&host->sdhci);
 
 	dev->priv = host;
 
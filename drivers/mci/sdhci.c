@@ -27,6 +27,31 @@ void sdhci_read_response(struct sdhci *sdhci, struct mci_cmd *cmd)
 	}
 }
 
+static u32 sdhci_auto_cmd_mode(struct sdhci *host, struct mci_data *data,
+			       bool dma)
+{
+	u8 ctrl;
+
+	/* Only hosts set up by sdhci_setup_adma() advertise Auto-CMD */
+	if (!(host->flags & SDHCI_USE_ADMA) || data->blocks == 1)
+		return 0;
+
+	switch (data->auto_cmd) {
+	case MMC_AUTO_CMD23:
+		/* ARGUMENT2 is the SDMA address, fall back to Auto-CMD12 there */
+		ctrl = sdhci_read8(host, SDHCI_HOST_CONTROL);
+		if (dma && !(ctrl & SDHCI_CTRL_DMA_MASK))
+			return SDHCI_TRNS_AUTO_CMD12;
+
+		sdhci_write32(host, SDHCI_ARGUMENT2, data->blocks);
+		return SDHCI_TRNS_AUTO_CMD23;
+	case MMC_AUTO_CMD12:
+		return SDHCI_TRNS_AUTO_CMD12;
+	default:
+		return 0;
+	}
+}
+
 void sdhci_set_cmd_xfer_mode(struct sdhci *host, struct mci_cmd *cmd,
 			     struct mci_data *data, bool dma, u32 *command,
 			     u32 *xfer)
@@ -58,6 +83,8 @@ void sdhci_set_cmd_xfer_mode(struct sdhci *host, struct mci_cmd *cmd,
 		if (data->blocks > 1)
 			*xfer |= SDHCI_MULTIPLE_BLOCKS;
 
+		*xfer |= sdhci_auto_cmd_mode(host, data, dma);
+
 		if (data->flags & MMC_DATA_READ)
 			*xfer |= SDHCI_DATA_TO_HOST;
 
@@ -124,7 +151,7 @@ void sdhci_set_bus_width(struct sdhci *host, int width)
 
 #endif
 
-int sdhci_wait_for_done(struct sdhci *sdhci, u32 mask)
+static int sdhci_wait_for_int(struct sdhci *sdhci, u32 mask, u64 timeout)
 {
 	u64 start = get_time_ns();
 	u32 stat;
@@ -141,7 +168,7 @@ int sdhci_wait_for_done(struct sdhci *sdhci, u32 mask)
 			return -EPERM;
 		}
 
-		if (is_timeout(start, 1000 * MSECOND)) {
+		if (is_timeout(start, timeout)) {
 			dev_err(sdhci->mci->hw_dev,
 				"SDHCI timeout while waiting for done\n");
 			return -ETIMEDOUT;
@@ -151,6 +178,33 @@ int sdhci_wait_for_done(struct sdhci *sdhci, u32 mask)
 	return 0;
 }
 
+int sdhci_wait_for_done(struct sdhci *sdhci, u32 mask)
+{
+	return sdhci_wait_for_int(sdhci, mask, 1000 * MSECOND);
+}
+
+/**
+ * sdhci_wait_for_busy() - wait for the end of busy after an R1b command
+ * @sdhci: the SDHCI host
+ * @cmd: the command that has completed
+ *
+ * The controller signals the end of DAT0 busy with transfer complete. Busy
+ * can last much longer than the command itself, so this waits for up to
+ * @cmd->busy_timeout instead of the fixed timeout of sdhci_wait_for_done().
+ */
+int sdhci_wait_for_busy(struct sdhci *sdhci, struct mci_cmd *cmd)
+{
+	unsigned int timeout_ms = cmd->busy_timeout ?: SDHCI_BUSY_TIMEOUT_MS;
+	int ret;
+
+	ret = sdhci_wait_for_int(sdhci, SDHCI_INT_XFER_COMPLETE,
+				 (u64)timeout_ms * MSECOND);
+	if (!ret)
+		sdhci_write32(sdhci, SDHCI_INT_STATUS, SDHCI_INT_XFER_COMPLETE);
+
+	return ret;
+}
+
 void sdhci_setup_data_pio(struct sdhci *sdhci, struct mci_data *data)
 {
 	if (!data)
@@ -160,6 +214,107 @@ void sdhci_setup_data_pio(struct sdhci *sdhci, struct mci_data *data)
 		      SDHCI_TRANSFER_BLOCK_SIZE(data->blocksize) | data->blocks << 16);
 }
 
+static inline size_t sdhci_adma_desc_size(struct sdhci *sdhci)
+{
+	if (sdhci->flags & SDHCI_USE_64_BIT_DMA)
+		return sizeof(struct sdhci_adma2_64_desc);
+
+	return sizeof(struct sdhci_adma2_32_desc);
+}
+
+/**
+ * sdhci_adma_write_desc() - write one ADMA2 descriptor
+ * @sdhci: the SDHCI host
+ * @desc: the descriptor to write, advanced to the next one
+ * @addr: bus address of the segment
+ * @len: length of the segment, at most SDHCI_ADMA2_MAX_LEN
+ * @cmd: descriptor attributes
+ *
+ * Hosts with restrictions on descriptor placement wrap this in their
+ * own struct sdhci::adma_write_desc.
+ */
+void sdhci_adma_write_desc(struct sdhci *sdhci, void **desc,
+			   dma_addr_t addr, int len, unsigned int cmd)
+{
+	struct sdhci_adma2_64_desc *dma_desc = *desc;
+
+	/* 32-bit and 64-bit descriptors have the same layout up to addr_hi */
+	dma_desc->cmd = cpu_to_le16(cmd);
+	/* A length of 0 encodes the 64 KiB maximum */
+	dma_desc->len = cpu_to_le16(len & 0xffff);
+	dma_desc->addr_lo = cpu_to_le32(lower_32_bits(addr));
+
+	if (sdhci->flags & SDHCI_USE_64_BIT_DMA)
+		dma_desc->addr_hi = cpu_to_le32(upper_32_bits(addr));
+
+	*desc += sdhci_adma_desc_size(sdhci);
+}
+
+static bool sdhci_can_adma(struct sdhci *sdhci, dma_addr_t dma, int nbytes)
+{
+	if (!(sdhci->flags & SDHCI_USE_ADMA))
+		return false;
+
+	if (nbytes > SDHCI_ADMA2_MAX_REQ || !IS_ALIGNED(dma, 4))
+		return false;
+
+	if (!(sdhci->flags & SDHCI_USE_64_BIT_DMA) &&
+	    upper_32_bits(dma + nbytes - 1))
+		return false;
+
+	return true;
+}
+
+/*
+ * Describe the whole request in the descriptor table, so that the
+ * controller moves it without stopping at SDMA buffer boundaries.
+ */
+static void sdhci_adma_table_pre(struct sdhci *sdhci, dma_addr_t dma,
+				 int nbytes)
+{
+	void *desc = sdhci->adma_table;
+	unsigned int cmd;
+	int len;
+
+	while (nbytes) {
+		len = min_t(int, nbytes, SDHCI_ADMA2_MAX_LEN);
+		nbytes -= len;
+
+		cmd = ADMA2_TRAN_VALID;
+		if (!nbytes)
+			cmd |= ADMA2_END;
+
+		if (sdhci->adma_write_desc)
+			sdhci->adma_write_desc(sdhci, &desc, dma, len, cmd);
+		else
+			sdhci_adma_write_desc(sdhci, &desc, dma, len, cmd);
+		dma += len;
+	}
+
+	sdhci_write32(sdhci, SDHCI_ADMA_ADDRESS,
+		      lower_32_bits(sdhci->adma_addr));
+	if (sdhci->flags & SDHCI_USE_64_BIT_DMA)
+		sdhci_write32(sdhci, SDHCI_ADMA_ADDRESS_HI,
+			      upper_32_bits(sdhci->adma_addr));
+}
+
+static void sdhci_config_dma(struct sdhci *sdhci, bool adma)
+{
+	u8 ctrl;
+
+	/* Hosts without ADMA never leave the SDMA reset default */
+	if (!(sdhci->flags & SDHCI_USE_ADMA))
+		return;
+
+	ctrl = sdhci_read8(sdhci, SDHCI_HOST_CONTROL);
+	ctrl &= ~SDHCI_CTRL_DMA_MASK;
+	if (adma && sdhci->flags & SDHCI_USE_64_BIT_DMA)
+		ctrl |= SDHCI_CTRL_ADMA64;
+	else if (adma)
+		ctrl |= SDHCI_CTRL_ADMA32;
+	sdhci_write8(sdhci, SDHCI_HOST_CONTROL, ctrl);
+}
+
 void sdhci_setup_data_dma(struct sdhci *sdhci, struct mci_data *data,
 			  dma_addr_t *dma)
 {
@@ -188,22 +343,52 @@ void sdhci_setup_data_dma(struct sdhci *sdhci, struct mci_data *data,
 		return;
 	}
 
+	if (sdhci_can_adma(sdhci, *dma, nbytes)) {
+		sdhci_adma_table_pre(sdhci, *dma, nbytes);
+		sdhci_config_dma(sdhci, true);
+		return;
+	}
+
+	sdhci_config_dma(sdhci, false);
 	sdhci_write32(sdhci, SDHCI_DMA_ADDRESS, *dma);
 }
 
+/**
+ * sdhci_teardown_data_dma() - unmap a buffer mapped by sdhci_setup_data_dma()
+ * @sdhci: the SDHCI host
+ * @data: the data of the request, may be NULL
+ * @dma: the mapping, may be SDHCI_NO_DMA
+ *
+ * sdhci_transfer_data_dma() does this itself. Drivers need it when they bail
+ * out between setting up the data and transferring it.
+ */
+void sdhci_teardown_data_dma(struct sdhci *sdhci, struct mci_data *data,
+			     dma_addr_t dma)
+{
+	struct device *dev = sdhci->mci->hw_dev;
+	int nbytes;
+
+	if (!data || dma == SDHCI_NO_DMA)
+		return;
+
+	nbytes = data->blocks * data->blocksize;
+
+	if (data->flags & MMC_DATA_READ)
+		dma_unmap_single(dev, dma, nbytes, DMA_FROM_DEVICE);
+	else
+		dma_unmap_single(dev, dma, nbytes, DMA_TO_DEVICE);
+}
+
 int sdhci_transfer_data_dma(struct sdhci *sdhci, struct mci_data *data,
 			    dma_addr_t dma)
 {
 	struct device *dev = sdhci->mci->hw_dev;
-	int nbytes;
 	u32 irqstat;
 	int ret;
 
 	if (!data)
 		return 0;
 
-	nbytes = data->blocks * data->blocksize;
-
 	do {
 		irqstat = sdhci_read32(sdhci, SDHCI_INT_STATUS);
 
@@ -222,6 +407,18 @@ int sdhci_transfer_data_dma(struct sdhci *sdhci, struct mci_data *data,
 			goto out;
 		}
 
+		if (irqstat & SDHCI_INT_AUTO_CMD_ERR) {
+			ret = -EIO;
+			goto out;
+		}
+
+		if (irqstat & SDHCI_INT_ADMA_ERROR) {
+			dev_err(dev, "ADMA error: 0x%02x\n",
+				sdhci_read8(sdhci, SDHCI_ADMA_ERROR));
+			ret = -EIO;
+			goto out;
+		}
+
 		if (irqstat & SDHCI_INT_DMA) {
 			u32 addr = sdhci_read32(sdhci, SDHCI_DMA_ADDRESS);
 
@@ -239,12 +436,9 @@ int sdhci_transfer_data_dma(struct sdhci *sdhci, struct mci_data *data,
 
 	ret = 0;
 out:
-	if (data->flags & MMC_DATA_READ)
-		dma_unmap_single(dev, dma, nbytes, DMA_FROM_DEVICE);
-	else
-		dma_unmap_single(dev, dma, nbytes, DMA_TO_DEVICE);
+	sdhci_teardown_data_dma(sdhci, data, dma);
 
-	return 0;
+	return ret;
 }
 
 int sdhci_transfer_data_pio(struct sdhci *sdhci, struct mci_data *data)
@@ -572,3 +766,54 @@ int sdhci_setup_host(struct sdhci *host)
 
 	return 0;
 }
+
+/**
+ * sdhci_setup_adma() - switch DMA transfers to ADMA2 descriptor tables
+ * @host: the SDHCI host, set up with sdhci_setup_host()
+ *
+ * Allocates a descriptor table large enough for SDHCI_ADMA2_MAX_REQ bytes,
+ * plus one spare descriptor for a struct sdhci::adma_write_desc hook that
+ * splits a segment, and raises the maximum request size of the MCI host accordingly.
+ * Requests mapped through sdhci_setup_data_dma() then use ADMA2 whenever
+ * the buffer allows it and fall back to SDMA otherwise.
+ *
+ * Such hosts also terminate multi-block transfers themselves, so CMD23 and
+ * Auto-CMD12/Auto-CMD23 are advertised as well.
+ *
+ * Return: 0 on success, -ENOSYS if the controller lacks ADMA2 or
+ * -ENOMEM if the descriptor table could not be allocated.
+ */
+int sdhci_setup_adma(struct sdhci *host)
+{
+	struct mci_host *mci = host->mci;
+	unsigned int flags = SDHCI_USE_ADMA;
+
+	BUG_ON(!mci);
+
+	sdhci_read_caps(host);
+
+	if (!(host->caps & SDHCI_CAN_DO_ADMA2))
+		return -ENOSYS;
+
+	if (IS_ENABLED(CONFIG_ARCH_DMA_ADDR_T_64BIT) &&
+	    (host->caps & SDHCI_CAN_64BIT))
+		flags |= SDHCI_USE_64_BIT_DMA;
+
+	host->flags |= flags;
+
+	host->adma_table = dma_alloc_coherent(SDHCI_ADMA2_TABLE_COUNT *
+					      sdhci_adma_desc_size(host),
+					      &host->adma_addr);
+	if (!host->adma_table) {
+		host->flags &= ~flags;
+		return -ENOMEM;
+	}
+
+	mci->max_req_size = SDHCI_ADMA2_MAX_REQ;
+
+	mci->host_caps |= MMC_CAP_CMD23 | MMC_CAP_AUTO_CMD12;
+	if (host->version >= SDHCI_SPEC_300)
+		mci->host_caps |= MMC_CAP_AUTO_CMD23;
+
+	return 0;
+}
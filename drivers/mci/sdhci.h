@@ -5,8 +5,10 @@
 #include <pbl.h>
 #include <dma.h>
 #include <linux/iopoll.h>
+#include <linux/sizes.h>
 
 #define SDHCI_DMA_ADDRESS					0x00
+#define SDHCI_ARGUMENT2						0x00
 #define SDHCI_BLOCK_SIZE__BLOCK_COUNT				0x04
 #define SDHCI_BLOCK_SIZE					0x04
 #define  SDHCI_DMA_BOUNDARY_512K		SDHCI_DMA_BOUNDARY(7)
@@ -25,6 +27,8 @@
 #define SDHCI_TRANSFER_MODE					0x0c
 #define  SDHCI_MULTIPLE_BLOCKS			BIT(5)
 #define  SDHCI_DATA_TO_HOST			BIT(4)
+#define  SDHCI_TRNS_AUTO_CMD23			BIT(3)
+#define  SDHCI_TRNS_AUTO_CMD12			BIT(2)
 #define  SDHCI_BLOCK_COUNT_EN			BIT(1)
 #define  SDHCI_DMA_EN				BIT(0)
 #define SDHCI_COMMAND						0x0e
@@ -97,6 +101,8 @@
 #define  SDHCI_RESET_DATA			BIT(2)
 #define SDHCI_INT_STATUS					0x30
 #define SDHCI_INT_NORMAL_STATUS					0x30
+#define  SDHCI_INT_ADMA_ERROR			BIT(25)
+#define  SDHCI_INT_AUTO_CMD_ERR			BIT(24)
 #define  SDHCI_INT_DATA_END_BIT			BIT(22)
 #define  SDHCI_INT_DATA_CRC			BIT(21)
 #define  SDHCI_INT_DATA_TIMEOUT			BIT(20)
@@ -150,6 +156,10 @@
 #define  SDHCI_CAN_DO_ADMA3			0x08000000
 #define  SDHCI_SUPPORT_HS400			0x80000000 /* Non-standard */
 
+#define SDHCI_ADMA_ERROR	0x54
+#define SDHCI_ADMA_ADDRESS	0x58
+#define SDHCI_ADMA_ADDRESS_HI	0x5c
+
 #define SDHCI_PRESET_FOR_SDR12	0x66
 #define SDHCI_PRESET_FOR_SDR25	0x68
 #define SDHCI_PRESET_FOR_SDR50	0x6A
@@ -175,6 +185,37 @@
 
 #define SDHCI_MMC_BOOT						0xC4
 
+/*
+ * ADMA2 descriptor attributes. A single descriptor moves at most 64 KiB,
+ * encoded as a length of 0.
+ */
+#define ADMA2_TRAN_VALID	0x21
+#define ADMA2_NOP_END_VALID	0x3
+#define ADMA2_END		0x2
+#define SDHCI_ADMA2_MAX_LEN	SZ_64K
+#define SDHCI_ADMA2_DESC_COUNT	128
+#define SDHCI_ADMA2_MAX_REQ	(SDHCI_ADMA2_DESC_COUNT * SDHCI_ADMA2_MAX_LEN)
+/*
+ * A request of SDHCI_ADMA2_MAX_REQ bytes crosses at most one 128 MiB
+ * boundary, so hosts splitting there need a single extra descriptor.
+ */
+#define SDHCI_ADMA2_TABLE_COUNT	(SDHCI_ADMA2_DESC_COUNT + 1)
+
+/* ADMA2 32-bit DMA descriptor */
+struct sdhci_adma2_32_desc {
+	__le16	cmd;
+	__le16	len;
+	__le32	addr;
+} __packed __aligned(4);
+
+/* ADMA2 64-bit DMA descriptor, 96 bits long in non-v4 mode */
+struct sdhci_adma2_64_desc {
+	__le16	cmd;
+	__le16	len;
+	__le32	addr_lo;
+	__le32	addr_hi;
+} __packed __aligned(4);
+
 #define SDHCI_MAX_DIV_SPEC_200	256
 #define SDHCI_MAX_DIV_SPEC_300	2046
 
@@ -185,6 +226,8 @@ struct sdhci {
 	void (*write32)(struct sdhci *host, int reg, u32 val);
 	void (*write16)(struct sdhci *host, int reg, u16 val);
 	void (*write8)(struct sdhci *host, int reg, u8 val);
+	void (*adma_write_desc)(struct sdhci *host, void **desc,
+				dma_addr_t addr, int len, unsigned int cmd);
 
 	void __iomem *base;
 
@@ -205,6 +248,12 @@ struct sdhci {
 	bool read_caps;	/* Capability flags have been read */
 	u32 sdma_boundary;
 
+	unsigned int flags;
+#define SDHCI_USE_ADMA				BIT(0)
+#define SDHCI_USE_64_BIT_DMA			BIT(1)
+	void *adma_table;	/* ADMA2 descriptor table */
+	dma_addr_t adma_addr;	/* Mapped ADMA2 descriptor table */
+
 	struct mci_host	*mci;
 };
 
@@ -257,7 +306,10 @@ static inline void sdhci_write8(struct sdhci *host, int reg, u32 val)
 }
 
 #define SDHCI_NO_DMA DMA_ERROR_CODE
+/* used for R1b commands which don't give their own busy_timeout */
+#define SDHCI_BUSY_TIMEOUT_MS	10000
 int sdhci_wait_for_done(struct sdhci *host, u32 mask);
+int sdhci_wait_for_busy(struct sdhci *host, struct mci_cmd *cmd);
 void sdhci_read_response(struct sdhci *host, struct mci_cmd *cmd);
 void sdhci_set_cmd_xfer_mode(struct sdhci *host, struct mci_cmd *cmd,
 			     struct mci_data *data, bool dma, u32 *command,
@@ -265,6 +317,8 @@ void sdhci_set_cmd_xfer_mode(struct sdhci *host, struct mci_cmd *cmd,
 void sdhci_setup_data_pio(struct sdhci *sdhci, struct mci_data *data);
 void sdhci_setup_data_dma(struct sdhci *sdhci, struct mci_data *data, dma_addr_t *dma);
 int sdhci_transfer_data(struct sdhci *sdhci, struct mci_data *data, dma_addr_t dma);
+void sdhci_teardown_data_dma(struct sdhci *sdhci, struct mci_data *data,
+			     dma_addr_t dma);
 int sdhci_transfer_data_pio(struct sdhci *sdhci, struct mci_data *data);
 int sdhci_transfer_data_dma(struct sdhci *sdhci, struct mci_data *data,
 			    dma_addr_t dma);
@@ -274,6 +328,9 @@ u16 sdhci_calc_clk(struct sdhci *host, unsigned int clock,
 void sdhci_set_clock(struct sdhci *host, unsigned int clock, unsigned int input_clock);
 void sdhci_enable_clk(struct sdhci *host, u16 clk);
 int sdhci_setup_host(struct sdhci *host);
+int sdhci_setup_adma(struct sdhci *host);
+void sdhci_adma_write_desc(struct sdhci *sdhci, void **desc,
+			   dma_addr_t addr, int len, unsigned int cmd);
 void __sdhci_read_caps(struct sdhci *host, const u16 *ver,
 			const u32 *caps, const u32 *caps1);
 static inline void sdhci_read_caps(struct sdhci *host)
@@ -29,11 +29,22 @@
 
 struct m25p {
 	struct spi_mem		*spimem;
+	struct spi_mem_dirmap_desc *rdesc;
 	struct spi_nor		spi_nor;
 	struct mtd_info		mtd;
 	u8			command[MAX_CMD_SIZE];
 };
 
+static void m25p80_set_read_op(struct spi_nor *nor, struct spi_mem_op *op)
+{
+	op->cmd.buswidth = spi_nor_get_protocol_inst_nbits(nor->read_proto);
+	op->addr.buswidth = spi_nor_get_protocol_addr_nbits(nor->read_proto);
+	op->dummy.buswidth = op->addr.buswidth;
+	op->data.buswidth = spi_nor_get_protocol_data_nbits(nor->read_proto);
+
+	op->dummy.nbytes = (nor->read_dummy * op->dummy.buswidth) / 8;
+}
+
 static int m25p80_read_reg(struct spi_nor *nor, u8 code, u8 *val, int len)
 {
 	struct m25p *flash = nor->priv;
@@ -107,14 +118,29 @@ static int m25p80_read(struct spi_nor *nor, loff_t from, size_t len,
 			   SPI_MEM_OP_DUMMY(nor->read_dummy, 1),
 			   SPI_MEM_OP_DATA_IN(len, buf, 1));
 	size_t remaining = len;
+	ssize_t nread;
 	int ret;
 
-	op.cmd.buswidth = spi_nor_get_protocol_inst_nbits(nor->read_proto);
-	op.addr.buswidth = spi_nor_get_protocol_addr_nbits(nor->read_proto);
-	op.dummy.buswidth = op.addr.buswidth;
-	op.data.buswidth = spi_nor_get_protocol_data_nbits(nor->read_proto);
+	if (flash->rdesc) {
+		while (remaining) {
+			nread = spi_mem_dirmap_read(flash->rdesc, from,
+						    remaining, buf);
+			if (nread < 0)
+				return nread;
+			if (!nread)
+				return -EIO;
+
+			from += nread;
+			buf += nread;
+			remaining -= nread;
+		}
+
+		*retlen = len;
 
-	op.dummy.nbytes = (nor->read_dummy * op.dummy.buswidth) / 8;
+		return 0;
+	}
+
+	m25p80_set_read_op(nor, &op);
 
 	while (remaining) {
 		op.data.nbytes = remaining < UINT_MAX ? remaining : UINT_MAX;
@@ -134,6 +160,36 @@ static int m25p80_read(struct spi_nor *nor, loff_t from, size_t len,
 	return 0;
 }
 
+/*
+ * Create a direct mapping for reads once the read op code, protocol and
+ * number of dummy cycles are known. Controllers with a memory mapped flash
+ * window can then serve large reads in one go instead of op by op, the
+ * others fall back to regular spi-mem operations.
+ */
+static void m25p80_create_read_dirmap(struct m25p *flash)
+{
+	struct spi_nor *nor = &flash->spi_nor;
+	struct spi_mem_dirmap_info info = {
+		.op_tmpl = SPI_MEM_OP(SPI_MEM_OP_CMD(nor->read_opcode, 1),
+				      SPI_MEM_OP_ADDR(nor->addr_width, 0, 1),
+				      SPI_MEM_OP_DUMMY(0, 1),
+				      SPI_MEM_OP_DATA_IN(0, NULL, 1)),
+		.offset = 0,
+		.length = flash->mtd.size,
+	};
+	struct spi_mem_dirmap_desc *desc;
+
+	m25p80_set_read_op(nor, &info.op_tmpl);
+
+	desc = spi_mem_dirmap_create(flash->spimem, &info);
+	if (IS_ERR(desc)) {
+		dev_dbg(nor->dev, "no read dirmap: %pe\n", desc);
+		return;
+	}
+
+	flash->rdesc = desc;
+}
+
 /*
  * Do NOT add to this array without reading the following:
  *
@@ -234,11 +290,18 @@ static int m25p_probe(struct device *dev)
 	flash->mtd.dev.parent = &spi->dev;
 	flash->spimem = spimem;
 
-	if (spi->mode & SPI_RX_QUAD)
+	if (spi->mode & SPI_RX_QUAD) {
 		hwcaps.mask |= SNOR_HWCAPS_READ_1_1_4;
-	else if (spi->mode & SPI_RX_DUAL)
+
+		if (spi->mode & SPI_TX_QUAD)
+			hwcaps.mask |= SNOR_HWCAPS_READ_1_4_4;
+	} else if (spi->mode & SPI_RX_DUAL) {
 		hwcaps.mask |= SNOR_HWCAPS_READ_1_1_2;
 
+		if (spi->mode & SPI_TX_DUAL)
+			hwcaps.mask |= SNOR_HWCAPS_READ_1_2_2;
+	}
+
 	dev->priv = (void *)flash;
 
 	if (dev->id_entry)
@@ -253,6 +316,8 @@ static int m25p_probe(struct device *dev)
 	if (ret)
 		return ret;
 
+	m25p80_create_read_dirmap(flash);
+
 	device_id = DEVICE_ID_SINGLE;
 	if (dev->of_node)
 		flash_name = of_alias_get(dev->of_node);
@@ -68,6 +68,10 @@ int nand_bch_correct_data(struct nand_chip *chip, unsigned char *buf,
 	unsigned int *errloc = nbc->errloc;
 	int i, count;
 
+	/* fast path: a clean codeword needs no decoding at all */
+	if (!memcmp(read_ecc, calc_ecc, chip->ecc.bytes))
+		return 0;
+
 	count = decode_bch(nbc->bch, NULL, chip->ecc.size, read_ecc, calc_ecc,
 			   NULL, errloc);
 	if (count > 0) {
@@ -1123,6 +1123,242 @@ static int spi_nor_unlock_global_block_protection(struct spi_nor *nor)
 	return spi_nor_wait_till_ready(nor);
 }
 
+static int macronix_quad_enable(struct spi_nor *nor)
+{
+	int ret, val;
+
+	val = read_sr(nor);
+	if (val < 0)
+		return val;
+	if (val & SR_QUAD_EN_MX)
+		return 0;
+
+	write_enable(nor);
+
+	write_sr(nor, val | SR_QUAD_EN_MX);
+
+	ret = spi_nor_wait_till_ready(nor);
+	if (ret)
+		return ret;
+
+	ret = read_sr(nor);
+	if (!(ret > 0 && (ret & SR_QUAD_EN_MX))) {
+		dev_err(nor->dev, "Macronix Quad bit not set\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/*
+ * Serial Flash Discoverable Parameters (SFDP), see JESD216. Only the Basic
+ * Flash Parameter Table (BFPT) is parsed and only for the (Fast) Read
+ * settings and the Quad Enable requirements.
+ */
+#define SFDP_SIGNATURE		0x50444653U
+#define SFDP_BFPT_ID		0xff00
+
+struct sfdp_parameter_header {
+	u8	id_lsb;
+	u8	minor;
+	u8	major;
+	u8	length;		/* in double words */
+	u8	parameter_table_pointer[3];	/* byte address */
+	u8	id_msb;
+};
+
+#define SFDP_PARAM_HEADER_ID(p)	(((p)->id_msb << 8) | (p)->id_lsb)
+#define SFDP_PARAM_HEADER_PTP(p) \
+	(((p)->parameter_table_pointer[2] << 16) | \
+	 ((p)->parameter_table_pointer[1] <<  8) | \
+	 ((p)->parameter_table_pointer[0] <<  0))
+
+struct sfdp_header {
+	__le32	signature;
+	u8	minor;
+	u8	major;
+	u8	nph;		/* 0-base number of parameter headers */
+	u8	unused;
+
+	/* The Basic Flash Parameter Table header is mandatory */
+	struct sfdp_parameter_header	bfpt_header;
+};
+
+#define BFPT_DWORD(i)		((i) - 1)
+#define BFPT_DWORD_MAX		16
+
+/* The first version of JESD216 defined only 9 DWORDs. */
+#define BFPT_DWORD_MAX_JESD216	9
+
+#define BFPT_DWORD15_QER_MASK			GENMASK(22, 20)
+#define BFPT_DWORD15_QER_NONE			(0x0UL << 20)
+#define BFPT_DWORD15_QER_SR2_BIT1_BUGGY		(0x1UL << 20)
+#define BFPT_DWORD15_QER_SR1_BIT6		(0x2UL << 20)
+#define BFPT_DWORD15_QER_SR2_BIT1_NO_RD		(0x4UL << 20)
+#define BFPT_DWORD15_QER_SR2_BIT1		(0x5UL << 20)
+
+struct sfdp_bfpt_read {
+	u32	hwcaps;
+	u32	supported_dword;
+	u32	supported_bit;
+	u32	settings_dword;
+	u32	settings_shift;
+	enum spi_nor_read_command_index	cmd;
+	enum spi_nor_protocol		proto;
+};
+
+static const struct sfdp_bfpt_read sfdp_bfpt_reads[] = {
+	{
+		SNOR_HWCAPS_READ_1_1_2, BFPT_DWORD(1), BIT(16),
+		BFPT_DWORD(4), 0, SNOR_CMD_READ_1_1_2, SNOR_PROTO_1_1_2,
+	}, {
+		SNOR_HWCAPS_READ_1_2_2, BFPT_DWORD(1), BIT(20),
+		BFPT_DWORD(4), 16, SNOR_CMD_READ_1_2_2, SNOR_PROTO_1_2_2,
+	}, {
+		SNOR_HWCAPS_READ_1_1_4, BFPT_DWORD(1), BIT(22),
+		BFPT_DWORD(3), 16, SNOR_CMD_READ_1_1_4, SNOR_PROTO_1_1_4,
+	}, {
+		SNOR_HWCAPS_READ_1_4_4, BFPT_DWORD(1), BIT(21),
+		BFPT_DWORD(3), 0, SNOR_CMD_READ_1_4_4, SNOR_PROTO_1_4_4,
+	},
+};
+
+static int spi_nor_read_sfdp(struct spi_nor *nor, u32 addr,
+			     size_t len, void *buf)
+{
+	u8 addr_width, read_opcode, read_dummy;
+	enum spi_nor_protocol read_proto;
+	size_t retlen;
+	int ret;
+
+	read_opcode = nor->read_opcode;
+	addr_width = nor->addr_width;
+	read_dummy = nor->read_dummy;
+	read_proto = nor->read_proto;
+
+	nor->read_opcode = SPINOR_OP_RDSFDP;
+	nor->addr_width = 3;
+	nor->read_dummy = 8;
+	nor->read_proto = SNOR_PROTO_1_1_1;
+
+	ret = nor->read(nor, addr, len, &retlen, buf);
+	if (!ret && retlen != len)
+		ret = -EIO;
+
+	nor->read_opcode = read_opcode;
+	nor->addr_width = addr_width;
+	nor->read_dummy = read_dummy;
+	nor->read_proto = read_proto;
+
+	return ret;
+}
+
+static int spi_nor_parse_bfpt(struct spi_nor *nor,
+			      const struct sfdp_parameter_header *bfpt_header,
+			      struct spi_nor_flash_parameter *params)
+{
+	u32 *bfpt;
+	size_t len;
+	int i, ret;
+
+	if (bfpt_header->length < BFPT_DWORD_MAX_JESD216)
+		return -EINVAL;
+
+	bfpt = kzalloc(BFPT_DWORD_MAX * sizeof(*bfpt), GFP_KERNEL);
+	if (!bfpt)
+		return -ENOMEM;
+
+	len = min_t(size_t, bfpt_header->length, BFPT_DWORD_MAX) * sizeof(*bfpt);
+	ret = spi_nor_read_sfdp(nor, SFDP_PARAM_HEADER_PTP(bfpt_header),
+				len, bfpt);
+	if (ret)
+		goto out;
+
+	for (i = 0; i < BFPT_DWORD_MAX; i++)
+		bfpt[i] = le32_to_cpu((__force __le32)bfpt[i]);
+
+	/* The BFPT is the authority on which multi I/O reads are supported */
+	params->hwcaps.mask &= ~(SNOR_HWCAPS_READ_DUAL | SNOR_HWCAPS_READ_QUAD);
+
+	for (i = 0; i < ARRAY_SIZE(sfdp_bfpt_reads); i++) {
+		const struct sfdp_bfpt_read *rd = &sfdp_bfpt_reads[i];
+		u16 half;
+
+		if (!(bfpt[rd->supported_dword] & rd->supported_bit))
+			continue;
+
+		half = bfpt[rd->settings_dword] >> rd->settings_shift;
+
+		params->hwcaps.mask |= rd->hwcaps;
+		spi_nor_set_read_settings(&params->reads[rd->cmd],
+					  (half >> 5) & 0x7, half & 0x1f,
+					  half >> 8, rd->proto);
+	}
+
+	/* JESD216 rev A doesn't specify the Quad Enable requirements */
+	if (bfpt_header->length < BFPT_DWORD(15) + 1)
+		goto out;
+
+	switch (bfpt[BFPT_DWORD(15)] & BFPT_DWORD15_QER_MASK) {
+	case BFPT_DWORD15_QER_NONE:
+		params->quad_enable = NULL;
+		break;
+	case BFPT_DWORD15_QER_SR2_BIT1_BUGGY:
+	case BFPT_DWORD15_QER_SR2_BIT1_NO_RD:
+	case BFPT_DWORD15_QER_SR2_BIT1:
+		params->quad_enable = spansion_quad_enable;
+		break;
+	case BFPT_DWORD15_QER_SR1_BIT6:
+		params->quad_enable = macronix_quad_enable;
+		break;
+	default:
+		dev_dbg(nor->dev, "unsupported Quad Enable requirement\n");
+		params->hwcaps.mask &= ~SNOR_HWCAPS_READ_QUAD;
+		break;
+	}
+
+out:
+	kfree(bfpt);
+
+	return ret;
+}
+
+/**
+ * spi_nor_parse_sfdp() - parse the Serial Flash Discoverable Parameters.
+ * @nor:	pointer to a 'struct spi_nor'
+ * @params:	pointer to the 'struct spi_nor_flash_parameter' to be filled
+ *
+ * Return: 0 on success, -errno otherwise.
+ */
+static int spi_nor_parse_sfdp(struct spi_nor *nor,
+			      struct spi_nor_flash_parameter *params)
+{
+	struct sfdp_header *header;
+	int ret;
+
+	header = kzalloc(sizeof(*header), GFP_KERNEL);
+	if (!header)
+		return -ENOMEM;
+
+	ret = spi_nor_read_sfdp(nor, 0, sizeof(*header), header);
+	if (ret)
+		goto out;
+
+	if (le32_to_cpu(header->signature) != SFDP_SIGNATURE ||
+	    header->major != 1 ||
+	    SFDP_PARAM_HEADER_ID(&header->bfpt_header) != SFDP_BFPT_ID ||
+	    header->bfpt_header.major != 1) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	ret = spi_nor_parse_bfpt(nor, &header->bfpt_header, params);
+out:
+	kfree(header);
+
+	return ret;
+}
+
 static int spi_nor_init_params(struct spi_nor *nor,
 			       const struct flash_info *info,
 			       struct spi_nor_flash_parameter *params)
@@ -1182,6 +1418,19 @@ static int spi_nor_init_params(struct spi_nor *nor,
 				   SNOR_HWCAPS_PP_QUAD))
 		params->quad_enable = spansion_quad_enable;
 
+	/* Override the legacy parameters with the ones found in SFDP. */
+	if ((info->flags & (SPI_NOR_DUAL_READ | SPI_NOR_QUAD_READ)) &&
+	    !(info->flags & SPI_NOR_SKIP_SFDP)) {
+		struct spi_nor_flash_parameter sfdp_params;
+
+		memcpy(&sfdp_params, params, sizeof(sfdp_params));
+		if (spi_nor_parse_sfdp(nor, &sfdp_params))
+			dev_dbg(nor->dev,
+				"no usable SFDP tables, using defaults\n");
+		else
+			memcpy(params, &sfdp_params, sizeof(*params));
+	}
+
 	return 0;
 }
 
@@ -938,7 +938,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	struct ubi_vid_io_buf *vidb = ai->vidb;
 	struct ubi_vid_hdr *vidh = ubi_get_vid_hdr(vidb);
 	long long ec;
-	int err, bitflips = 0, vol_id = -1, ec_err = 0;
+	int err, bitflips = 0, vol_id = -1, ec_err = 0, vid_err = 0;
 
 	dbg_bld("scan PEB %d", pnum);
 
@@ -951,7 +951,15 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		return 0;
 	}
 
-	err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
+	/*
+	 * When both headers live in the same flash page, fetch them with one
+	 * read instead of making the flash load the page twice.
+	 */
+	if (ai->hdrs_buf)
+		err = ubi_io_read_hdrs(ubi, pnum, ai->hdrs_buf, ech, vidb,
+				       &vid_err);
+	else
+		err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1034,7 +1042,10 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 
 	/* OK, we've done with the EC header, let's look at the VID header */
 
-	err = ubi_io_read_vid_hdr(ubi, pnum, vidb, 0);
+	if (ai->hdrs_buf)
+		err = vid_err;
+	else
+		err = ubi_io_read_vid_hdr(ubi, pnum, vidb, 0);
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1365,7 +1376,7 @@ static void destroy_ai(struct ubi_attach_info *ai)
 static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		    int start)
 {
-	int err, pnum;
+	int err, pnum, hdrs_len;
 	struct rb_node *rb1, *rb2;
 	struct ubi_ainf_volume *av;
 	struct ubi_ainf_peb *aeb;
@@ -1380,6 +1391,10 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	if (!ai->vidb)
 		goto out_ech;
 
+	hdrs_len = ubi_io_hdrs_combined(ubi);
+	if (hdrs_len)
+		ai->hdrs_buf = kmalloc(hdrs_len, GFP_KERNEL);
+
 	for (pnum = start; pnum < ubi->peb_count; pnum++) {
 		dbg_gen("process PEB %d", pnum);
 		err = scan_peb(ubi, ai, pnum, false);
@@ -1424,12 +1439,16 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	if (err)
 		goto out_vidh;
 
+	kfree(ai->hdrs_buf);
+	ai->hdrs_buf = NULL;
 	ubi_free_vid_buf(ai->vidb);
 	kfree(ai->ech);
 
 	return 0;
 
 out_vidh:
+	kfree(ai->hdrs_buf);
+	ai->hdrs_buf = NULL;
 	ubi_free_vid_buf(ai->vidb);
 out_ech:
 	kfree(ai->ech);
@@ -1468,7 +1487,7 @@ static struct ubi_attach_info *alloc_ai(void)
  */
 static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 {
-	int err, pnum;
+	int err, pnum, hdrs_len;
 	struct ubi_attach_info *scan_ai;
 
 	err = -ENOMEM;
@@ -1485,6 +1504,10 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 	if (!scan_ai->vidb)
 		goto out_ech;
 
+	hdrs_len = ubi_io_hdrs_combined(ubi);
+	if (hdrs_len)
+		scan_ai->hdrs_buf = kmalloc(hdrs_len, GFP_KERNEL);
+
 	for (pnum = 0; pnum < UBI_FM_MAX_START; pnum++) {
 		dbg_gen("process PEB %d", pnum);
 		err = scan_peb(ubi, scan_ai, pnum, true);
@@ -1492,6 +1515,8 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 			goto out_vidh;
 	}
 
+	kfree(scan_ai->hdrs_buf);
+	scan_ai->hdrs_buf = NULL;
 	ubi_free_vid_buf(scan_ai->vidb);
 	kfree(scan_ai->ech);
 
@@ -1513,6 +1538,7 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 	return err;
 
 out_vidh:
+	kfree(scan_ai->hdrs_buf);
 	ubi_free_vid_buf(scan_ai->vidb);
 out_ech:
 	kfree(scan_ai->ech);
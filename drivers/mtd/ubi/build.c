@@ -627,6 +627,18 @@ int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num,
 	/* No threading, call ubi_thread directly */
 	ubi_thread(ubi);
 
+#ifdef CONFIG_MTD_UBI_FASTMAP
+	/*
+	 * We had to scan the whole device to attach it. Write a fastmap right
+	 * away so that the next attach does not have to do this again.
+	 */
+	if (!ubi->fast_attach && !ubi->fm_disabled) {
+		err = ubi_update_fastmap(ubi);
+		if (err)
+			ubi_warn(ubi, "unable to write a new fastmap: %d", err);
+	}
+#endif
+
 	if (ubi->autoresize_vol_id != -1) {
 		err = autoresize(ubi, ubi->autoresize_vol_id);
 		if (err)
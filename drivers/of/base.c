@@ -21,6 +21,9 @@
 #include <linux/clk.h>
 #include <linux/ctype.h>
 #include <linux/err.h>
+#include <linux/hash.h>
+#include <linux/log2.h>
+#include <linux/slab.h>
 
 static struct device_node *root_node;
 
@@ -59,6 +62,227 @@ static inline struct device_node *of_next_node(struct device_node *node)
 #define of_tree_for_each_node_from(node, from) \
 	for (node = of_next_node(from); node; node = of_next_node(node))
 
+/*
+ * Lookup index for the live tree. Phandle and compatible lookups are
+ * answered from hash tables instead of walking the whole tree. The index
+ * is built on the first lookup and thrown away whenever nodes are added or
+ * removed or a "compatible" or "phandle" property changes in any tree, so
+ * it always reflects the tree it was built from. Within a bucket the
+ * entries are kept in tree order, so the results are the same as for a
+ * tree walk.
+ */
+struct of_index_entry {
+	struct device_node *np;
+	const char *compatible;
+	struct of_index_entry *next;
+};
+
+static struct of_index {
+	struct device_node *root;
+	unsigned int generation;
+	unsigned int bits;
+	struct of_index_entry **phandle;
+	struct of_index_entry **compat;
+	struct of_index_entry *entries;
+} of_index;
+
+static unsigned int of_tree_generation;
+
+static struct {
+	unsigned int hits;
+	unsigned int walks;
+	unsigned int rebuilds;
+} of_index_stats;
+
+static void of_tree_changed(void)
+{
+	of_tree_generation++;
+}
+
+static void of_index_prop_changed(const char *name)
+{
+	if (!of_prop_cmp(name, "compatible") || !of_prop_cmp(name, "phandle"))
+		of_tree_changed();
+}
+
+static u32 of_compat_hash(const char *compat, unsigned int bits)
+{
+	u32 hash = 0;
+
+	while (*compat)
+		hash = hash * 31 + tolower(*compat++);
+
+	return hash_32(hash, bits);
+}
+
+static void of_index_free(void)
+{
+	free(of_index.phandle);
+	free(of_index.compat);
+	free(of_index.entries);
+	memset(&of_index, 0, sizeof(of_index));
+}
+
+static bool of_compat_listed(struct property *prop, const char *compat)
+{
+	const char *cp;
+
+	for (cp = of_prop_next_string(prop, NULL); cp != compat;
+	     cp = of_prop_next_string(prop, cp))
+		if (!of_compat_cmp(cp, compat, strlen(compat)))
+			return true;
+
+	return false;
+}
+
+static int of_index_build(void)
+{
+	struct of_index_entry *e;
+	struct device_node *np;
+	struct property *prop;
+	unsigned int nr = 0, nr_nodes = 0, i;
+	const char *cp;
+
+	of_index_free();
+
+	of_tree_for_each_node_from(np, NULL) {
+		nr_nodes++;
+		if (np->phandle)
+			nr++;
+		prop = of_find_property(np, "compatible", NULL);
+		for (cp = of_prop_next_string(prop, NULL); cp;
+		     cp = of_prop_next_string(prop, cp))
+			nr++;
+	}
+
+	of_index.bits = ilog2(roundup_pow_of_two(max(nr_nodes, 16U)));
+	of_index.phandle = calloc(1 << of_index.bits, sizeof(e));
+	of_index.compat = calloc(1 << of_index.bits, sizeof(e));
+	of_index.entries = calloc(nr, sizeof(*e));
+	if (!of_index.phandle || !of_index.compat || (nr && !of_index.entries)) {
+		of_index_free();
+		return -ENOMEM;
+	}
+
+	e = of_index.entries;
+
+	of_tree_for_each_node_from(np, NULL) {
+		if (np->phandle) {
+			e->np = np;
+			e++;
+		}
+
+		prop = of_find_property(np, "compatible", NULL);
+		for (cp = of_prop_next_string(prop, NULL); cp;
+		     cp = of_prop_next_string(prop, cp)) {
+			/* a node must show up only once per compatible */
+			if (of_compat_listed(prop, cp))
+				continue;
+			e->np = np;
+			e->compatible = cp;
+			e++;
+		}
+	}
+
+	/* Insert backwards, so that every bucket ends up in tree order */
+	for (i = e - of_index.entries; i > 0; i--) {
+		struct of_index_entry **bucket;
+
+		e = &of_index.entries[i - 1];
+		if (e->compatible)
+			bucket = &of_index.compat[of_compat_hash(e->compatible,
+								 of_index.bits)];
+		else
+			bucket = &of_index.phandle[hash_32(e->np->phandle,
+							   of_index.bits)];
+		e->next = *bucket;
+		*bucket = e;
+	}
+
+	of_index.root = root_node;
+	of_index.generation = of_tree_generation;
+	of_index_stats.rebuilds++;
+
+	return 0;
+}
+
+/*
+ * Returns true when the index can be used for lookups in the tree @root.
+ * Only the live tree is indexed.
+ */
+static bool of_index_usable(const struct device_node *root)
+{
+	if (!root_node || (root && root != root_node))
+		return false;
+
+	if (of_index.root == root_node &&
+	    of_index.generation == of_tree_generation)
+		return true;
+
+	return of_index_build() == 0;
+}
+
+static struct device_node *of_index_find_phandle(phandle phandle,
+						 const struct device_node *root)
+{
+	struct of_index_entry *e;
+
+	e = of_index.phandle[hash_32(phandle, of_index.bits)];
+	for (; e; e = e->next) {
+		/* the start node itself is not searched */
+		if (e->np->phandle == phandle && e->np != root)
+			return e->np;
+	}
+
+	return NULL;
+}
+
+/*
+ * Find the first node after @from in tree order which is compatible to
+ * @compat. Returns -ENOENT as error pointer when @from is not found in the
+ * index, the caller has to fall back to walking the tree then.
+ */
+static struct device_node *of_index_find_compatible(const struct device_node *from,
+						    const char *compat)
+{
+	struct of_index_entry *e;
+	bool skip_root = false;
+
+	e = of_index.compat[of_compat_hash(compat, of_index.bits)];
+
+	if (from == root_node) {
+		/* the root node is the first in tree order */
+		skip_root = true;
+	} else if (from) {
+		for (; e; e = e->next)
+			if (e->np == from &&
+			    !of_compat_cmp(e->compatible, compat, strlen(compat)))
+				break;
+		if (!e)
+			return ERR_PTR(-ENOENT);
+		e = e->next;
+	}
+
+	for (; e; e = e->next) {
+		if (skip_root && e->np == root_node)
+			continue;
+		if (!of_compat_cmp(e->compatible, compat, strlen(compat)))
+			return e->np;
+	}
+
+	return NULL;
+}
+
+/**
+ * of_print_lookup_stats - print statistics of the devicetree lookup index
+ */
+void of_print_lookup_stats(void)
+{
+	printf("devicetree lookups from index: %u\n", of_index_stats.hits);
+	printf("devicetree lookups walking the tree: %u\n", of_index_stats.walks);
+	printf("index rebuilds: %u\n", of_index_stats.rebuilds);
+}
+
 /**
  * struct alias_prop - Alias property in 'aliases' node
  * @link:	List node to link the structure in aliases_lookup list
@@ -341,6 +565,13 @@ struct device_node *of_find_node_by_phandle_from(phandle phandle,
 {
 	struct device_node *node;
 
+	if (phandle && of_index_usable(root)) {
+		of_index_stats.hits++;
+		return of_index_find_phandle(phandle, root);
+	}
+
+	of_index_stats.walks++;
+
 	of_tree_for_each_node_from(node, root)
 		if (node->phandle == phandle)
 			return node;
@@ -644,6 +875,16 @@ struct device_node *of_find_compatible_node(struct device_node *from,
 {
 	struct device_node *np;
 
+	if (of_index_usable(NULL)) {
+		np = of_index_find_compatible(from, compatible);
+		if (!IS_ERR(np)) {
+			of_index_stats.hits++;
+			return np;
+		}
+	}
+
+	of_index_stats.walks++;
+
 	of_tree_for_each_node_from(np, from)
 		if (of_device_is_compatible(np, compatible))
 			return np;
@@ -833,7 +1074,7 @@ int of_property_count_elems_of_size(const struct device_node *np,
 
 	if (!prop)
 		return -EINVAL;
-	if (!prop->value)
+	if (!of_property_get_value(prop))
 		return -ENODATA;
 
 	if (prop->length % elem_size != 0) {
@@ -1728,6 +1969,7 @@ int of_set_root_node(struct device_node *node)
 		return -EBUSY;
 
 	root_node = node;
+	of_tree_changed();
 
 	of_chosen = of_find_node_by_path("/chosen");
 	of_property_read_string(root_node, "model", &of_model);
@@ -1992,9 +2234,9 @@ int of_property_read_string_helper(const struct device_node *np,
 
 	if (!prop)
 		return -EINVAL;
-	if (!prop->value)
+	p = of_property_get_value(prop);
+	if (!p)
 		return -ENODATA;
-	p = prop->value;
 	end = p + prop->length;
 
 	for (i = 0; p < end && (!out_strs || i < skip + sz); i++, p += l) {
@@ -2203,6 +2445,8 @@ struct device_node *of_new_node(struct device_node *parent, const char *name)
 
 	node = xzalloc(sizeof(*node));
 	node->parent = parent;
+
+	of_tree_changed();
 	if (parent)
 		list_add_tail(&node->parent_list, &parent->children);
 
@@ -2223,17 +2467,33 @@ struct device_node *of_new_node(struct device_node *parent, const char *name)
 	return node;
 }
 
+static struct kmem_cache *of_property_cache;
+
+static struct property *of_property_alloc(void)
+{
+	if (!of_property_cache)
+		of_property_cache = KMEM_CACHE(property, 0);
+	if (!of_property_cache)
+		return NULL;
+
+	return kmem_cache_zalloc(of_property_cache, GFP_KERNEL);
+}
+
 struct property *__of_new_property(struct device_node *node, const char *name,
 				   void *data, int len)
 {
 	struct property *prop;
 
-	prop = xzalloc(sizeof(*prop));
+	prop = of_property_alloc();
+	if (!prop)
+		return NULL;
+
 	prop->name = xstrdup(name);
 	prop->length = len;
 	prop->value = data;
 
 	list_add_tail(&prop->list, &node->properties);
+	of_index_prop_changed(name);
 
 	return prop;
 }
@@ -2281,12 +2541,16 @@ struct property *of_new_property_const(struct device_node *node, const char *nam
 {
 	struct property *prop;
 
-	prop = xzalloc(sizeof(*prop));
+	prop = of_property_alloc();
+	if (!prop)
+		return NULL;
+
 	prop->name = xstrdup(name);
 	prop->length = len;
 	prop->value_const = data;
 
 	list_add_tail(&prop->list, &node->properties);
+	of_index_prop_changed(name);
 
 	return prop;
 }
@@ -2297,10 +2561,11 @@ void of_delete_property(struct property *pp)
 		return;
 
 	list_del(&pp->list);
+	of_index_prop_changed(pp->name);
 
 	free(pp->name);
 	free(pp->value);
-	free(pp);
+	kmem_cache_free(of_property_cache, pp);
 }
 
 struct property *of_rename_property(struct device_node *np,
@@ -2314,6 +2579,9 @@ struct property *of_rename_property(struct device_node *np,
 
 	of_property_write_bool(np, new_name, false);
 
+	of_index_prop_changed(old_name);
+	of_index_prop_changed(new_name);
+
 	free(pp->name);
 	pp->name = xstrdup(new_name);
 	return pp;
@@ -2387,6 +2655,7 @@ int of_append_property(struct device_node *np, const char *name, const void *val
 
 	pp->value = buf;
 	pp->length += len;
+	of_index_prop_changed(name);
 
 	if (pp->value_const) {
 		memcpy(buf, pp->value_const, orig_len);
@@ -2422,6 +2691,7 @@ int of_prepend_property(struct device_node *np, const char *name, const void *va
 	pp->value = buf;
 	pp->length = len + oldlen;
 	pp->value_const = NULL;
+	of_index_prop_changed(name);
 
 	return 0;
 }
@@ -2640,7 +2910,8 @@ void of_merge_nodes(struct device_node *np, const struct device_node *other)
 	struct property *pp;
 
 	list_for_each_entry(pp, &other->properties, list)
-		of_new_property(np, pp->name, pp->value, pp->length);
+		of_new_property(np, pp->name, of_property_get_value(pp),
+				pp->length);
 
 	for_each_child_of_node(other, child)
 		of_copy_node(np, child);
@@ -2676,6 +2947,8 @@ void of_delete_node(struct device_node *node)
 		return;
 	}
 
+	of_tree_changed();
+
 	list_for_each_entry_safe(p, pt, &node->properties, list)
 		of_delete_property(p);
 
@@ -2687,6 +2960,9 @@ void of_delete_node(struct device_node *node)
 		list_del(&node->list);
 	}
 
+	if (!node->parent)
+		of_unflatten_release(node);
+
 	free(node->name);
 	free(node->full_name);
 	free(node);
@@ -2917,7 +3193,9 @@ struct device_node *of_read_file(const char *filename)
 		goto out;
 	}
 
-	root = of_unflatten_dtb(fdt, size);
+	root = of_unflatten_dtb_owned(fdt, size);
+	if (!IS_ERR(root))
+		return root;
 out:
 	free(fdt);
 
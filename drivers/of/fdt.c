@@ -15,6 +15,7 @@
 #include <linux/sizes.h>
 #include <linux/ctype.h>
 #include <linux/err.h>
+#include <linux/log2.h>
 
 static inline uint32_t dt_struct_advance(struct fdt_header *f, uint32_t dt, int size)
 {
@@ -35,6 +36,65 @@ static inline char *dt_string(struct fdt_header *f, char *strstart, uint32_t ofs
 		return strstart + ofs;
 }
 
+/*
+ * A blob which a tree has been unflattened from in place. Property values
+ * of such trees point into the blob until they are written to, and
+ * flattening the tree again copies unmodified subtrees from it in one go.
+ */
+struct of_fdt_source {
+	struct list_head list;
+	struct device_node *root;
+	const void *fdt;
+	struct fdt_header f;
+	bool owned;
+};
+
+static LIST_HEAD(of_fdt_sources);
+
+static struct of_fdt_source *of_fdt_find_source(const struct device_node *root)
+{
+	struct of_fdt_source *src;
+
+	list_for_each_entry(src, &of_fdt_sources, list)
+		if (src->root == root)
+			return src;
+
+	return NULL;
+}
+
+static void of_fdt_add_source(struct device_node *root, const void *fdt,
+			      const struct fdt_header *f)
+{
+	struct of_fdt_source *src;
+
+	src = xzalloc(sizeof(*src));
+	src->root = root;
+	src->fdt = fdt;
+	src->f = *f;
+
+	list_add(&src->list, &of_fdt_sources);
+}
+
+/**
+ * of_unflatten_release - release the blob a tree was unflattened from
+ * @root - The root node of the tree
+ *
+ * Called when a tree is deleted. Blobs handed over to of_unflatten_dtb_owned()
+ * are freed here.
+ */
+void of_unflatten_release(struct device_node *root)
+{
+	struct of_fdt_source *src = of_fdt_find_source(root);
+
+	if (!src)
+		return;
+
+	list_del(&src->list);
+	if (src->owned)
+		free((void *)src->fdt);
+	free(src);
+}
+
 static int of_reservemap_num_entries(const struct fdt_header *fdt)
 {
 	const struct fdt_reserve_entry *r;
@@ -188,6 +248,9 @@ static struct device_node *__of_unflatten_dtb(const void *infdt, int size,
 				node = of_new_node(node, pathp);
 			}
 
+			if (constprops)
+				node->fdt_node = fnh;
+
 			dt_struct = dt_struct_advance(&f, dt_struct,
 					sizeof(struct fdt_node_header) + len + 1);
 
@@ -236,6 +299,9 @@ static struct device_node *__of_unflatten_dtb(const void *infdt, int size,
 			break;
 
 		case FDT_END:
+			if (constprops)
+				of_fdt_add_source(root, infdt, &f);
+
 			return root;
 
 		default:
@@ -283,7 +349,29 @@ struct device_node *of_unflatten_dtb_const(const void *infdt, int size)
 	return __of_unflatten_dtb(infdt, size, true);
 }
 
+/**
+ * of_unflatten_dtb_owned - unflatten a dtb binary blob without copying it
+ * @infdt - the fdt blob to unflatten, allocated with malloc()
+ *
+ * Like of_unflatten_dtb_const(), but the returned tree takes ownership of
+ * @infdt, which is freed when the tree is deleted with of_delete_node().
+ * Property values are only copied once they are modified, and flattening
+ * the tree again copies unmodified subtrees from @infdt directly. On failure
+ * @infdt is still owned by the caller.
+ */
+struct device_node *of_unflatten_dtb_owned(void *infdt, int size)
+{
+	struct device_node *root;
+
+	root = __of_unflatten_dtb(infdt, size, true);
+	if (!IS_ERR(root))
+		of_fdt_find_source(root)->owned = true;
+
+	return root;
+}
+
 struct fdt {
+	const struct of_fdt_source *src;
 	void *dt;
 	uint32_t dt_nextofs;
 	uint32_t dt_size;
@@ -355,7 +443,7 @@ static int fdt_ensure_space(struct fdt *fdt, int dtsize)
 		fdt->str_size *= 2;
 	}
 
-	if (fdt->dt_size - fdt->dt_nextofs < 1024 + dtsize) {
+	while (fdt->dt_size - fdt->dt_nextofs < 1024 + dtsize) {
 		fdt->dt = memalign_realloc(fdt->dt, fdt->dt_size,
 				fdt->dt_size * 2);
 		if (!fdt->dt)
@@ -385,6 +473,61 @@ static inline int dt_add_string(struct fdt *fdt, const char *str)
 	return ret;
 }
 
+static uint32_t fdt_skip_nops(const struct of_fdt_source *src, uint32_t ofs)
+{
+	while (be32_to_cpup(src->fdt + ofs) == FDT_NOP)
+		ofs += FDT_TAGSIZE;
+
+	return ofs;
+}
+
+/*
+ * Check whether @node and everything below it are unchanged since the tree
+ * was unflattened from @src, starting at offset @ofs in the blob. Property
+ * values which are still unmodified point into the blob, so this is mostly
+ * pointer comparisons. Returns the offset behind the node or 0 if it
+ * differs from the blob.
+ */
+static uint32_t fdt_subtree_match(const struct of_fdt_source *src,
+				  const struct device_node *node, uint32_t ofs)
+{
+	const struct fdt_node_header *fnh = src->fdt + ofs;
+	const struct fdt_property *fp;
+	const char *strings = src->fdt + src->f.off_dt_strings;
+	struct property *p;
+	struct device_node *n;
+
+	if (node->fdt_node != fnh || strcmp(fnh->name, node->name))
+		return 0;
+
+	ofs = dt_next_ofs(ofs, sizeof(*fnh) + strlen(fnh->name) + 1);
+
+	list_for_each_entry(p, &node->properties, list) {
+		ofs = fdt_skip_nops(src, ofs);
+		fp = src->fdt + ofs;
+
+		if (be32_to_cpu(fp->tag) != FDT_PROP ||
+		    p->value || p->value_const != fp->data ||
+		    p->length != be32_to_cpu(fp->len) ||
+		    strcmp(p->name, strings + be32_to_cpu(fp->nameoff)))
+			return 0;
+
+		ofs = dt_next_ofs(ofs, sizeof(*fp) + p->length);
+	}
+
+	list_for_each_entry(n, &node->children, parent_list) {
+		ofs = fdt_subtree_match(src, n, fdt_skip_nops(src, ofs));
+		if (!ofs)
+			return 0;
+	}
+
+	ofs = fdt_skip_nops(src, ofs);
+	if (be32_to_cpup(src->fdt + ofs) != FDT_END_NODE)
+		return 0;
+
+	return ofs + FDT_TAGSIZE;
+}
+
 static int __of_flatten_dtb(struct fdt *fdt, struct device_node *node, int is_root)
 {
 	struct property *p;
@@ -396,6 +539,27 @@ static int __of_flatten_dtb(struct fdt *fdt, struct device_node *node, int is_ro
 	if (fdt_ensure_space(fdt, 0) < 0)
 		return -ENOMEM;
 
+	if (fdt->src && node->fdt_node && !is_root) {
+		uint32_t start = node->fdt_node - fdt->src->fdt;
+		uint32_t end = 0;
+
+		if (start >= fdt->src->f.off_dt_struct &&
+		    start < fdt->src->f.off_dt_struct + fdt->src->f.size_dt_struct)
+			end = fdt_subtree_match(fdt->src, node, start);
+
+		if (end) {
+			len = end - start;
+			if (fdt_ensure_space(fdt, len) < 0)
+				return -ENOMEM;
+
+			/* nameoffs stay valid, the strings block starts with the old one */
+			memcpy(fdt->dt + fdt->dt_nextofs, node->fdt_node, len);
+			fdt->dt_nextofs += len;
+
+			return 0;
+		}
+	}
+
 	nh = fdt->dt + fdt->dt_nextofs;
 	nh->tag = cpu_to_fdt32(FDT_BEGIN_NODE);
 	len = lstrcpy(nh->name, node->name);
@@ -412,7 +576,7 @@ static int __of_flatten_dtb(struct fdt *fdt, struct device_node *node, int is_ro
 		fp->tag = cpu_to_fdt32(FDT_PROP);
 		fp->len = cpu_to_fdt32(p->length);
 		fp->nameoff = cpu_to_fdt32(dt_add_string(fdt, p->name));
-		memcpy(fp->data, p->value, p->length);
+		memcpy(fp->data, of_property_get_value(p), p->length);
 		fdt->dt_nextofs = dt_next_ofs(fdt->dt_nextofs,
 				sizeof(struct fdt_property) + p->length);
 	}
@@ -458,8 +622,20 @@ void *of_flatten_dtb(struct device_node *node)
 	fdt.dt = xmemalign(SZ_64K, SZ_64K);
 	fdt.dt_size = SZ_64K;
 
-	fdt.strings = xzalloc(SZ_64K);
-	fdt.str_size = SZ_64K;
+	fdt.src = of_fdt_find_source(node);
+	if (fdt.src) {
+		uint32_t size = fdt.src->f.size_dt_strings;
+
+		/* keep the old strings so unmodified subtrees can be copied as is */
+		fdt.str_size = max_t(uint32_t, SZ_64K,
+				     roundup_pow_of_two(size + 1024));
+		fdt.strings = xzalloc(fdt.str_size);
+		memcpy(fdt.strings, fdt.src->fdt + fdt.src->f.off_dt_strings, size);
+		fdt.str_nextofs = size;
+	} else {
+		fdt.strings = xzalloc(SZ_64K);
+		fdt.str_size = SZ_64K;
+	}
 
 	memset(fdt.dt, 0, SZ_64K);
 
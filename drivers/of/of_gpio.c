@@ -77,6 +77,7 @@ int of_get_named_gpio_flags(struct device_node *np, const char *propname,
 	if (!dev) {
 		pr_debug("%s: unable to find device of node %s\n",
 			 __func__, out_args.np->full_name);
+		device_probe_wait_for(out_args.np);
 		return -EPROBE_DEFER;
 	}
 
@@ -72,8 +72,9 @@ static int of_get_mac_addr(struct device_node *np, const char *name, u8 *addr)
 {
 	struct property *pp = of_find_property(np, name, NULL);
 
-	if (pp && pp->length == ETH_ALEN && is_valid_ether_addr(pp->value)) {
-		memcpy(addr, pp->value, ETH_ALEN);
+	if (pp && pp->length == ETH_ALEN &&
+	    is_valid_ether_addr(of_property_get_value(pp))) {
+		memcpy(addr, of_property_get_value(pp), ETH_ALEN);
 		return 0;
 	}
 	return -ENODEV;
@@ -484,6 +484,8 @@ int of_device_ensure_probed(struct device_node *np)
 {
 	struct device *dev;
 
+	device_probe_join_node(np);
+
 	if (!deep_probe_is_supported())
 		return 0;
 
@@ -495,6 +497,8 @@ int of_device_ensure_probed(struct device_node *np)
 		panic("deep-probe: device for '%s' couldn't be created\n",
 			 np->full_name);
 
+	device_probe_join(dev);
+
 	/*
 	 * The deep-probe mechanism relies on the fact that all necessary
 	 * drivers are added before the device creation. Furthermore deep-probe
@@ -248,6 +248,8 @@ static struct phy_provider *of_phy_provider_lookup(struct device_node *node)
 				return phy_provider;
 	}
 
+	device_probe_wait_for(node);
+
 	return ERR_PTR(-EPROBE_DEFER);
 }
 
@@ -317,6 +317,7 @@ static struct regulator_internal *of_regulator_get(struct device *dev,
 	 * added in future initcalls, so, instead of reporting a
 	 * complete failure report probe deferral
 	 */
+	device_probe_wait_for(node);
 	ri = ERR_PTR(-EPROBE_DEFER);
 out:
 	free(propname);
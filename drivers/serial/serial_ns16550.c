@@ -35,6 +35,7 @@ struct ns16550_priv {
 	struct NS16550_plat plat;
 	struct clk *clk;
 	uint32_t fcrval;
+	u32 fifo_size;
 	void __iomem *mmiobase;
 	unsigned iobase;
 	void (*write_reg)(struct ns16550_priv *, uint8_t val, unsigned offset);
@@ -270,6 +271,39 @@ static void ns16550_putc(struct console_device *cdev, char c)
 	ns16550_write(cdev, c, thr);
 }
 
+/**
+ * @brief Put a character to the transmit FIFO without waiting
+ *
+ * Only called for as many characters as ns16550_tx_room() reported.
+ *
+ * @param[in] cdev pointer to console device
+ * @param[in] c character to put
+ */
+static void ns16550_tx_putc(struct console_device *cdev, char c)
+{
+	ns16550_write(cdev, c, thr);
+}
+
+/**
+ * @brief Number of characters that can be sent without waiting
+ *
+ * THRE is set once the transmit FIFO is empty, so it can take a full
+ * FIFO worth of characters then.
+ *
+ * @param[in] cdev pointer to console device
+ *
+ * @return free space in the transmit FIFO
+ */
+static int ns16550_tx_room(struct console_device *cdev)
+{
+	struct ns16550_priv *priv = to_ns16550_priv(cdev);
+
+	if ((ns16550_read(cdev, lsr) & LSR_THRE) == 0)
+		return 0;
+
+	return priv->fifo_size;
+}
+
 /**
  * @brief Retrieve a character from serial port
  *
@@ -321,6 +355,7 @@ static void ns16550_probe_dt(struct device *dev, struct ns16550_priv *priv)
 		priv->mmiobase += offset;
 	of_property_read_u32(np, "reg-shift", &priv->plat.shift);
 	of_property_read_u32(np, "reg-io-width", &width);
+	of_property_read_u32(np, "fifo-size", &priv->fifo_size);
 
 	switch (width) {
 	case 1:
@@ -522,6 +557,13 @@ static int ns16550_probe(struct device *dev)
 
 	devtype->init_port(cdev);
 
+	if (!(priv->fcrval & FCR_FIFO_EN))
+		priv->fifo_size = 1;
+	else if (!priv->fifo_size)
+		priv->fifo_size = 16;
+	cdev->tx_room = ns16550_tx_room;
+	cdev->tx_putc = ns16550_tx_putc;
+
 	ret = console_register(cdev);
 	if (ret)
 		goto clk_disable;
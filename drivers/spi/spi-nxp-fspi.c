@@ -864,6 +864,66 @@ static int nxp_fspi_adjust_op_size(struct spi_mem *mem, struct spi_mem_op *op)
 	return 0;
 }
 
+static int nxp_fspi_dirmap_create(struct spi_mem_dirmap_desc *desc)
+{
+	struct nxp_fspi *f = spi_controller_get_devdata(desc->mem->spi->master);
+
+	if (desc->info.op_tmpl.data.dir != SPI_MEM_DATA_IN)
+		return -ENOTSUPP;
+
+	/* Reads via AHB bus may be corrupted due to an errata */
+	if (needs_ip_only(f))
+		return -ENOTSUPP;
+
+	if (desc->info.offset + desc->info.length > f->memmap_phy_size)
+		return -ENOTSUPP;
+
+	if (!nxp_fspi_supports_op(desc->mem, &desc->info.op_tmpl))
+		return -ENOTSUPP;
+
+	return 0;
+}
+
+static ssize_t nxp_fspi_dirmap_read(struct spi_mem_dirmap_desc *desc,
+				    u64 offs, size_t len, void *buf)
+{
+	struct nxp_fspi *f = spi_controller_get_devdata(desc->mem->spi->master);
+	struct spi_mem_op op = desc->info.op_tmpl;
+	int err;
+
+	if (offs >= desc->info.length)
+		return 0;
+
+	len = min_t(u64, len, desc->info.length - offs);
+
+	mutex_lock(&f->lock);
+
+	/* Wait for controller being ready. */
+	err = fspi_readl_poll_tout(f, f->iobase + FSPI_STS0,
+				   FSPI_STS0_ARB_IDLE, 1, POLL_TOUT, true);
+	WARN_ON(err);
+
+	nxp_fspi_select_mem(f, desc->mem->spi);
+
+	op.data.nbytes = len;
+	nxp_fspi_prepare_lut(f, &op);
+
+	/*
+	 * The whole flash is mapped into the AHB window, so copy out the
+	 * complete request in one go and let the controller prefetch ahead
+	 * instead of setting up the LUT for every AHB buffer sized chunk.
+	 */
+	memcpy_fromio(buf, f->ahb_addr + desc->info.offset + offs -
+		      f->memmap_start, len);
+
+	/* Invalidate the data in the AHB buffer. */
+	nxp_fspi_invalid(f);
+
+	mutex_unlock(&f->lock);
+
+	return len;
+}
+
 static int nxp_fspi_setup(struct spi_device *spi)
 {
 	struct nxp_fspi *f = container_of(spi->controller, struct nxp_fspi, ctlr);
@@ -960,6 +1020,8 @@ static const struct spi_controller_mem_ops nxp_fspi_mem_ops = {
 	.supports_op = nxp_fspi_supports_op,
 	.exec_op = nxp_fspi_exec_op,
 	.get_name = nxp_fspi_get_name,
+	.dirmap_create = nxp_fspi_dirmap_create,
+	.dirmap_read = nxp_fspi_dirmap_read,
 };
 
 static int nxp_fspi_probe(struct device *dev)
@@ -96,6 +96,7 @@ int usb_register_host(struct usb_host *host)
 	slice_init(&host->slice, dev_name(host->hw_dev));
 	if (!host->hw_dev->detect)
 		host->hw_dev->detect = usb_hw_detect;
+	host->hw_dev->detect_parallel = true;
 	return 0;
 }
 
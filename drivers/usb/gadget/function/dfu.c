@@ -116,7 +116,12 @@ enum dfu_state {
 #define USB_DT_DFU_SIZE			9
 #define USB_DT_DFU			0x21
 
-#define CONFIG_USBD_DFU_XFER_SIZE     4096
+#define DFU_XFER_SIZE		CONFIG_USB_GADGET_DFU_XFER_SIZE
+#define DFU_NUM_BUFS		CONFIG_USB_GADGET_DFU_BUFS
+/* erase this much at once on MTD targets, not every block on its own */
+#define DFU_ERASE_AHEAD		(DFU_XFER_SIZE * DFU_NUM_BUFS)
+/* bwPollTimeout while all buffers wait to be written */
+#define DFU_BUSY_POLL_MS	2
 #define DFU_TEMPFILE "/dfu_temp"
 
 struct file_list_entry *dfu_file_entry;
@@ -134,7 +139,7 @@ static struct usb_dfu_func_descriptor usb_dfu_func = {
 	.bDescriptorType	= USB_DT_DFU,
 	.bmAttributes		= USB_DFU_CAN_UPLOAD | USB_DFU_CAN_DOWNLOAD | USB_DFU_MANIFEST_TOL,
 	.wDetachTimeOut		= 0xff00,
-	.wTransferSize		= CONFIG_USBD_DFU_XFER_SIZE,
+	.wTransferSize		= DFU_XFER_SIZE,
 	.bcdDFUVersion		= 0x0100,
 };
 
@@ -146,6 +151,15 @@ struct f_dfu {
 	u8	dfu_status;
 	struct usb_request		*dnreq;
 	struct work_queue wq;
+
+	/*
+	 * dnreq receives into dnbuf[dn_head]. Received blocks are handed
+	 * to the workqueue as they are, dn_pending of them are not yet
+	 * written.
+	 */
+	void				*dnbuf[DFU_NUM_BUFS];
+	unsigned int			dn_head;
+	unsigned int			dn_pending;
 };
 
 static inline struct f_dfu *func_to_dfu(struct usb_function *f)
@@ -175,9 +189,20 @@ struct dfu_work {
 	void (*task)(struct dfu_work *dw);
 	size_t len;
 	uint8_t *rbuf;
-	uint8_t wbuf[CONFIG_USBD_DFU_XFER_SIZE];
+	uint8_t *wbuf;
 };
 
+static void dfu_do_write(struct dfu_work *dw);
+
+static void dfu_work_free(struct dfu_work *dw)
+{
+	/* the block's buffer can receive again */
+	if (dw->task == dfu_do_write)
+		dw->dfu->dn_pending--;
+
+	free(dw);
+}
+
 static void dfu_do_work(struct work_struct *w)
 {
 	struct dfu_work *dw = container_of(w, struct dfu_work, work);
@@ -188,14 +213,14 @@ static void dfu_do_work(struct work_struct *w)
 	else
 		pr_debug("skip work\n");
 
-	free(dw);
+	dfu_work_free(dw);
 }
 
 static void dfu_work_cancel(struct work_struct *w)
 {
 	struct dfu_work *dw = container_of(w, struct dfu_work, work);
 
-	free(dw);
+	dfu_work_free(dw);
 }
 
 static void dfu_do_write(struct dfu_work *dw)
@@ -207,7 +232,11 @@ static void dfu_do_write(struct dfu_work *dw)
 	pr_debug("do write\n");
 
 	if (prog_erase && (dfu_written + wlen) > dfu_erased) {
-		size = roundup(wlen, dfu_mtdinfo.erasesize);
+		size = max_t(ssize_t, wlen, DFU_ERASE_AHEAD);
+		size = roundup(size, dfu_mtdinfo.erasesize);
+		if (dfu_erased + size > dfu_mtdinfo.size)
+			size = max_t(loff_t, dfu_mtdinfo.size - dfu_erased,
+				     roundup(wlen, dfu_mtdinfo.erasesize));
 		ret = erase(dfufd, size, dfu_erased);
 		dfu_erased += size;
 		if (ret && ret != -ENOSYS) {
@@ -392,7 +421,11 @@ dfu_bind(struct usb_configuration *c, struct usb_function *f)
 		status = -ENOMEM;
 		goto out;
 	}
-	dfu->dnreq->buf = dma_alloc(CONFIG_USBD_DFU_XFER_SIZE);
+	for (i = 0; i < DFU_NUM_BUFS; i++)
+		dfu->dnbuf[i] = dma_alloc(DFU_XFER_SIZE);
+	dfu->dn_head = 0;
+	dfu->dn_pending = 0;
+	dfu->dnreq->buf = dfu->dnbuf[0];
 	dfu->dnreq->complete = dn_complete;
 	dfu->dnreq->zero = 0;
 
@@ -455,6 +488,7 @@ static void
 dfu_unbind(struct usb_configuration *c, struct usb_function *f)
 {
 	struct f_dfu		*dfu = func_to_dfu(f);
+	int i;
 
 	dfu_files = NULL;
 	dfu_file_entry = NULL;
@@ -464,7 +498,8 @@ dfu_unbind(struct usb_configuration *c, struct usb_function *f)
 
 	usb_free_all_descriptors(f);
 
-	dma_free(dfu->dnreq->buf);
+	for (i = 0; i < DFU_NUM_BUFS; i++)
+		dma_free(dfu->dnbuf[i]);
 	usb_ep_free_request(c->cdev->gadget->ep0, dfu->dnreq);
 }
 
@@ -491,11 +526,18 @@ static int dfu_status(struct usb_function *f, const struct usb_ctrlrequest *ctrl
 	struct usb_composite_dev *cdev = f->config->cdev;
 	struct usb_request	*req = cdev->req;
 	struct dfu_status *dstat = (struct dfu_status *) req->buf;
+	u8 poll = 10;
+
+	/* let the host send the next block right away while a buffer is free */
+	if (dfu->dfu_state == DFU_STATE_dfuDNLOAD_IDLE)
+		poll = 0;
+	else if (dfu->dfu_state == DFU_STATE_dfuDNBUSY)
+		poll = DFU_BUSY_POLL_MS;
 
 	dstat->bStatus = dfu->dfu_status;
 	dstat->bState  = dfu->dfu_state;
 	dstat->iString = 0;
-	dstat->bwPollTimeout[0] = 10;
+	dstat->bwPollTimeout[0] = poll;
 	dstat->bwPollTimeout[1] = 0;
 	dstat->bwPollTimeout[2] = 0;
 
@@ -530,9 +572,14 @@ static void dn_complete(struct usb_ep *ep, struct usb_request *req)
 	dw = xzalloc(sizeof(*dw));
 	dw->dfu = dfu;
 	dw->task = dfu_do_write;
-	dw->len = min_t(unsigned int, req->length, CONFIG_USBD_DFU_XFER_SIZE);
-	memcpy(dw->wbuf, req->buf, dw->len);
+	dw->len = min_t(unsigned int, req->length, DFU_XFER_SIZE);
+	dw->wbuf = req->buf;
+	dfu->dn_pending++;
 	wq_queue_work(&dfu->wq, &dw->work);
+
+	/* receive the next block into the next buffer, no need to copy */
+	dfu->dn_head = (dfu->dn_head + 1) % DFU_NUM_BUFS;
+	req->buf = dfu->dnbuf[dfu->dn_head];
 }
 
 static int handle_manifest(struct usb_function *f, const struct usb_ctrlrequest *ctrl)
@@ -567,6 +614,13 @@ static int handle_dnload(struct usb_function *f, const struct usb_ctrlrequest *c
 		return 0;
 	}
 
+	/* The host did not wait for dfuDNLOAD_IDLE */
+	if (w_length > DFU_XFER_SIZE || dfu->dn_pending == DFU_NUM_BUFS) {
+		dfu->dfu_state = DFU_STATE_dfuERROR;
+		dfu->dfu_status = DFU_STATUS_errSTALLEDPKT;
+		return -EINVAL;
+	}
+
 	dfu->dnreq->length = w_length;
 	dfu->dnreq->context = dfu;
 	usb_ep_queue(cdev->gadget->ep0, dfu->dnreq);
@@ -587,7 +641,7 @@ static int handle_upload(struct usb_function *f, const struct usb_ctrlrequest *c
 	dw = xzalloc(sizeof(*dw));
 	dw->dfu = dfu;
 	dw->task = dfu_do_read;
-	dw->len = w_length;
+	dw->len = min_t(u16, w_length, DFU_XFER_SIZE);
 	dw->rbuf = dfu->dnreq->buf;
 	wq_queue_work(&dfu->wq, &dw->work);
 
@@ -636,12 +690,19 @@ static int dfu_setup(struct usb_function *f, const struct usb_ctrlrequest *ctrl)
 				goto out;
 			}
 			pr_debug("starting download to %s\n", dfu_file_entry->filename);
+			value = handle_dnload(f, ctrl);
+			if (value < 0)
+				goto out;
+
+			/*
+			 * The block is written by dn_complete() once its data
+			 * stage is done, so the open still goes first.
+			 */
 			dw = xzalloc(sizeof(*dw));
 			dw->dfu = dfu;
 			dw->task = dfu_do_open_dnload;
 			wq_queue_work(&dfu->wq, &dw->work);
 
-			value = handle_dnload(f, ctrl);
 			dfu->dfu_state = DFU_STATE_dfuDNLOAD_IDLE;
 			return 0;
 		case USB_REQ_DFU_UPLOAD:
@@ -676,6 +737,8 @@ static int dfu_setup(struct usb_function *f, const struct usb_ctrlrequest *ctrl)
 	case DFU_STATE_dfuDNLOAD_IDLE:
 		switch (ctrl->bRequest) {
 		case USB_REQ_DFU_GETSTATUS:
+			if (dfu->dn_pending == DFU_NUM_BUFS)
+				dfu->dfu_state = DFU_STATE_dfuDNBUSY;
 			value = dfu_status(f, ctrl);
 			value = min(value, w_length);
 			break;
@@ -778,8 +841,26 @@ static int dfu_setup(struct usb_function *f, const struct usb_ctrlrequest *ctrl)
 			break;
 		}
 		break;
-	case DFU_STATE_dfuDNLOAD_SYNC:
 	case DFU_STATE_dfuDNBUSY:
+		switch (ctrl->bRequest) {
+		case USB_REQ_DFU_GETSTATUS:
+			/* the workqueue has written a block in the meantime */
+			if (dfu->dn_pending < DFU_NUM_BUFS)
+				dfu->dfu_state = DFU_STATE_dfuDNLOAD_IDLE;
+			value = dfu_status(f, ctrl);
+			value = min(value, w_length);
+			break;
+		case USB_REQ_DFU_GETSTATE:
+			*(u8 *)req->buf = dfu->dfu_state;
+			value = sizeof(u8);
+			break;
+		default:
+			dfu->dfu_state = DFU_STATE_dfuERROR;
+			value = -EINVAL;
+			break;
+		}
+		break;
+	case DFU_STATE_dfuDNLOAD_SYNC:
 		dfu->dfu_state = DFU_STATE_dfuERROR;
 		value = -EINVAL;
 		break;
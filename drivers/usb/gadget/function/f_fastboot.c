@@ -32,6 +32,8 @@
 #define FASTBOOT_INTERFACE_PROTOCOL	0x03
 
 #define EP_BUFFER_SIZE			4096
+#define DL_NUM_REQS			CONFIG_USB_GADGET_FASTBOOT_DL_REQS
+#define DL_REQ_SIZE			CONFIG_USB_GADGET_FASTBOOT_DL_REQ_SIZE
 
 struct f_fastboot {
 	struct fastboot fastboot;
@@ -41,6 +43,17 @@ struct f_fastboot {
 	struct usb_ep *in_ep, *out_ep;
 	struct usb_request *out_req;
 	struct work_queue wq;
+
+	/*
+	 * Download requests, all queued at once. They receive straight into
+	 * the download file when it can be mapped, otherwise into the bounce
+	 * buffers in dl_buf.
+	 */
+	struct usb_request *dl_req[DL_NUM_REQS];
+	void *dl_buf[DL_NUM_REQS];
+	/* bytes of the current download handed to the UDC */
+	size_t dl_queued;
+	bool downloading;
 };
 
 static inline struct f_fastboot *func_to_fastboot(struct usb_function *f)
@@ -163,6 +176,7 @@ static void rx_handler_command(struct usb_ep *ep, struct usb_request *req);
 static int fastboot_write_usb(struct fastboot *fb, const char *buffer,
 			      unsigned int buffer_size);
 static void fastboot_start_download_usb(struct fastboot *fb);
+static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req);
 
 struct fastboot_work {
 	struct work_struct work;
@@ -170,6 +184,18 @@ struct fastboot_work {
 	char command[FASTBOOT_MAX_CMD_LEN + 1];
 };
 
+static int fastboot_queue_command(struct f_fastboot *f_fb)
+{
+	struct usb_request *req = f_fb->out_req;
+
+	req->complete = rx_handler_command;
+	req->length = EP_BUFFER_SIZE;
+	req->actual = 0;
+	memset(req->buf, 0, EP_BUFFER_SIZE);
+
+	return usb_ep_queue(f_fb->out_ep, req);
+}
+
 static void fastboot_do_work(struct work_struct *w)
 {
 	struct fastboot_work *fw = container_of(w, struct fastboot_work, work);
@@ -177,8 +203,9 @@ static void fastboot_do_work(struct work_struct *w)
 
 	fastboot_exec_cmd(&f_fb->fastboot, fw->command);
 
-	memset(f_fb->out_req->buf, 0, EP_BUFFER_SIZE);
-	usb_ep_queue(f_fb->out_ep, f_fb->out_req);
+	/* otherwise requeued once the download is complete */
+	if (!f_fb->downloading)
+		fastboot_queue_command(f_fb);
 
 	free(fw);
 }
@@ -220,6 +247,39 @@ static void fastboot_complete(struct usb_ep *ep, struct usb_request *req)
 	fastboot_free_request(ep, req);
 }
 
+static void fastboot_free_dl_reqs(struct f_fastboot *f_fb)
+{
+	int i;
+
+	for (i = 0; i < DL_NUM_REQS; i++) {
+		if (f_fb->dl_req[i])
+			usb_ep_free_request(f_fb->out_ep, f_fb->dl_req[i]);
+		free(f_fb->dl_buf[i]);
+		f_fb->dl_req[i] = NULL;
+		f_fb->dl_buf[i] = NULL;
+	}
+}
+
+static int fastboot_alloc_dl_reqs(struct f_fastboot *f_fb)
+{
+	struct usb_request *req;
+	int i;
+
+	for (i = 0; i < DL_NUM_REQS; i++) {
+		req = usb_ep_alloc_request(f_fb->out_ep);
+		if (!req) {
+			fastboot_free_dl_reqs(f_fb);
+			return -ENOMEM;
+		}
+
+		req->complete = rx_handler_dl_image;
+		req->context = f_fb;
+		f_fb->dl_req[i] = req;
+	}
+
+	return 0;
+}
+
 static int fastboot_bind(struct usb_configuration *c, struct usb_function *f)
 {
 	struct usb_composite_dev *cdev = c->cdev;
@@ -298,12 +358,18 @@ static int fastboot_bind(struct usb_configuration *c, struct usb_function *f)
 	f_fb->out_req->complete = rx_handler_command;
 	f_fb->out_req->context = f_fb;
 
-	ret = usb_assign_descriptors(f, fb_fs_descs, fb_hs_descs, fb_ss_descs, fb_ss_descs);
+	ret = fastboot_alloc_dl_reqs(f_fb);
 	if (ret)
 		goto err_free_in_req;
 
+	ret = usb_assign_descriptors(f, fb_fs_descs, fb_hs_descs, fb_ss_descs, fb_ss_descs);
+	if (ret)
+		goto err_free_dl_reqs;
+
 	return 0;
 
+err_free_dl_reqs:
+	fastboot_free_dl_reqs(f_fb);
 err_free_in_req:
 	free(f_fb->out_req->buf);
 	usb_ep_free_request(f_fb->out_ep, f_fb->out_req);
@@ -319,6 +385,8 @@ static void fastboot_unbind(struct usb_configuration *c, struct usb_function *f)
 {
 	struct f_fastboot *f_fb = func_to_fastboot(f);
 
+	fastboot_free_dl_reqs(f_fb);
+
 	free(f_fb->out_req->buf);
 	usb_ep_free_request(f_fb->out_ep, f_fb->out_req);
 	f_fb->out_req = NULL;
@@ -367,8 +435,9 @@ static int fastboot_set_alt(struct usb_function *f,
 		return ret;
 	}
 
-	memset(f_fb->out_req->buf, 0, EP_BUFFER_SIZE);
-	ret = usb_ep_queue(f_fb->out_ep, f_fb->out_req);
+	f_fb->downloading = false;
+
+	ret = fastboot_queue_command(f_fb);
 	if (ret)
 		goto err;
 
@@ -446,58 +515,162 @@ static int fastboot_write_usb(struct fastboot *fb, const char *buffer, unsigned
 	return 0;
 }
 
-static int rx_bytes_expected(struct f_fastboot *f_fb)
+/*
+ * Hand the next piece of the download to the UDC. A mapped download file
+ * is received into in place, except for a trailing partial packet which
+ * would overrun it. That one goes to the command request and is copied.
+ */
+static int fastboot_dl_queue(struct f_fastboot *f_fb, struct usb_request *req)
+{
+	struct fastboot *fb = &f_fb->fastboot;
+	unsigned int maxpacket = f_fb->out_ep->maxpacket;
+	size_t remaining = fb->download_size - f_fb->dl_queued;
+	unsigned int len;
+	int ret;
+
+	if (!remaining)
+		return 0;
+
+	len = min_t(size_t, remaining, DL_REQ_SIZE);
+
+	if (!fb->download_buf) {
+		len = ALIGN(len, maxpacket);
+	} else if (len >= maxpacket) {
+		req->buf = fb->download_buf + f_fb->dl_queued;
+		len = ALIGN_DOWN(len, maxpacket);
+	} else {
+		req = f_fb->out_req;
+		req->complete = rx_handler_dl_image;
+		len = maxpacket;
+	}
+
+	req->length = len;
+	req->actual = 0;
+
+	ret = usb_ep_queue(f_fb->out_ep, req);
+	if (ret)
+		return ret;
+
+	f_fb->dl_queued += min_t(size_t, len, remaining);
+
+	return 0;
+}
+
+static void fastboot_dl_cancel(struct f_fastboot *f_fb)
 {
-	int remaining = f_fb->fastboot.download_size
-		      - f_fb->fastboot.download_bytes;
+	int i;
+
+	f_fb->downloading = false;
 
-	if (remaining >= EP_BUFFER_SIZE)
-		return EP_BUFFER_SIZE;
+	for (i = 0; i < DL_NUM_REQS; i++)
+		usb_ep_dequeue(f_fb->out_ep, f_fb->dl_req[i]);
 
-	return ALIGN(remaining, f_fb->out_ep->maxpacket);
+	if (f_fb->out_req->complete == rx_handler_dl_image)
+		usb_ep_dequeue(f_fb->out_ep, f_fb->out_req);
+
+	/* only now, requests received in place may point into the file */
+	fastboot_download_cancel(&f_fb->fastboot);
 }
 
 static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 {
 	struct f_fastboot *f_fb = req->context;
-	const unsigned char *buffer = req->buf;
+	struct fastboot *fb = &f_fb->fastboot;
+	unsigned int len;
 	int ret;
 
 	if (req->status != 0) {
-		pr_err("Bad status: %d\n", req->status);
+		/* dequeued by fastboot_dl_cancel() */
+		if (req->status != -ECONNRESET)
+			pr_err("Bad status: %d\n", req->status);
 		return;
 	}
 
-	ret = fastboot_handle_download_data(&f_fb->fastboot, buffer,
-					    req->actual);
-	if (ret < 0) {
-		fastboot_tx_print(&f_fb->fastboot, FASTBOOT_MSG_FAIL,
-				  strerror(-ret));
-		return;
+	len = min_t(size_t, req->actual, fb->download_size - fb->download_bytes);
+
+	if (fb->download_buf && req != f_fb->out_req) {
+		/* already in place */
+		fastboot_download_advance(fb, len);
+	} else {
+		ret = fastboot_handle_download_data(fb, req->buf, len);
+		if (ret < 0) {
+			fastboot_tx_print(fb, FASTBOOT_MSG_FAIL, strerror(-ret));
+			goto cancel;
+		}
 	}
 
-	req->length = rx_bytes_expected(f_fb);
-
 	/* Check if transfer is done */
-	if (f_fb->fastboot.download_bytes >= f_fb->fastboot.download_size) {
-		req->complete = rx_handler_command;
-		req->length = EP_BUFFER_SIZE;
+	if (fb->download_bytes >= fb->download_size) {
+		f_fb->downloading = false;
+		fastboot_download_finished(fb);
+		fastboot_queue_command(f_fb);
+		return;
+	}
 
-		fastboot_download_finished(&f_fb->fastboot);
+	/*
+	 * When receiving in place, the requests behind this one expect the
+	 * data at a later offset. Bounce buffers are written in order anyway,
+	 * but the bytes this request didn't get have to be queued again. If
+	 * nothing was queued behind it, it was accounted only up to the end of
+	 * the download.
+	 */
+	if (req->actual < req->length) {
+		size_t missing = req->length - req->actual;
+
+		if (fb->download_buf) {
+			fastboot_tx_print(fb, FASTBOOT_MSG_FAIL, "short transfer");
+			goto cancel;
+		}
+
+		if (f_fb->dl_queued - fb->download_bytes > missing)
+			f_fb->dl_queued -= missing;
+		else
+			f_fb->dl_queued = fb->download_bytes;
 	}
 
-	req->actual = 0;
-	usb_ep_queue(ep, req);
+	ret = fastboot_dl_queue(f_fb, req);
+	if (ret) {
+		fastboot_tx_print(fb, FASTBOOT_MSG_FAIL, strerror(-ret));
+		goto cancel;
+	}
+
+	return;
+
+cancel:
+	fastboot_dl_cancel(f_fb);
+	fastboot_queue_command(f_fb);
 }
 
 static void fastboot_start_download_usb(struct fastboot *fb)
 {
 	struct f_fastboot *f_fb = container_of(fb, struct f_fastboot, fastboot);
-	struct usb_request *req = f_fb->out_req;
+	int i, ret;
+
+	f_fb->dl_queued = 0;
+	f_fb->downloading = true;
+
+	for (i = 0; i < DL_NUM_REQS; i++) {
+		if (!fb->download_buf && !f_fb->dl_buf[i]) {
+			f_fb->dl_buf[i] = dma_alloc(DL_REQ_SIZE);
+			if (!f_fb->dl_buf[i]) {
+				ret = -ENOMEM;
+				goto err;
+			}
+		}
+
+		f_fb->dl_req[i]->buf = f_fb->dl_buf[i];
+
+		ret = fastboot_dl_queue(f_fb, f_fb->dl_req[i]);
+		if (ret)
+			goto err;
+	}
 
-	req->complete = rx_handler_dl_image;
-	req->length = rx_bytes_expected(f_fb);
 	fastboot_start_download_generic(fb);
+
+	return;
+err:
+	fastboot_dl_cancel(f_fb);
+	fastboot_tx_print(fb, FASTBOOT_MSG_FAIL, strerror(-ret));
 }
 
 static void rx_handler_command(struct usb_ep *ep, struct usb_request *req)
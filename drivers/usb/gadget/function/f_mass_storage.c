@@ -216,6 +216,7 @@
 #include <linux/stat.h>
 #include <linux/wait.h>
 #include <fcntl.h>
+#include <fs.h>
 #include <file-list.h>
 #include <dma.h>
 #include <linux/bug.h>
@@ -280,6 +281,16 @@ struct fsg_common {
 	struct fsg_buffhd	*next_buffhd_to_drain;
 	struct fsg_buffhd	buffhds[FSG_NUM_BUFFERS];
 
+	/*
+	 * Sequential read-ahead: ra_len bytes at ra_offset of LUN ra_lun
+	 * are in ra_buf. ra_next is where the last read ended.
+	 */
+	void			*ra_buf;
+	unsigned int		ra_lun;
+	unsigned int		ra_len;
+	loff_t			ra_offset;
+	loff_t			ra_next;
+
 	struct f_ums_opts	*opts;
 
 	int			cmnd_size;
@@ -305,6 +316,7 @@ struct fsg_common {
 	unsigned int		short_packet_received:1;
 	unsigned int		bad_lun_okay:1;
 	unsigned int		running:1;
+	unsigned int		ra_sequential:1;
 
 	struct completion	thread_wakeup_needed;
 
@@ -685,6 +697,60 @@ static int sleep_thread(struct fsg_common *common)
 
 /*-------------------------------------------------------------------------*/
 
+/*
+ * Called before waiting for the next command, i.e. while the reply to a
+ * sequential read is still being transferred. Reads what the host will
+ * most likely ask for next.
+ */
+static void fsg_read_ahead(struct fsg_common *common)
+{
+	struct fsg_lun *curlun = &common->luns[common->ra_lun];
+	loff_t size = curlun->num_sectors << 9;
+	unsigned int amount;
+	ssize_t nread;
+
+	if (!common->ra_buf || !common->ra_sequential)
+		return;
+
+	common->ra_sequential = 0;
+
+	if (common->ra_next >= size)
+		return;
+
+	amount = min_t(loff_t, FSG_BUFLEN, size - common->ra_next);
+
+	nread = pread(ums[common->ra_lun].fd, common->ra_buf, amount,
+		      common->ra_next);
+	if (nread <= 0)
+		return;
+
+	common->ra_offset = common->ra_next;
+	common->ra_len = nread - (nread & 511);
+}
+
+/*
+ * Hand the read-ahead data over to @bh if it covers what is to be read
+ * next. Buffers are swapped, so nothing needs to be copied.
+ */
+static bool fsg_read_ahead_get(struct fsg_common *common,
+			       struct fsg_buffhd *bh, loff_t file_offset,
+			       unsigned int amount)
+{
+	void *buf = common->ra_buf;
+
+	if (!common->ra_len || common->ra_lun != common->lun ||
+	    common->ra_offset != file_offset || common->ra_len < amount)
+		return false;
+
+	common->ra_buf = bh->buf;
+	common->ra_len = 0;
+
+	bh->buf = buf;
+	bh->inreq->buf = bh->outreq->buf = buf;
+
+	return true;
+}
+
 static int do_read(struct fsg_common *common)
 {
 	struct fsg_lun		*curlun = &common->luns[common->lun];
@@ -723,6 +789,11 @@ static int do_read(struct fsg_common *common)
 	if (unlikely(amount_left == 0))
 		return -EIO;		/* No default reply */
 
+	/* Read ahead once the host continues where it left off */
+	common->ra_sequential = common->ra_lun == common->lun &&
+				common->ra_next == file_offset;
+	common->ra_lun = common->lun;
+
 	for (;;) {
 		/* Wait for the next buffer to become available */
 		bh = common->next_buffhd_to_fill;
@@ -759,7 +830,11 @@ static int do_read(struct fsg_common *common)
 		}
 
 		/* Perform the read */
-		nread = pread(ums[common->lun].fd, bh->buf, amount, file_offset);
+		if (fsg_read_ahead_get(common, bh, file_offset, amount))
+			nread = amount;
+		else
+			nread = pread(ums[common->lun].fd, bh->buf, amount,
+				      file_offset);
 
 		VLDBG(curlun, "file read %u @ %llu -> %zd\n", amount,
 				(unsigned long long) file_offset,
@@ -776,6 +851,7 @@ static int do_read(struct fsg_common *common)
 		file_offset  += nread;
 		amount_left  -= nread;
 		common->residue -= nread;
+		common->ra_next = file_offset;
 		bh->inreq->length = nread;
 		bh->state = BUF_STATE_FULL;
 
@@ -783,6 +859,7 @@ static int do_read(struct fsg_common *common)
 		if (nread < amount) {
 			curlun->sense_data = SS_UNRECOVERED_READ_ERROR;
 			curlun->info_valid = 1;
+			common->ra_sequential = 0;
 			break;
 		}
 
@@ -843,6 +920,12 @@ static int do_write(struct fsg_common *common)
 		return -EINVAL;
 	}
 
+	/* The read-ahead data may be overwritten */
+	if (common->ra_lun == common->lun) {
+		common->ra_len = 0;
+		common->ra_next = -1;
+	}
+
 	/* Carry out the file writes */
 	get_some_more = 1;
 	file_offset = usb_offset = ((loff_t) lba) << 9;
@@ -967,13 +1050,31 @@ static int do_write(struct fsg_common *common)
 			return rc;
 	}
 
+	/* FUA, write through the block layer's cache */
+	if (common->cmnd[0] != SCSI_WRITE6 && (common->cmnd[1] & 0x08) &&
+	    flush(ums[common->lun].fd)) {
+		curlun->sense_data = SS_WRITE_ERROR;
+		curlun->info_valid = 1;
+	}
+
 	return -EIO;		/* No default reply */
 }
 
 /*-------------------------------------------------------------------------*/
 
+/*
+ * Writes only go to the write-back cache of the block layer, which
+ * collects them into large chunks. Write these out now.
+ */
 static int do_synchronize_cache(struct fsg_common *common)
 {
+	struct fsg_lun	*curlun = &common->luns[common->lun];
+
+	if (flush(ums[common->lun].fd)) {
+		curlun->sense_data = SS_WRITE_ERROR;
+		return -EINVAL;
+	}
+
 	return 0;
 }
 
@@ -2089,6 +2190,9 @@ static int get_next_command(struct fsg_common *common)
 	struct fsg_buffhd	*bh;
 	int			rc = 0;
 
+	if (IS_ENABLED(CONFIG_USB_GADGET_MASS_STORAGE_READ_AHEAD))
+		fsg_read_ahead(common);
+
 	/* Wait for the next buffer to become available */
 	bh = common->next_buffhd_to_fill;
 	while (bh->state != BUF_STATE_EMPTY) {
@@ -2424,6 +2528,9 @@ static void fsg_main_thread(void *fsg_)
 		dma_free(bh->buf);
 	} while (++bh, --i);
 
+	dma_free(common->ra_buf);
+	common->ra_buf = NULL;
+
 	ums_count = 0;
 	ums_files = NULL;
 
@@ -2559,6 +2666,17 @@ static int fsg_common_init(struct fsg_common *common,
 	} while (--i);
 	bh->next = common->buffhds;
 
+	if (IS_ENABLED(CONFIG_USB_GADGET_MASS_STORAGE_READ_AHEAD)) {
+		common->ra_buf = dma_alloc(FSG_BUFLEN);
+		if (unlikely(!common->ra_buf)) {
+			rc = -ENOMEM;
+			goto error_release;
+		}
+	}
+	common->ra_len = 0;
+	common->ra_next = -1;
+	common->ra_sequential = 0;
+
 	snprintf(common->inquiry_string, sizeof common->inquiry_string,
 		 "%-8s%-16s%04x",
 		 "Linux   ",
@@ -51,8 +51,43 @@ struct fbc_priv {
 
 	int active;
 	int in_console;
+
+	/* area of the render buffer not yet blitted to the screen */
+	struct fb_rect dirty;
 };
 
+static void fbc_damage(struct fbc_priv *priv, int x, int y, int width,
+		       int height)
+{
+	struct fb_rect *d = &priv->dirty;
+
+	if (d->x2 <= d->x1) {
+		d->x1 = x;
+		d->y1 = y;
+		d->x2 = x + width;
+		d->y2 = y + height;
+		return;
+	}
+
+	d->x1 = min_t(u32, d->x1, x);
+	d->y1 = min_t(u32, d->y1, y);
+	d->x2 = max_t(u32, d->x2, x + width);
+	d->y2 = max_t(u32, d->y2, y + height);
+}
+
+static void fbc_flush(struct fbc_priv *priv)
+{
+	struct fb_rect *d = &priv->dirty;
+
+	if (d->x2 > d->x1)
+		gu_screen_blit_area(priv->sc, d->x1, d->y1, d->x2 - d->x1,
+				    d->y2 - d->y1);
+
+	memset(d, 0, sizeof(*d));
+
+	fb_flush(priv->fb);
+}
+
 static int fbc_getc(struct console_device *cdev)
 {
 	return 0;
@@ -84,8 +119,7 @@ static void cls(struct fbc_priv *priv)
 			adr += priv->fb->line_length;
 		}
 	}
-	gu_screen_blit_area(priv->sc, priv->margin.left, priv->margin.top,
-			    width, height);
+	fbc_damage(priv, priv->margin.left, priv->margin.top, width, height);
 }
 
 struct rgb {
@@ -158,6 +192,10 @@ static void drawchar(struct fbc_priv *priv, int x, int y, int c)
 			t <<= 1;
 		}
 	}
+
+	fbc_damage(priv, priv->margin.left + x * priv->font->width,
+		   priv->margin.top + y * priv->font->height,
+		   priv->font->width, priv->font->height);
 }
 
 static void video_invertchar(struct fbc_priv *priv, int x, int y)
@@ -169,9 +207,9 @@ static void video_invertchar(struct fbc_priv *priv, int x, int y)
 	gu_invert_area(priv->fb, buf, priv->margin.left + x * priv->font->width,
 			priv->margin.top + y * priv->font->height,
 			priv->font->width, priv->font->height);
-	gu_screen_blit_area(priv->sc, priv->margin.left + x * priv->font->width,
-			priv->margin.top + y * priv->font->height,
-			priv->font->width, priv->font->height);
+	fbc_damage(priv, priv->margin.left + x * priv->font->width,
+		   priv->margin.top + y * priv->font->height,
+		   priv->font->width, priv->font->height);
 }
 
 static void show_cursor(struct fbc_priv *priv, int x, int y)
@@ -180,6 +218,45 @@ static void show_cursor(struct fbc_priv *priv, int x, int y)
 		video_invertchar(priv, x, y);
 }
 
+/* Move the text area up by @lines lines and clear the lines at the bottom */
+static void fbc_scroll(struct fbc_priv *priv, unsigned int lines)
+{
+	void *buf;
+	void *adr;
+	u32 line_length = priv->fb->line_length;
+	int line_height = line_length * priv->font->height;
+	int width = priv->fb->xres - priv->margin.left - priv->margin.right;
+	int height = (priv->rows + 1) * priv->font->height;
+	int keep;
+
+	lines = min(lines, priv->rows + 1);
+	keep = height - lines * priv->font->height;
+
+	buf = gui_screen_render_buffer(priv->sc);
+	adr = buf + priv->margin.top * line_length;
+
+	if (!priv->margin.left && !priv->margin.right) {
+		memmove(adr, adr + line_height * lines, keep * line_length);
+		memset(adr + keep * line_length, 0, line_height * lines);
+	} else {
+		int bpp = priv->fb->bits_per_pixel >> 3;
+		int y;
+
+		adr += priv->margin.left * bpp;
+
+		for (y = 0; y < keep; y++) {
+			memcpy(adr, adr + line_height * lines, width * bpp);
+			adr += line_length;
+		}
+		for (y = keep; y < height; y++) {
+			memset(adr, 0, width * bpp);
+			adr += line_length;
+		}
+	}
+
+	fbc_damage(priv, priv->margin.left, priv->margin.top, width, height);
+}
+
 static void printchar(struct fbc_priv *priv, int c)
 {
 	video_invertchar(priv, priv->x, priv->y);
@@ -211,11 +288,6 @@ static void printchar(struct fbc_priv *priv, int c)
 	default:
 		drawchar(priv, priv->x, priv->y, c);
 
-		gu_screen_blit_area(priv->sc,
-				priv->margin.left + priv->x * priv->font->width,
-				priv->margin.top + priv->y * priv->font->height,
-				priv->font->width, priv->font->height);
-
 		priv->x++;
 		if (priv->x > priv->cols) {
 			priv->y++;
@@ -224,37 +296,7 @@ static void printchar(struct fbc_priv *priv, int c)
 	}
 
 	if (priv->y > priv->rows) {
-		void *buf;
-		void *adr;
-		u32 line_length = priv->fb->line_length;
-		int line_height = line_length * priv->font->height;
-		int width = priv->fb->xres - priv->margin.left - priv->margin.right;
-		int height = (priv->rows + 1) * priv->font->height;
-
-		buf = gui_screen_render_buffer(priv->sc);
-		adr = buf + priv->margin.top * line_length;
-
-		if (!priv->margin.left && !priv->margin.right) {
-			memcpy(adr, adr + line_height, line_height * priv->rows);
-			memset(adr + line_height * priv->rows, 0, line_height);
-		} else {
-			int bpp = priv->fb->bits_per_pixel >> 3;
-			int y;
-
-			adr += priv->margin.left * bpp;
-
-			for (y = 0; y < height - priv->font->height; y++) {
-				memcpy(adr, adr + line_height, width * bpp);
-				adr += line_length;
-			}
-			for (y = height - priv->font->height; y < height; y++) {
-				memset(adr, 0, width * bpp);
-				adr += line_length;
-			}
-		}
-
-		gu_screen_blit_area(priv->sc, priv->margin.left, priv->margin.top,
-				width, height);
+		fbc_scroll(priv, priv->y - priv->rows);
 		priv->y = priv->rows;
 	}
 
@@ -380,16 +422,8 @@ static void fbc_parse_csi(struct fbc_priv *priv)
 	}
 }
 
-static void fbc_putc(struct console_device *cdev, char c)
+static void fbc_output(struct fbc_priv *priv, char c)
 {
-	struct fbc_priv *priv = container_of(cdev,
-					struct fbc_priv, cdev);
-	struct fb_info *fb = priv->fb;
-
-	if (priv->in_console)
-		return;
-	priv->in_console = 1;
-
 	switch (priv->state) {
 	case LIT:
 		switch (c) {
@@ -442,9 +476,80 @@ static void fbc_putc(struct console_device *cdev, char c)
 		break;
 
 	}
+}
+
+static void fbc_putc(struct console_device *cdev, char c)
+{
+	struct fbc_priv *priv = container_of(cdev,
+					struct fbc_priv, cdev);
+
+	if (priv->in_console)
+		return;
+	priv->in_console = 1;
+
+	fbc_output(priv, c);
+
 	priv->in_console = 0;
 
-	fb_flush(fb);
+	fbc_flush(priv);
+}
+
+/*
+ * Scroll all lines a plain string will scroll out in one go instead of
+ * line by line. Strings with escape sequences or backspaces may move the
+ * cursor around, so they are scrolled as they go.
+ */
+static void fbc_prescroll(struct fbc_priv *priv, const char *s, size_t nbytes)
+{
+	unsigned int lines = 0;
+	size_t i;
+
+	if (priv->state != LIT)
+		return;
+
+	for (i = 0; i < nbytes; i++) {
+		if (s[i] == '\033' || s[i] == '\b')
+			return;
+		if (s[i] == '\n' || s[i] == '\013')
+			lines++;
+	}
+
+	if (priv->y + lines <= priv->rows)
+		return;
+
+	lines = priv->y + lines - priv->rows;
+
+	show_cursor(priv, priv->x, priv->y);
+	fbc_scroll(priv, lines);
+	priv->y -= min(lines, priv->y);
+	show_cursor(priv, priv->x, priv->y);
+}
+
+static int fbc_puts(struct console_device *cdev, const char *s, size_t nbytes)
+{
+	struct fbc_priv *priv = container_of(cdev,
+					struct fbc_priv, cdev);
+	size_t i;
+
+	if (priv->in_console)
+		return nbytes;
+	priv->in_console = 1;
+
+	fbc_prescroll(priv, s, nbytes);
+
+	for (i = 0; i < nbytes; i++) {
+		if (s[i] == '\n')
+			fbc_output(priv, '\r');
+
+		fbc_output(priv, s[i]);
+	}
+
+	priv->in_console = 0;
+
+	/* only update the screen once per string */
+	fbc_flush(priv);
+
+	return nbytes;
 }
 
 static int setup_font(struct fbc_priv *priv)
@@ -515,6 +620,7 @@ static int set_font(struct param_d *p, void *vpriv)
 
 	if (cdev->f_active & (CONSOLE_STDOUT | CONSOLE_STDERR)) {
 		cls(priv);
+		fbc_flush(priv);
 		setup_font(priv);
 	}
 
@@ -544,6 +650,7 @@ static int set_margin(struct param_d *p, void *vpriv)
 
 	if (cdev->f_active & (CONSOLE_STDOUT | CONSOLE_STDERR)) {
 		cls(priv);
+		fbc_flush(priv);
 		setup_font(priv);
 	}
 
@@ -568,6 +675,7 @@ int register_fbconsole(struct fb_info *fb)
 	cdev->dev = &fb->dev;
 	cdev->tstc = fbc_tstc;
 	cdev->putc = fbc_putc;
+	cdev->puts = fbc_puts;
 	cdev->getc = fbc_getc;
 	cdev->devname = "fbconsole";
 	cdev->devid = DEVICE_ID_DYNAMIC;
@@ -232,6 +232,8 @@ ssize_t cdev_write(struct cdev *cdev, const void *buf, size_t count, loff_t offs
 	if (!cdev->ops->write)
 		return -ENOSYS;
 
+	cdev_modified(cdev);
+
 	return cdev->ops->write(cdev, buf, count, cdev->offset + offset, flags);
 }
 
@@ -256,6 +258,8 @@ int cdev_erase(struct cdev *cdev, loff_t count, loff_t offset)
 	if (!cdev->ops->erase)
 		return -ENOSYS;
 
+	cdev_modified(cdev);
+
 	return cdev->ops->erase(cdev, count, cdev->offset + offset);
 }
 
@@ -21,7 +21,10 @@
 #include <errno.h>
 #include <malloc.h>
 #include <linux/stat.h>
+#include <linux/slab.h>
 #include <linux/err.h>
+#include <linux/hashtable.h>
+#include <linux/stringhash.h>
 #include <fcntl.h>
 #include <xfuncs.h>
 #include <init.h>
@@ -31,6 +34,7 @@
 #include <environment.h>
 #include <libgen.h>
 #include <block.h>
+#include <boottrace.h>
 #include <slice.h>
 #include <libfile.h>
 #include <parseopt.h>
@@ -108,8 +112,6 @@ void cdev_print(const struct cdev *cdev)
 }
 EXPORT_SYMBOL(cdev_print);
 
-static struct fs_device *get_fsdevice_by_path(const char *path);
-
 void stat_print(const char *filename, const struct stat *st)
 {
 	struct block_device *bdev = NULL;
@@ -178,6 +180,45 @@ static struct vfsmount *mnt_root;
 
 static struct fs_driver *ramfs_driver;
 
+static unsigned int fs_generation;
+
+/*
+ * Give the filesystem a new generation number. Generation numbers are
+ * unique over all filesystems, so a cached (fsdev, generation) pair is
+ * never matched by a later mount that happens to reuse the fsdev memory.
+ */
+static void fsdev_modified(struct fs_device *fsdev)
+{
+	fsdev->generation = ++fs_generation;
+}
+
+static void sb_modified(struct super_block *sb)
+{
+	fsdev_modified(container_of(sb, struct fs_device, sb));
+}
+
+/**
+ * cdev_modified - note a write to a cdev bypassing the filesystems on it
+ * @cdev: The cdev written to
+ *
+ * Writes to a partition or to the whole device, e.g. by USB mass storage,
+ * fastboot or cp to /dev/mmc0.0, may change every filesystem on the device,
+ * so all of them get a new generation number.
+ */
+void cdev_modified(struct cdev *cdev)
+{
+	struct cdev *master = cdev->master ?: cdev;
+	struct fs_device *fsdev;
+
+	for_each_fs_device(fsdev) {
+		if (!fsdev->cdev)
+			continue;
+
+		if ((fsdev->cdev->master ?: fsdev->cdev) == master)
+			fsdev_modified(fsdev);
+	}
+}
+
 static int init_fs(void)
 {
 	cwd = xzalloc(PATH_MAX);
@@ -303,6 +344,8 @@ static int create(struct dentry *dir, struct dentry *dentry)
 	if (!inode->i_op->create)
 		return -EROFS;
 
+	sb_modified(inode->i_sb);
+
 	return inode->i_op->create(inode, dentry, S_IFREG | S_IRWXU | S_IRWXG | S_IRWXO);
 }
 
@@ -316,6 +359,8 @@ static int fsdev_truncate(struct device *dev, FILE *f, loff_t length)
 {
 	struct fs_driver *fsdrv = f->fsdev->driver;
 
+	fsdev_modified(f->fsdev);
+
 	return fsdrv->truncate ? fsdrv->truncate(dev, f, length) : -EROFS;
 }
 
@@ -454,6 +499,7 @@ static ssize_t __write(FILE *f, const void *buf, size_t count)
 			f->f_inode->i_size = f->size;
 		}
 	}
+	fsdev_modified(f->fsdev);
 	ret = fsdrv->write(&f->fsdev->dev, f, buf, count);
 out:
 	if (ret < 0)
@@ -746,6 +792,7 @@ static int fs_probe(struct device *dev)
 		return ret;
 
 	fsdev->driver = fsdrv;
+	fsdev_modified(fsdev);
 
 	list_add_tail(&fsdev->list, &fs_device_list);
 
@@ -758,6 +805,14 @@ static int fs_probe(struct device *dev)
 	return 0;
 }
 
+static struct kmem_cache *dentry_cache;
+
+/*
+ * All dentries with a parent are hashed by parent and name, so that
+ * looking up a name doesn't need to walk all siblings.
+ */
+static DEFINE_HASHTABLE(dentry_hashtable, 9);
+
 static void dentry_kill(struct dentry *dentry)
 {
 	if (dentry->d_inode)
@@ -766,9 +821,10 @@ static void dentry_kill(struct dentry *dentry)
 	if (!IS_ROOT(dentry))
 		dput(dentry->d_parent);
 
+	hash_del(&dentry->d_hash);
 	list_del(&dentry->d_child);
 	free(dentry->name);
-	free(dentry);
+	kmem_cache_free(dentry_cache, dentry);
 }
 
 static int dentry_delete_subtree(struct super_block *sb, struct dentry *parent)
@@ -1383,7 +1439,12 @@ static struct dentry *__d_alloc(struct super_block *sb, const struct qstr *name)
 {
 	struct dentry *dentry;
 
-	dentry = xzalloc(sizeof(*dentry));
+	if (!dentry_cache)
+		dentry_cache = KMEM_CACHE(dentry, 0);
+	if (!dentry_cache)
+		return NULL;
+
+	dentry = kmem_cache_zalloc(dentry_cache, GFP_KERNEL);
 	if (!dentry)
 		return NULL;
 
@@ -1391,14 +1452,17 @@ static struct dentry *__d_alloc(struct super_block *sb, const struct qstr *name)
 		name = &slash_name;
 
 	dentry->name = malloc(name->len + 1);
-	if (!dentry->name)
+	if (!dentry->name) {
+		kmem_cache_free(dentry_cache, dentry);
 		return NULL;
+	}
 
 	memcpy(dentry->name, name->name, name->len);
 	dentry->name[name->len] = 0;
 
 	dentry->d_name.len = name->len;
 	dentry->d_name.name = dentry->name;
+	INIT_HLIST_NODE(&dentry->d_hash);
 
 	dentry->d_count = 1;
 	dentry->d_parent = dentry;
@@ -1430,6 +1494,10 @@ static struct dentry *d_alloc(struct dentry *parent, const struct qstr *name)
 	dentry->d_parent = parent;
 	list_add(&dentry->d_child, &parent->d_subdirs);
 
+	dentry->d_name.hash = full_name_hash(parent, dentry->d_name.name,
+					     dentry->d_name.len);
+	hash_add(dentry_hashtable, &dentry->d_hash, dentry->d_name.hash);
+
 	return dentry;
 }
 
@@ -1494,9 +1562,12 @@ static bool d_same_name(const struct dentry *dentry,
 
 static struct dentry *d_lookup(const struct dentry *parent, const struct qstr *name)
 {
+	unsigned int hash = full_name_hash(parent, name->name, name->len);
 	struct dentry *dentry;
 
-	list_for_each_entry(dentry, &parent->d_subdirs, d_child) {
+	hash_for_each_possible(dentry_hashtable, dentry, d_hash, hash) {
+		if (dentry->d_name.hash != hash || dentry->d_parent != parent)
+			continue;
 		if (!d_same_name(dentry, parent, name))
 			continue;
 
@@ -2353,7 +2424,7 @@ static int filename_lookup(struct filename *name, unsigned flags,
 	return err;
 }
 
-static struct fs_device *get_fsdevice_by_path(const char *pathname)
+struct fs_device *get_fsdevice_by_path(const char *pathname)
 {
 	struct fs_device *fsdev;
 	struct path path;
@@ -2379,6 +2450,7 @@ static int vfs_rmdir(struct inode *dir, struct dentry *dentry)
 
 	dget(dentry);
 
+	sb_modified(dir->i_sb);
 	error = dir->i_op->rmdir(dir, dentry);
 	if (error)
 		goto out;
@@ -2403,6 +2475,7 @@ static int vfs_mkdir(struct inode *dir, struct dentry *dentry, umode_t mode)
 
 	mode &= (S_IRWXUGO|S_ISVTX);
 
+	sb_modified(dir->i_sb);
 	error = dir->i_op->mkdir(dir, dentry, mode);
 
 	return error;
@@ -2644,6 +2717,7 @@ int unlink(const char *pathname)
 		goto out_put;
 	}
 
+	sb_modified(inode->i_sb);
 	ret = inode->i_op->unlink(inode, dentry);
 	if (ret)
 		goto out_put;
@@ -2664,6 +2738,8 @@ static int vfs_symlink(struct inode *dir, struct dentry *dentry, const char *old
 	if (!dir->i_op->symlink)
 		return -EPERM;
 
+	sb_modified(dir->i_sb);
+
 	return dir->i_op->symlink(dir, dentry, oldname);
 }
 
@@ -3068,8 +3144,8 @@ char *cdev_get_linux_rootarg(const struct cdev *cdev)
  * We do this by registering a new device on which the filesystem
  * driver will match.
  */
-int mount(const char *device, const char *fsname, const char *pathname,
-		const char *fsoptions)
+static int __mount(const char *device, const char *fsname,
+		   const char *pathname, const char *fsoptions)
 {
 	struct fs_device *fsdev;
 	int ret;
@@ -3174,6 +3250,18 @@ int mount(const char *device, const char *fsname, const char *pathname,
 
 	return ret;
 }
+
+int mount(const char *device, const char *fsname, const char *pathname,
+		const char *fsoptions)
+{
+	int ret;
+
+	boottrace_begin(BOOTTRACE_MOUNT, pathname);
+	ret = __mount(device, fsname, pathname, fsoptions);
+	boottrace_end(BOOTTRACE_MOUNT, pathname);
+
+	return ret;
+}
 EXPORT_SYMBOL(mount);
 
 int umount(const char *pathname)
@@ -1543,7 +1543,7 @@ static struct fs_driver nfs_driver = {
 	.lseek     = nfs_lseek,
 	.write     = nfs_write,
 	.truncate  = nfs_truncate,
-	.flags     = 0,
+	.flags     = FS_DRIVER_REMOTE,
 	.drv = {
 		.probe  = nfs_probe,
 		.remove = nfs_remove,
@@ -156,7 +156,7 @@ static struct fs_driver omap4_usbbootfs_driver = {
 	.read    = omap4_usbbootfs_read,
 	.opendir = omap4_usbbootfs_opendir,
 	.stat    = omap4_usbbootfs_stat,
-	.flags	 = 0,
+	.flags	 = FS_DRIVER_REMOTE,
 	.drv = {
 		.probe	= omap4_usbbootfs_probe,
 		.remove	= omap4_usbbootfs_remove,
@@ -18,6 +18,7 @@
 #include <driver.h>
 #include <init.h>
 #include <malloc.h>
+#include <dma.h>
 #include <fs.h>
 #include <command.h>
 #include <errno.h>
@@ -25,13 +26,20 @@
 #include <xfuncs.h>
 #include <linux/sizes.h>
 
-#define CHUNK_SIZE	(4096 * 2)
+/*
+ * File data is kept in extents. When a file grows, each new extent is at
+ * least as big as the file already is (up to 16MiB), so a file written in
+ * small pieces still ends up in a logarithmic number of extents. Files
+ * truncated to their final size up front, as copy_file() does when it knows the size,
+ * get a single extent and can be memmapped.
+ */
+#define MIN_SIZE	SZ_8K
+#define MAX_GROW_SIZE	SZ_16M
 
 struct ramfs_chunk {
 	char *data;
 	unsigned long ofs;
-	int size;
-	struct list_head list;
+	unsigned long size;
 };
 
 struct ramfs_inode {
@@ -45,9 +53,11 @@ struct ramfs_inode {
 	/* bytes currently allocated for this inode */
 	unsigned long alloc_size;
 
-	struct list_head data;
+	/* extents sorted by offset */
+	struct ramfs_chunk *chunks;
+	unsigned int nr_chunks;
 
-	struct ramfs_chunk *current_chunk;
+	unsigned int current_chunk;
 };
 
 static inline struct ramfs_inode *to_ramfs_inode(struct inode *inode)
@@ -94,33 +104,31 @@ static struct inode *ramfs_get_inode(struct super_block *sb, const struct inode
 	return inode;
 }
 
-#define MIN_SIZE SZ_8K
-
-static struct ramfs_chunk *ramfs_get_chunk(unsigned long size)
+static int ramfs_add_chunk(struct ramfs_inode *node, unsigned long size)
 {
-	struct ramfs_chunk *data = malloc(sizeof(struct ramfs_chunk));
+	struct ramfs_chunk *chunks, *data;
 
-	if (!data)
-		return NULL;
+	chunks = realloc(node->chunks, (node->nr_chunks + 1) * sizeof(*chunks));
+	if (!chunks)
+		return -ENOMEM;
 
-	if (size < MIN_SIZE)
-		size = MIN_SIZE;
+	node->chunks = chunks;
 
-	data->data = calloc(size, 1);
-	if (!data->data) {
-		free(data);
-		return NULL;
-	}
+	data = &chunks[node->nr_chunks];
+	/* DMA safe, so that memmapped files can be received into directly */
+	data->data = memalign(DMA_ALIGNMENT, ALIGN(size, DMA_ALIGNMENT));
+	if (!data->data)
+		return -ENOMEM;
+
+	memset(data->data, 0, size);
 
+	data->ofs = node->alloc_size;
 	data->size = size;
 
-	return data;
-}
+	node->nr_chunks++;
+	node->alloc_size += size;
 
-static void ramfs_put_chunk(struct ramfs_chunk *data)
-{
-	free(data->data);
-	free(data);
+	return 0;
 }
 
 /* ---------------------------------------------------------------*/
@@ -198,27 +206,39 @@ static const struct inode_operations ramfs_dir_inode_operations =
 static struct ramfs_chunk *ramfs_find_chunk(struct ramfs_inode *node,
 					    unsigned long pos, int *ofs, int *len)
 {
-	struct ramfs_chunk *data, *cur = node->current_chunk;
-
-	if (cur && pos >= cur->ofs)
-		data = cur;
-	else
-		data = list_first_entry(&node->data, struct ramfs_chunk, list);
-
-	list_for_each_entry_from(data, &node->data, list) {
-		if (data->ofs + data->size > pos) {
-			*ofs = pos - data->ofs;
-			*len = data->ofs + data->size - pos;
-
-			node->current_chunk = data;
+	struct ramfs_chunk *data = NULL;
+	unsigned int lo = 0, hi = node->nr_chunks;
+
+	/* sequential access mostly stays in the current chunk */
+	if (node->current_chunk < node->nr_chunks) {
+		data = &node->chunks[node->current_chunk];
+		if (pos < data->ofs || pos >= data->ofs + data->size)
+			data = NULL;
+	}
 
-			return data;
+	while (!data && lo < hi) {
+		unsigned int mid = (lo + hi) / 2;
+		struct ramfs_chunk *c = &node->chunks[mid];
+
+		if (pos < c->ofs) {
+			hi = mid;
+		} else if (pos >= c->ofs + c->size) {
+			lo = mid + 1;
+		} else {
+			data = c;
+			node->current_chunk = mid;
 		}
 	}
 
-	pr_err("%s: no chunk for pos %ld found\n", __func__, pos);
+	if (!data) {
+		pr_err("%s: no chunk for pos %ld found\n", __func__, pos);
+		return NULL;
+	}
 
-	return NULL;
+	*ofs = pos - data->ofs;
+	*len = min_t(unsigned long, data->ofs + data->size - pos, INT_MAX);
+
+	return data;
 }
 
 static int ramfs_read(struct device *_dev, FILE *f, void *buf, size_t insize)
@@ -284,74 +304,73 @@ static int ramfs_write(struct device *_dev, FILE *f, const void *buf,
 
 static void ramfs_truncate_down(struct ramfs_inode *node, unsigned long size)
 {
-	struct ramfs_chunk *data, *tmp;
+	while (node->nr_chunks) {
+		struct ramfs_chunk *data = &node->chunks[node->nr_chunks - 1];
 
-	list_for_each_entry_safe(data, tmp, &node->data, list) {
-		if (data->ofs >= size) {
-			list_del(&data->list);
-			node->alloc_size -= data->size;
-			ramfs_put_chunk(data);
-		}
+		if (data->ofs < size)
+			break;
+
+		node->alloc_size -= data->size;
+		free(data->data);
+		node->nr_chunks--;
 	}
 
-	node->current_chunk = NULL;
+	if (!node->nr_chunks) {
+		free(node->chunks);
+		node->chunks = NULL;
+	}
+
+	node->current_chunk = 0;
 }
 
 static int ramfs_truncate_up(struct ramfs_inode *node, unsigned long size)
 {
-	struct ramfs_chunk *data, *tmp;
-	LIST_HEAD(list);
-	unsigned long add = size - node->alloc_size;
-	unsigned long chunksize = add;
-	unsigned long alloc_size = 0;
+	unsigned long old_alloc_size = node->alloc_size;
+	unsigned long add, chunksize;
 
 	if (node->alloc_size >= size)
 		return 0;
 
+	add = size - node->alloc_size;
+
+	/*
+	 * Grow geometrically, so that appending in small steps doesn't
+	 * create lots of tiny extents. Exactly what was asked for is
+	 * allocated for the first extent, which is what preallocation
+	 * uses.
+	 */
+	chunksize = add;
+	if (node->alloc_size)
+		chunksize = max(add, min_t(unsigned long, node->alloc_size,
+					   MAX_GROW_SIZE));
+	chunksize = max_t(unsigned long, chunksize, MIN_SIZE);
+
+	if (!ramfs_add_chunk(node, chunksize))
+		return 0;
+
 	/*
-	 * We first try to allocate all space we need in a single chunk.
-	 * This may fail because of fragmented memory, so in case we cannot
-	 * allocate memory we successively decrease the chunk size until
-	 * we have enough allocations made.
+	 * The allocation may fail because of fragmented memory, so in that
+	 * case successively decrease the chunk size until we have enough
+	 * allocations made. If we do not have even 128KiB then go out.
 	 */
-	while (1) {
+	chunksize = add;
+	while (add) {
 		unsigned long now = min(chunksize, add);
 
-		data = ramfs_get_chunk(now);
-		if (!data) {
-			/* No luck, try with smaller chunk size */
+		if (ramfs_add_chunk(node, max_t(unsigned long, now, MIN_SIZE))) {
 			chunksize >>= 1;
-
-			/* If we do not have even 128KiB then go out */
 			if (chunksize < SZ_128K)
 				goto out;
-
 			continue;
 		}
 
-		data->ofs = node->alloc_size + alloc_size;
-
-		alloc_size += data->size;
-
-		list_add_tail(&data->list, &list);
-
-		if (add <= data->size)
-			break;
-
-		add -= data->size;
+		add -= min(add, node->chunks[node->nr_chunks - 1].size);
 	}
 
-	list_splice_tail(&list, &node->data);
-
-	node->alloc_size += alloc_size;
-
 	return 0;
 
 out:
-	list_for_each_entry_safe(data, tmp, &list, list) {
-		list_del(&data->list);
-		ramfs_put_chunk(data);
-	}
+	ramfs_truncate_down(node, old_alloc_size);
 
 	return -ENOSPC;
 }
@@ -392,17 +411,12 @@ static int ramfs_memmap(struct device *_dev, FILE *f, void **map, int flags)
 {
 	struct inode *inode = f->f_inode;
 	struct ramfs_inode *node = to_ramfs_inode(inode);
-	struct ramfs_chunk *data;
-
-	if (list_empty(&node->data))
-		return -EINVAL;
 
-	if (!list_is_singular(&node->data))
+	/* only possible when all data is in the first extent */
+	if (!node->nr_chunks || node->chunks[0].size < node->size)
 		return -EINVAL;
 
-	data = list_first_entry(&node->data, struct ramfs_chunk, list);
-
-	*map = data->data;
+	*map = node->chunks[0].data;
 
 	return 0;
 }
@@ -413,8 +427,6 @@ static struct inode *ramfs_alloc_inode(struct super_block *sb)
 
 	node = xzalloc(sizeof(*node));
 
-	INIT_LIST_HEAD(&node->data);
-
 	return &node->inode;
 }
 
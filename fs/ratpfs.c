@@ -452,7 +452,7 @@ static struct fs_driver ratpfs_driver = {
 	.rmdir     = ratpfs_rm,
 	.write     = ratpfs_write,
 	.truncate  = ratpfs_truncate,
-	.flags     = FS_DRIVER_NO_DEV,
+	.flags     = FS_DRIVER_NO_DEV | FS_DRIVER_REMOTE,
 	.drv = {
 		.probe  = ratpfs_probe,
 		.remove = ratpfs_remove,
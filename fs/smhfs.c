@@ -161,7 +161,7 @@ static struct fs_driver smhfs_driver = {
 	.rmdir     = smhfs_rm,
 	.write     = smhfs_write,
 	.truncate  = smhfs_truncate,
-	.flags     = FS_DRIVER_NO_DEV,
+	.flags     = FS_DRIVER_NO_DEV | FS_DRIVER_REMOTE,
 	.drv = {
 		.probe  = smhfs_probe,
 		.remove = smhfs_remove,
@@ -1060,7 +1060,7 @@ static struct fs_driver tftp_driver = {
 	.lseek     = tftp_lseek,
 	.write     = tftp_write,
 	.truncate  = tftp_truncate,
-	.flags     = 0,
+	.flags     = FS_DRIVER_REMOTE,
 	.drv = {
 		.probe  = tftp_probe,
 		.remove = tftp_remove,
@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef __BOOTCACHE_H
+#define __BOOTCACHE_H
+
+#include <linux/types.h>
+#include <errno.h>
+
+#define BOOTCACHE_KEY_LEN	32
+
+/*
+ * Layout of the boot cache in its reserved memory region. All fields are
+ * little endian. The entries follow the header back to back, each padded
+ * to 8 bytes.
+ */
+struct bootcache_entry {
+	char	key[BOOTCACHE_KEY_LEN];	/* empty for deleted entries */
+	__le32	len;			/* length of data */
+	__le32	crc;			/* crc32 of key, len and data */
+	u8	data[];
+};
+
+#define BOOTCACHE_MAGIC		0x43425842	/* "BXBC" */
+#define BOOTCACHE_VERSION	1
+
+struct bootcache_header {
+	__le32	magic;
+	__le32	version;
+	__le32	used;		/* bytes used by entries */
+	__le32	reserved;
+	struct bootcache_entry entries[];
+};
+
+#ifdef CONFIG_BOOTCACHE
+ssize_t bootcache_load(const char *key, void *buf, size_t len);
+int bootcache_store(const char *key, const void *buf, size_t len);
+void bootcache_clear(void);
+void bootcache_info(void);
+#else
+static inline ssize_t bootcache_load(const char *key, void *buf, size_t len)
+{
+	return -ENOENT;
+}
+
+static inline int bootcache_store(const char *key, const void *buf,
+				  size_t len)
+{
+	return -ENOSYS;
+}
+
+static inline void bootcache_clear(void)
+{
+}
+
+static inline void bootcache_info(void)
+{
+}
+#endif
+
+#endif /* __BOOTCACHE_H */
@@ -0,0 +1,66 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef __BOOTTRACE_H
+#define __BOOTTRACE_H
+
+#include <linux/types.h>
+
+enum boottrace_cat {
+	BOOTTRACE_INITCALL,
+	BOOTTRACE_PROBE,
+	BOOTTRACE_DEFERRED,
+	BOOTTRACE_MOUNT,
+	BOOTTRACE_BOOTM,
+	BOOTTRACE_FIT,
+	BOOTTRACE_NUM_CAT,
+};
+
+#define BOOTTRACE_NAME_LEN	40
+
+/*
+ * Layout of the trace buffer as handed over to the kernel through
+ * /reserved-memory/boottrace. All fields are little endian.
+ */
+struct boottrace_entry {
+	__le64	ts_ns;		/* get_time_ns() at the event */
+	__le64	addr;		/* function address for initcalls, else 0 */
+	u8	phase;		/* 'B'egin or 'E'nd */
+	u8	cat;		/* enum boottrace_cat */
+	u8	reserved[6];
+	char	name[BOOTTRACE_NAME_LEN];
+};
+
+#define BOOTTRACE_MAGIC		0x54425842	/* "BXBT" */
+#define BOOTTRACE_VERSION	1
+
+struct boottrace_header {
+	__le32	magic;
+	__le32	version;
+	__le32	nr_entries;	/* capacity of the ring */
+	__le32	head;		/* total number of events recorded */
+	__le64	handover_ns;	/* get_time_ns() when handed to the kernel */
+	struct boottrace_entry entries[];
+};
+
+#ifdef CONFIG_BOOTTRACE
+void boottrace_event(enum boottrace_cat cat, char phase, const char *name);
+void boottrace_event_fn(enum boottrace_cat cat, char phase, const void *fn);
+int boottrace_dump_json(int fd);
+void boottrace_clear(void);
+#else
+static inline void boottrace_event(enum boottrace_cat cat, char phase,
+				   const char *name)
+{
+}
+
+static inline void boottrace_event_fn(enum boottrace_cat cat, char phase,
+				      const void *fn)
+{
+}
+#endif
+
+#define boottrace_begin(cat, name)	boottrace_event(cat, 'B', name)
+#define boottrace_end(cat, name)	boottrace_event(cat, 'E', name)
+#define boottrace_begin_fn(cat, fn)	boottrace_event_fn(cat, 'B', fn)
+#define boottrace_end_fn(cat, fn)	boottrace_event_fn(cat, 'E', fn)
+
+#endif /* __BOOTTRACE_H */
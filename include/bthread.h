@@ -24,6 +24,7 @@ void *bthread_data(struct bthread *bthread);
 void bthread_info(void);
 const char *bthread_name(struct bthread *bthread);
 bool bthread_is_main(struct bthread *bthread);
+void bthread_set_parallel(struct bthread *bthread);
 
 /**
  * bthread_run - create and wake a thread.
@@ -45,10 +46,15 @@ bool bthread_is_main(struct bthread *bthread);
 
 #ifdef CONFIG_BTHREAD
 void bthread_reschedule(void);
+void bthread_reschedule_parallel(void);
 #else
 static inline void bthread_reschedule(void)
 {
 }
+
+static inline void bthread_reschedule_parallel(void)
+{
+}
 #endif
 
 #endif
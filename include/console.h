@@ -35,6 +35,10 @@ struct console_device {
 	int  (*getc)(struct console_device *cdev);
 	int (*setbrg)(struct console_device *cdev, int baudrate);
 	void (*flush)(struct console_device *cdev);
+	/* number of bytes tx_putc() can take without waiting */
+	int (*tx_room)(struct console_device *cdev);
+	/* write a character without waiting, only called when there is room */
+	void (*tx_putc)(struct console_device *cdev, char c);
 	int (*set_mode)(struct console_device *cdev, enum console_mode mode);
 	int (*open)(struct console_device *cdev);
 	int (*close)(struct console_device *cdev);
@@ -60,6 +64,12 @@ struct console_device {
 	struct cdev_operations fops;
 
 	struct serdev_device serdev;
+
+	struct kfifo *tx_fifo;
+	/* putc of the driver, when putc is replaced for a tx_fifo */
+	void (*orig_putc)(struct console_device *cdev, char c);
+	/* bytes dropped from the tx_fifo because the UART was stuck */
+	unsigned int tx_dropped;
 };
 
 static inline struct serdev_device *to_serdev_device(struct device *d)
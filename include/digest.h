@@ -44,6 +44,8 @@ struct crypto_alg {
 	char *driver_name;
 	int priority;
 #define DIGEST_ALGO_NEED_KEY	(1 << 0)
+/* init/update/final only touch the context, so may run on another core */
+#define DIGEST_ALGO_SMP_SAFE	(1 << 1)
 	unsigned int flags;
 	enum hash_algo algo;
 };
@@ -58,6 +58,8 @@ struct device {
 	struct driver *driver; /*! The driver for this device */
 
 	struct list_head list;     /* The list of all devices */
+	struct hlist_node hash;    /* indexed by dev_name() */
+	struct hlist_node name_hash; /* indexed by name */
 	struct list_head bus_list; /* our bus            */
 	struct list_head children; /* our children            */
 	struct list_head sibling;
@@ -93,10 +95,36 @@ struct device {
 	int     (*detect) (struct device *);
 	void	(*rescan) (struct device *);
 
+	/*
+	 * detect may run in a bthread at the same time as the detect of
+	 * other such devices. Set by bus cores whose detect mostly waits
+	 * for the hardware, see blspec_detect_devices()
+	 *
+	 * Nothing serializes the buses shared between such devices: when
+	 * one detect waits in the middle of an I2C or SPI transfer, e.g. to
+	 * enable its regulator through a PMIC, the next one may start its
+	 * own transfer on the same bus. Only set this for devices whose
+	 * detect does not share a bus with the detect of other parallel
+	 * devices in a way that matters on the supported boards.
+	 */
+	bool detect_parallel;
+
 	/*
 	 * if a driver probe is deferred, this stores the last error
 	 */
 	char *deferred_probe_reason;
+
+	/*
+	 * if a driver probe is deferred, this stores the supplier it waited
+	 * for, if known. Cleared once the supplier is probed.
+	 */
+	struct device_node *deferred_supplier;
+
+	/* probe statistics, shown by drvinfo -d */
+	unsigned int probe_order;	/* 0 if not probed yet */
+	unsigned int deferrals;
+	u64 probe_ns;
+	u64 deferred_ns;		/* time spent in deferred probes */
 };
 
 /** @brief Describes a driver present in the system */
@@ -111,6 +139,9 @@ struct driver {
 	/*! Called if an instance of a device is found */
 	int     (*probe) (struct device *);
 
+	/*! Run probe in a bthread with CONFIG_ASYNC_PROBE, see device_probe() */
+	bool async_probe;
+
 	/*! Called if an instance of a device is gone. */
 	void     (*remove)(struct device *);
 
@@ -146,6 +177,13 @@ int register_device(struct device *);
  */
 int device_probe(struct device *dev);
 
+/* record that the device currently probed waits for @supplier */
+void device_probe_wait_for(struct device_node *supplier);
+
+/* wait for asynchronous probes, see CONFIG_ASYNC_PROBE */
+void device_probe_join(struct device *dev);
+void device_probe_join_node(struct device_node *np);
+
 /* detect devices attached to this device (cards, disks,...) */
 int device_detect(struct device *dev);
 int device_detect_by_name(const char *devname);
@@ -523,6 +561,7 @@ struct cdev {
 			 * device part, i.e. name = "nand0.barebox" -> partname = "barebox"
 			 */
 	char uuid[MAX_UUID_STR];
+	char typeuuid[MAX_UUID_STR]; /* GPT partition type GUID, if any */
 	loff_t offset;
 	loff_t size;
 	unsigned int flags;
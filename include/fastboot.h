@@ -28,6 +28,8 @@ struct fastboot {
 	int (*cmd_flash)(struct fastboot *fb, struct file_list_entry *entry,
 			 const char *filename, size_t len);
 	int download_fd;
+	/* download file mapped into memory, NULL if not possible */
+	void *download_buf;
 	char *tempname;
 
 	bool active;
@@ -78,10 +80,12 @@ void fastboot_generic_close(struct fastboot *fb);
 void fastboot_generic_free(struct fastboot *fb);
 int fastboot_handle_download_data(struct fastboot *fb, const void *buffer,
 				  unsigned int len);
+void fastboot_download_advance(struct fastboot *fb, unsigned int len);
 int fastboot_tx_print(struct fastboot *fb, enum fastboot_msg_type type,
 		      const char *fmt, ...);
 void fastboot_start_download_generic(struct fastboot *fb);
 void fastboot_download_finished(struct fastboot *fb);
+void fastboot_download_cancel(struct fastboot *fb);
 void fastboot_exec_cmd(struct fastboot *fb, const char *cmdbuf);
 void fastboot_abort(struct fastboot *fb);
 
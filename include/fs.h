@@ -38,6 +38,7 @@ typedef struct filep {
 } FILE;
 
 #define FS_DRIVER_NO_DEV	1
+#define FS_DRIVER_REMOTE	2	/* files can change without barebox noticing */
 
 struct fs_driver {
 	int (*probe) (struct device *dev);
@@ -105,6 +106,7 @@ struct fs_device {
 	struct list_head list;
 	char *options;
 	char *linux_rootarg;
+	unsigned int generation; /* changes whenever the filesystem is modified */
 
 	struct super_block sb;
 
@@ -156,6 +158,8 @@ char *canonicalize_path(const char *pathname);
 char *get_mounted_path(const char *path);
 
 struct cdev *get_cdev_by_mountpath(const char *path);
+struct fs_device *get_fsdevice_by_path(const char *path);
+void cdev_modified(struct cdev *cdev);
 
 /* Register a new filesystem driver */
 int register_fs_driver(struct fs_driver *fsdrv);
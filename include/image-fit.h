@@ -7,6 +7,7 @@
 #define __IMAGE_FIT_H__
 
 #include <linux/types.h>
+#include <linux/list.h>
 #include <bootm.h>
 
 struct fit_handle {
@@ -20,6 +21,9 @@ struct fit_handle {
 	struct device_node *root;
 	struct device_node *images;
 	struct device_node *configurations;
+
+	/* images of the opened configuration hashed on secondary cores */
+	struct list_head hash_jobs;
 };
 
 struct fit_handle *fit_open(const char *filename, bool verbose,
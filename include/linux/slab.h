@@ -35,6 +35,23 @@ static inline void *kmalloc(size_t size, gfp_t flags)
 	return malloc(size);
 }
 
+static inline void kfree(const void *mem)
+{
+	free((void *)mem);
+}
+
+#ifdef CONFIG_SLAB
+struct kmem_cache;
+
+struct kmem_cache *kmem_cache_create(const char *name, unsigned int size,
+				     unsigned int align, slab_flags_t flags,
+				     void (*ctor)(void *));
+void kmem_cache_destroy(struct kmem_cache *cache);
+void *kmem_cache_alloc(struct kmem_cache *cache, gfp_t flags);
+void kmem_cache_free(struct kmem_cache *cache, void *mem);
+unsigned int kmem_cache_size(struct kmem_cache *cache);
+void kmem_cache_print_stats(void);
+#else
 struct kmem_cache {
 	unsigned int size;
 	void (*ctor)(void *);
@@ -61,11 +78,6 @@ static inline void kmem_cache_destroy(struct kmem_cache *cache)
 	free(cache);
 }
 
-static inline void kfree(const void *mem)
-{
-	free((void *)mem);
-}
-
 static inline void *kmem_cache_alloc(struct kmem_cache *cache, gfp_t flags)
 {
 	void *mem = kmalloc(cache->size, flags);
@@ -85,6 +97,30 @@ static inline void kmem_cache_free(struct kmem_cache *cache, void *mem)
 	kfree(mem);
 }
 
+static inline unsigned int kmem_cache_size(struct kmem_cache *cache)
+{
+	return cache->size;
+}
+
+static inline void kmem_cache_print_stats(void)
+{
+}
+#endif
+
+#define KMEM_CACHE(__struct, __flags)					\
+	kmem_cache_create(#__struct, sizeof(struct __struct),		\
+			  __alignof__(struct __struct), (__flags), NULL)
+
+static inline void *kmem_cache_zalloc(struct kmem_cache *cache, gfp_t flags)
+{
+	void *mem = kmem_cache_alloc(cache, flags);
+
+	if (mem)
+		memset(mem, 0, kmem_cache_size(cache));
+
+	return mem;
+}
+
 static inline void *kzalloc(size_t size, gfp_t flags)
 {
 	return calloc(size, 1);
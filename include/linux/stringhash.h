@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef __LINUX_STRINGHASH_H
+#define __LINUX_STRINGHASH_H
+
+#include <linux/compiler.h>
+#include <linux/types.h>
+#include <linux/hash.h>
+
+/*
+ * Routines for hashing strings of bytes to a 32-bit hash value.
+ *
+ * These are the generic versions without the word-at-a-time optimization
+ * of Linux. Hash values are only used within barebox and never stored.
+ */
+
+#define init_name_hash(salt)		(unsigned long)(salt)
+
+/* partial hash update function. Assume roughly 4 bits per character */
+static inline unsigned long
+partial_name_hash(unsigned long c, unsigned long prevhash)
+{
+	return (prevhash + (c << 4) + (c >> 4)) * 11;
+}
+
+/*
+ * Finally: cut down the number of bits to a int value (and try to avoid
+ * losing bits).  This also has the property (wanted by the dcache)
+ * that the msbits make a good hash table index.
+ */
+static inline unsigned int end_name_hash(unsigned long hash)
+{
+	return hash_long(hash, 32);
+}
+
+static inline unsigned int full_name_hash(const void *salt, const char *name,
+					  unsigned int len)
+{
+	unsigned long hash = init_name_hash(salt);
+
+	while (len--)
+		hash = partial_name_hash((unsigned char)*name++, hash);
+
+	return end_name_hash(hash);
+}
+
+static inline unsigned int str_hash(const char *name)
+{
+	unsigned long hash = init_name_hash(0);
+
+	while (*name)
+		hash = partial_name_hash((unsigned char)*name++, hash);
+
+	return end_name_hash(hash);
+}
+
+#endif /* __LINUX_STRINGHASH_H */
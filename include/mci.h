@@ -56,16 +56,25 @@
 #define MMC_CAP_MMC_1_2V_DDR		(1 << 9)	/* Host supports eMMC DDR 1.2V */
 #define MMC_CAP_DDR			(MMC_CAP_3_3V_DDR | MMC_CAP_1_8V_DDR | \
 					 MMC_CAP_1_2V_DDR)
+#define MMC_CAP_CMD23			(1 << 10)	/* CMD23 predefined multi-block transfers */
+#define MMC_CAP_AUTO_CMD12		(1 << 11)	/* Host stops open-ended transfers itself */
+#define MMC_CAP_AUTO_CMD23		(1 << 12)	/* Host sends SET_BLOCK_COUNT itself */
+#define MMC_CAP_WAIT_WHILE_BUSY		(1 << 13)	/* Host waits for DAT0 busy to end */
 /* Mask of all caps for bus width */
 #define MMC_CAP_BIT_DATA_MASK		(MMC_CAP_4_BIT_DATA | MMC_CAP_8_BIT_DATA)
 
 #define SD_DATA_4BIT		0x00040000
+#define SD_SCR_SPEC3		0x00008000
+#define SD_SCR_CMD23_SUPPORT	0x00000002
 
 #define IS_SD(x) (x->version & SD_VERSION_SD)
 
 #define MMC_DATA_READ		1
 #define MMC_DATA_WRITE		2
 
+#define MMC_AUTO_CMD12		1
+#define MMC_AUTO_CMD23		2
+
 /* command list */
 #define MMC_CMD_GO_IDLE_STATE		0
 #define MMC_CMD_SEND_OP_COND		1
@@ -82,6 +91,7 @@
 #define MMC_CMD_SET_BLOCKLEN		16
 #define MMC_CMD_READ_SINGLE_BLOCK	17
 #define MMC_CMD_READ_MULTIPLE_BLOCK	18
+#define MMC_CMD_SET_BLOCK_COUNT		23
 #define MMC_CMD_WRITE_SINGLE_BLOCK	24
 #define MMC_CMD_WRITE_MULTIPLE_BLOCK	25
 #define MMC_CMD_APP_CMD			55
@@ -389,6 +399,7 @@ struct mci_cmd {
 	unsigned resp_type;	/**< Type of expected response, refer MMC_RSP_* macros */
 	unsigned cmdarg;	/**< Command's arguments */
 	unsigned response[4];	/**< card's response */
+	unsigned busy_timeout;	/**< max. DAT0 busy time of R1b commands in ms, 0 for a default */
 };
 
 /** data information to be used with some SD/MMC commands */
@@ -400,6 +411,7 @@ struct mci_data {
 	unsigned flags;		/**< refer MMC_DATA_* to define direction */
 	unsigned blocks;	/**< block count to handle in this command */
 	unsigned blocksize;	/**< block size in bytes (mostly 512) */
+	unsigned auto_cmd;	/**< refer MMC_AUTO_*, only for hosts with MMC_CAP_AUTO_* */
 };
 
 enum mci_timing {
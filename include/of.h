@@ -36,6 +36,8 @@ struct device_node {
 	struct list_head list;
 	phandle phandle;
 	struct device *dev;
+	/* node header in the blob this node was unflattened in place from */
+	const void *fdt_node;
 };
 
 struct of_device_id {
@@ -118,6 +120,8 @@ int of_parse_dtb(struct fdt_header *fdt);
 struct device_node *of_unflatten_dtb(const void *fdt, int size);
 struct device_node *of_read_file(const char *filename);
 struct device_node *of_unflatten_dtb_const(const void *infdt, int size);
+struct device_node *of_unflatten_dtb_owned(void *infdt, int size);
+void of_unflatten_release(struct device_node *root);
 
 int of_fixup_reserved_memory(struct device_node *node, void *data);
 
@@ -189,6 +193,7 @@ extern struct device_node *of_copy_node(struct device_node *parent,
 				const struct device_node *other);
 extern struct device_node *of_dup(const struct device_node *root);
 extern void of_delete_node(struct device_node *node);
+extern void of_print_lookup_stats(void);
 
 extern const char *of_get_machine_compatible(void);
 extern int of_machine_is_compatible(const char *compat);
@@ -822,6 +827,10 @@ static inline void of_delete_node(struct device_node *node)
 {
 }
 
+static inline void of_print_lookup_stats(void)
+{
+}
+
 static inline int of_machine_is_compatible(const char *compat)
 {
 	return 0;
@@ -37,6 +37,7 @@ struct param_d {
 	struct device *dev;
 	void *driver_priv;
 	struct list_head list;
+	struct hlist_node hash;
 	enum param_type type;
 };
 
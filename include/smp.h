@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef __SMP_H
+#define __SMP_H
+
+#include <linux/types.h>
+#include <linux/string.h>
+
+/* upper bound for smp_num_workers(), so callers can size their job arrays */
+#define SMP_MAX_WORKERS		7
+
+/**
+ * struct smp_job - a job to run on a secondary core
+ * @fn:		function to run. It runs concurrently to the boot CPU, so it
+ *		must only work on the memory passed in @arg and not call
+ *		malloc, console output, drivers or pollers.
+ * @arg:	argument passed to @fn
+ */
+struct smp_job {
+	void (*fn)(void *arg);
+	void *arg;
+
+	/* private */
+	bool done;
+};
+
+#ifdef CONFIG_SMP_WORKERS
+unsigned int smp_num_workers(void);
+void smp_job_queue(struct smp_job *job);
+void smp_job_wait(struct smp_job *job);
+void smp_memset(void *s, int c, size_t n);
+#else
+static inline unsigned int smp_num_workers(void)
+{
+	return 0;
+}
+
+static inline void smp_job_queue(struct smp_job *job)
+{
+	job->fn(job->arg);
+	job->done = true;
+}
+
+static inline void smp_job_wait(struct smp_job *job)
+{
+}
+
+static inline void smp_memset(void *s, int c, size_t n)
+{
+	memset(s, c, n);
+}
+#endif
+
+#endif /* __SMP_H */
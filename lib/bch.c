@@ -336,7 +336,7 @@ static void compute_syndromes(struct bch_control *bch, uint32_t *ecc,
 			      unsigned int *syn)
 {
 	int i, j, s;
-	unsigned int m;
+	unsigned int m, e, step;
 	uint32_t poly;
 	const int t = GF_T(bch);
 
@@ -354,8 +354,16 @@ static void compute_syndromes(struct bch_control *bch, uint32_t *ecc,
 		s -= 32;
 		while (poly) {
 			i = deg(poly);
-			for (j = 0; j < 2*t; j += 2)
-				syn[j] ^= a_pow(bch, (j+1)*(i+s));
+			/*
+			 * walk the odd powers a^((j+1)*(i+s)) by adding the
+			 * exponent step instead of a full modulo per syndrome
+			 */
+			e = modulo(bch, i+s);
+			step = mod_s(bch, 2*e);
+			for (j = 0; j < 2*t; j += 2) {
+				syn[j] ^= bch->a_pow_tab[e];
+				e = mod_s(bch, e+step);
+			}
 
 			poly ^= (1 << i);
 		}
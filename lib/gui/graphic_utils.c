@@ -71,11 +71,42 @@ static void memsetw(void *s, u16 c, size_t n)
 
 static void memsetl(void *s, u32 c, size_t n)
 {
-	size_t i;
-	u32* tmp = s;
+	u64 c64 = (u64)c << 32 | c;
+	u32 *tmp = s;
+	u64 *tmp64;
 
-	for (i = 0; i < n; i++)
+	if (n && !IS_ALIGNED((unsigned long)tmp, sizeof(u64))) {
 		*tmp++ = c;
+		n--;
+	}
+
+	/* two pixels per store */
+	for (tmp64 = (u64 *)tmp; n >= 2; n -= 2)
+		*tmp64++ = c64;
+
+	if (n)
+		*(u32 *)tmp64 = c;
+}
+
+/*
+ * Fill @n pixels with @px, which is already in framebuffer format.
+ * Return: false if the framebuffer format is not supported
+ */
+static bool gu_fill_row(struct fb_info *info, void *buf, u32 px, size_t n)
+{
+	switch (info->bits_per_pixel) {
+	case 8:
+		memset(buf, (u8)px, n);
+		return true;
+	case 16:
+		memsetw(buf, (u16)px, n);
+		return true;
+	case 32:
+		memsetl(buf, px, n);
+		return true;
+	default:
+		return false;
+	}
 }
 
 void gu_memset_pixel(struct fb_info *info, void* buf, u32 color, size_t size)
@@ -214,11 +245,101 @@ void gu_set_rgba_pixel(struct fb_info *info, void *adr, u8 r, u8 g, u8 b, u8 a)
 	gu_set_pixel(info, adr, px);
 }
 
+static bool gu_is_888(struct fb_info *info)
+{
+	return info->bits_per_pixel == 32 && info->red.length == 8 &&
+	       info->green.length == 8 && info->blue.length == 8;
+}
+
+static bool gu_is_565(struct fb_info *info)
+{
+	return info->bits_per_pixel == 16 && info->red.length == 5 &&
+	       info->green.length == 6 && info->blue.length == 5;
+}
+
+/*
+ * The row kernels below do the same as gu_set_rgba_pixel() for the common
+ * framebuffer formats, but look at the format only once per row.
+ */
+static void gu_blend_row_888(struct fb_info *info, u32 *dst, const u8 *src,
+			     int width, int src_bpp)
+{
+	unsigned int ro = info->red.offset, go = info->green.offset,
+		     bo = info->blue.offset, to = info->transp.offset,
+		     tl = info->transp.length;
+	int x;
+
+	for (x = 0; x < width; x++, dst++, src += src_bpp) {
+		u8 r = src[0], g = src[1], b = src[2];
+		u8 a = src_bpp == 4 ? src[3] : 0xff;
+		u32 px = 0;
+
+		if (!a)
+			continue;
+
+		if (a != 0xff) {
+			if (tl) {
+				px = (a >> (8 - tl)) << to;
+			} else {
+				u32 d = *dst;
+
+				r = alpha_mux((d >> ro) & 0xff, r, a);
+				g = alpha_mux((d >> go) & 0xff, g, a);
+				b = alpha_mux((d >> bo) & 0xff, b, a);
+			}
+		}
+
+		*dst = px | r << ro | g << go | b << bo;
+	}
+}
+
+static void gu_blend_row_565(struct fb_info *info, u16 *dst, const u8 *src,
+			     int width, int src_bpp)
+{
+	unsigned int ro = info->red.offset, go = info->green.offset,
+		     bo = info->blue.offset;
+	int x;
+
+	for (x = 0; x < width; x++, dst++, src += src_bpp) {
+		u8 r = src[0], g = src[1], b = src[2];
+		u8 a = src_bpp == 4 ? src[3] : 0xff;
+
+		if (!a)
+			continue;
+
+		if (a != 0xff) {
+			u16 d = *dst;
+
+			r = alpha_mux(((d >> ro) & 0x1f) << 3, r, a);
+			g = alpha_mux(((d >> go) & 0x3f) << 2, g, a);
+			b = alpha_mux(((d >> bo) & 0x1f) << 3, b, a);
+		}
+
+		*dst = (r >> 3) << ro | (g >> 2) << go | (b >> 3) << bo;
+	}
+}
+
+static void gu_blend_row(struct fb_info *info, void *adr, const u8 *src,
+			 int width, int src_bpp)
+{
+	int x;
+
+	for (x = 0; x < width; x++, src += src_bpp) {
+		if (src_bpp == 4)
+			gu_set_rgba_pixel(info, adr, src[0], src[1], src[2],
+					  src[3]);
+		else
+			gu_set_rgb_pixel(info, adr, src[0], src[1], src[2]);
+
+		adr += info->bits_per_pixel >> 3;
+	}
+}
+
 void gu_rgba_blend(struct fb_info *info, struct image *img, void* buf, int height,
 	int width, int startx, int starty, bool is_rgba)
 {
 	unsigned char *adr;
-	int x, y;
+	int y;
 	int line_length;
 	int img_byte_per_pixel = 3;
 	void *image;
@@ -233,18 +354,15 @@ void gu_rgba_blend(struct fb_info *info, struct image *img, void* buf, int heigh
 				startx * (info->bits_per_pixel >> 3);
 		image = img->data + (y * img->width *img_byte_per_pixel);
 
-		for (x = 0; x < width; x++) {
-			uint8_t *pixel = image;
-
-			if (is_rgba)
-				gu_set_rgba_pixel(info, adr, pixel[0], pixel[1],
-						pixel[2], pixel[3]);
-			else
-				gu_set_rgb_pixel(info, adr, pixel[0], pixel[1],
-						pixel[2]);
-			adr += info->bits_per_pixel >> 3;
-			image += img_byte_per_pixel;
-		}
+		if (gu_is_888(info))
+			gu_blend_row_888(info, (u32 *)adr, image, width,
+					 img_byte_per_pixel);
+		else if (gu_is_565(info))
+			gu_blend_row_565(info, (u16 *)adr, image, width,
+					 img_byte_per_pixel);
+		else
+			gu_blend_row(info, adr, image, width,
+				     img_byte_per_pixel);
 	}
 }
 
@@ -325,6 +443,12 @@ void gu_screen_blit_area(struct screen *sc, int startx, int starty, int width,
 		void *fb = info->screen_base + starty * sc->info->line_length + startx * bpp;
 		void *fboff = info->screen_base_shadow + starty * sc->info->line_length + startx * bpp;
 
+		/* full lines are contiguous, copy them in one go */
+		if (!startx && width * bpp == info->line_length) {
+			memcpy(fb, fboff, height * info->line_length);
+			height = 0;
+		}
+
 		for (y = starty; y < starty + height; y++) {
 			memcpy(fb, fboff, width * bpp);
 			fb += sc->info->line_length;
@@ -373,6 +497,12 @@ void gu_fill_rectangle(struct screen *sc,
 		int x;
 		unsigned char *pixel = buf + y * sc->info->line_length +
 			x1 * (sc->info->bits_per_pixel / 8);
+
+		if (a == 0xff && gu_fill_row(sc->info, pixel,
+					     gu_rgb_to_pixel(sc->info, r, g, b, 0),
+					     x2 - x1 + 1))
+			continue;
+
 		for(x = x1; x <= x2; x++) {
 			gu_set_rgba_pixel(sc->info, pixel, r, g, b, a);
 			pixel += sc->info->bits_per_pixel / 8;
@@ -27,9 +27,19 @@
 #include <string.h>
 #include <globalvar.h>
 #include <linux/err.h>
+#include <linux/hashtable.h>
+#include <linux/stringhash.h>
 #include <file-list.h>
 #include <stringlist.h>
 
+/* all parameters of all devices, hashed by device and name */
+static DEFINE_HASHTABLE(param_hashtable, 10);
+
+static unsigned int param_hash(struct device *dev, const char *name)
+{
+	return full_name_hash(dev, name, strlen(name));
+}
+
 static const char *param_type_string[] = {
 	[PARAM_TYPE_STRING] = "string",
 	[PARAM_TYPE_INT32] = "int32",
@@ -53,8 +63,8 @@ struct param_d *get_param_by_name(struct device *dev, const char *name)
 {
 	struct param_d *p;
 
-	list_for_each_entry(p, &dev->parameters, list) {
-		if (!strcmp(p->name, name))
+	hash_for_each_possible(param_hashtable, p, hash, param_hash(dev, name)) {
+		if (p->dev == dev && !strcmp(p->name, name))
 			return p;
 	}
 
@@ -175,6 +185,7 @@ static int __dev_add_param(struct param_d *param, struct device *dev,
 	param->flags = flags;
 	param->dev = dev;
 	list_add_sort(&param->list, &dev->parameters, compare);
+	hash_add(param_hashtable, &param->hash, param_hash(dev, param->name));
 
 	dev_param_init_from_nv(dev, name);
 
@@ -1021,6 +1032,7 @@ void dev_remove_param(struct param_d *p)
 {
 	p->set(p->dev, p, NULL);
 	list_del(&p->list);
+	hash_del(&p->hash);
 	free(p->name);
 	free(p);
 }
@@ -1037,6 +1049,7 @@ void dev_remove_parameters(struct device *dev)
 	list_for_each_entry_safe(p, n, &dev->parameters, list) {
 		p->set(dev, p, NULL);
 		list_del(&p->list);
+		hash_del(&p->hash);
 		free(p->name);
 		free(p);
 	}
@@ -19,6 +19,7 @@
 #include <environment.h>
 #include <linux/ctype.h>
 #include <linux/stat.h>
+#include <linux/slab.h>
 
 LIST_HEAD(netdev_list);
 
@@ -224,17 +225,24 @@ struct eth_q {
 	void *data;
 };
 
+static struct kmem_cache *eth_q_cache;
+
 static int eth_queue(struct eth_device *edev, void *packet, int length)
 {
 	struct eth_q *q;
 
-	q = xzalloc(sizeof(*q));
+	if (!eth_q_cache)
+		eth_q_cache = KMEM_CACHE(eth_q, 0);
+	if (!eth_q_cache)
+		return -ENOMEM;
+
+	q = kmem_cache_zalloc(eth_q_cache, GFP_KERNEL);
 	if (!q)
 		return -ENOMEM;
 
 	q->data = dma_alloc(length);
 	if (!q->data) {
-		free(q);
+		kmem_cache_free(eth_q_cache, q);
 		return -ENOMEM;
 	}
 
@@ -295,7 +303,7 @@ static void eth_do_work(struct eth_device *edev)
 		eth_send_raw(edev, q->data, q->length);
 		list_del(&q->list);
 		free(q->data);
-		free(q);
+		kmem_cache_free(eth_q_cache, q);
 	}
 
 	slice_release(eth_device_slice(edev));
@@ -508,7 +516,7 @@ void eth_unregister(struct eth_device *edev)
 
 		list_del(&q->list);
 		free(q->data);
-		free(q);
+		kmem_cache_free(eth_q_cache, q);
 	}
 
 	if (IS_ENABLED(CONFIG_OFDEVICE))
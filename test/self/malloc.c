@@ -7,6 +7,7 @@
 #include <malloc.h>
 #include <memory.h>
 #include <linux/sizes.h>
+#include <linux/slab.h>
 
 BSELFTEST_GLOBALS();
 
@@ -89,3 +90,37 @@ static void test_malloc(void)
 	__expect(p != tmp, true, "allocate distinct 0-size buffers", __func__, __LINE__);
 }
 bselftest(core, test_malloc);
+
+static void test_kmem_cache(void)
+{
+	struct kmem_cache *cache;
+	u64 *objs[64];
+	int i, j;
+
+	cache = kmem_cache_create("selftest", 24, 8, 0, NULL);
+	expect_alloc_ok(cache);
+	if (!cache)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(objs); i++) {
+		expect_alloc_ok(objs[i] = kmem_cache_zalloc(cache, GFP_KERNEL));
+		if (!objs[i])
+			break;
+
+		__expect(IS_ALIGNED((unsigned long)objs[i], 8) &&
+			 !objs[i][0] && !objs[i][2], true,
+			 "zeroed and aligned object", __func__, __LINE__);
+
+		objs[i][0] = objs[i][1] = objs[i][2] = i;
+	}
+
+	for (j = 0; j < i; j++)
+		__expect(objs[j][2] == j, true, "objects don't overlap",
+			 __func__, __LINE__);
+
+	while (i--)
+		kmem_cache_free(cache, objs[i]);
+
+	kmem_cache_destroy(cache);
+}
+bselftest(core, test_kmem_cache);
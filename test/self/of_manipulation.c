@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <linux/string.h>
 #include <errno.h>
+#include <linux/err.h>
 #include <of.h>
 
 BSELFTEST_GLOBALS();
@@ -110,9 +111,94 @@ static void test_of_property_strings(struct device_node *root)
 	assert_equal(np3, np4);
 }
 
+static void assert_node(struct device_node *np, struct device_node *expect)
+{
+	total_tests++;
+
+	if (np == expect)
+		return;
+
+	pr_warn("lookup returned %s, expected %s\n",
+		np ? np->full_name : "(null)",
+		expect ? expect->full_name : "(null)");
+	failed_tests++;
+}
+
+static void test_of_lookup_index(void)
+{
+	struct device_node *root = of_get_root_node();
+	struct device_node *base, *np1, *np2, *np3, *first, *next;
+	phandle ph;
+
+	if (!root)
+		return;
+
+	base = of_new_node(root, "selftest-lookup");
+	np1 = of_new_node(base, "np1");
+	np2 = of_new_node(base, "np2");
+	np3 = of_new_node(base, "np3");
+
+	of_property_write_strings(np1, "compatible",
+				  "barebox,selftest-a", "barebox,selftest-b", NULL);
+	of_property_write_string(np2, "compatible", "barebox,selftest-b");
+
+	ph = of_node_create_phandle(np2);
+	assert_node(of_find_node_by_phandle(ph), np2);
+
+	first = of_find_compatible_node(NULL, NULL, "barebox,selftest-a");
+	assert_node(first, np1);
+	assert_node(of_find_compatible_node(first, NULL, "barebox,selftest-a"), NULL);
+
+	first = of_find_compatible_node(NULL, NULL, "barebox,selftest-b");
+	next = of_find_compatible_node(first, NULL, "BAREBOX,selftest-b");
+	assert_node(first == np1 ? next : first, np2);
+	assert_node(of_find_compatible_node(next, NULL, "barebox,selftest-b"), NULL);
+
+	/* the index must follow changes to the tree */
+	of_property_write_string(np3, "compatible", "barebox,selftest-a");
+	first = of_find_compatible_node(NULL, NULL, "barebox,selftest-a");
+	next = of_find_compatible_node(first, NULL, "barebox,selftest-a");
+	assert_node(first == np1 ? next : first, np3);
+
+	of_delete_node(np2);
+	assert_node(of_find_node_by_phandle(ph), NULL);
+
+	of_delete_node(base);
+	assert_node(of_find_compatible_node(NULL, NULL, "barebox,selftest-a"), NULL);
+}
+
+extern char __dtb_of_manipulation_start[], __dtb_of_manipulation_end[];
+
+static void test_of_flatten_inplace(void)
+{
+	struct device_node *root, *np, *flat;
+	void *fdt;
+
+	root = of_unflatten_dtb_const(__dtb_of_manipulation_start,
+				      __dtb_of_manipulation_end - __dtb_of_manipulation_start);
+	if (IS_ERR(root)) {
+		total_tests++;
+		failed_tests++;
+		return;
+	}
+
+	/* unmodified subtrees are copied from the blob, this one is not */
+	np = of_find_node_by_path_from(root, "/np2");
+	of_property_write_string(np, "property-single", "bee");
+	of_new_node(np, "np21");
+
+	fdt = of_flatten_dtb(root);
+	flat = of_unflatten_dtb(fdt, fdt_totalsize(fdt));
+	free(fdt);
+
+	assert_equal(root, flat);
+
+	of_delete_node(flat);
+	of_delete_node(root);
+}
+
 static void __init test_of_manipulation(void)
 {
-	extern char __dtb_of_manipulation_start[], __dtb_of_manipulation_end[];
 	struct device_node *root = of_new_node(NULL, NULL);
 	struct device_node *expected;
 
@@ -126,5 +212,8 @@ static void __init test_of_manipulation(void)
 
 	of_delete_node(root);
 	of_delete_node(expected);
+
+	test_of_lookup_index();
+	test_of_flatten_inplace();
 }
 bselftest(core, test_of_manipulation);
@@ -202,3 +202,58 @@ static void test_ramfs(void)
 	expect_fail(dir ? 0 : -EISDIR, "opening removed directory");
 }
 bselftest(core, test_ramfs);
+
+static void test_ramfs_extents(void)
+{
+	const char *fname = make_temp("ramfs-extents");
+	u8 pattern[1000];
+	u8 *buf, *map;
+	int i, fd, ret;
+
+	for (i = 0; i < sizeof(pattern); i++)
+		pattern[i] = i;
+
+	/* grow in small steps over several extents */
+	fd = open(fname, O_RDWR | O_CREAT | O_TRUNC);
+	if (!expect_success(fd, "open"))
+		return;
+
+	for (i = 0; i < 300; i++) {
+		ret = write_full(fd, pattern, sizeof(pattern));
+		if (!expect_success(ret, "write %d", i))
+			break;
+	}
+
+	buf = malloc(sizeof(pattern));
+	lseek(fd, 0, SEEK_SET);
+	for (i = 0; i < 300; i++) {
+		ret = read_full(fd, buf, sizeof(pattern));
+		if (!expect_success(ret == sizeof(pattern) ? 0 : -EIO,
+				    "read %d", i))
+			break;
+		if (!expect_success(memcmp(buf, pattern, sizeof(pattern)) ? -EILSEQ : 0,
+				    "content at %d", i))
+			break;
+	}
+	free(buf);
+
+	/* a preallocated file is contiguous and can be mapped */
+	ret = ftruncate(fd, 0);
+	expect_success(ret, "truncate to 0");
+	ret = ftruncate(fd, SZ_1M);
+	expect_success(ret, "preallocate");
+
+	lseek(fd, SZ_1M - sizeof(pattern), SEEK_SET);
+	ret = write_full(fd, pattern, sizeof(pattern));
+	expect_success(ret, "write at end");
+
+	map = memmap(fd, PROT_READ);
+	if (expect_success(map == MAP_FAILED ? -EINVAL : 0, "memmap"))
+		expect_success(memcmp(map + SZ_1M - sizeof(pattern), pattern,
+				      sizeof(pattern)) ? -EILSEQ : 0,
+			       "memmap content");
+
+	close(fd);
+	unlink(fname);
+}
+bselftest(core, test_ramfs_extents);